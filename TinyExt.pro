@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,21 +8,18 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core.pri)
+
 SOURCES += \
-    analyze.cpp \
     main.cpp \
     dialog.cpp \
-    parse.cpp \
-    scan.cpp \
-    util.cpp
+    highlighter.cpp \
+    treemodel.cpp
 
 HEADERS += \
-    analyze.h \
     dialog.h \
-    globals.h \
-    parse.h \
-    scan.h \
-    util.h
+    highlighter.h \
+    treemodel.h
 
 FORMS += \
     dialog.ui
@@ -1,34 +1,274 @@
-#include "parse.h"
-#include "util.h"
-#include <stdio.h>
-
-/* allocate global variables */
-FILE *source;
-FILE *listing;
-FILE *code;
-
-/* allocate and set tracing flags */
-int EchoSource = FALSE;
-int TraceScan = FALSE;
-int TraceParse = TRUE;
-
-int Error = FALSE;
-
-TreeNode* analyzeCode(const char *sourcePath, const char *errPath) {
-  reset();
-  TreeNode *syntaxTree;
-  source = fopen(sourcePath, "r");
-  //    listing = fopen(resPath, "w"); /* send listing to screen */
-  listing = fopen(errPath, "w"); /* send listing to screen */
-                                 //  listing = stdout;
-  if (source == NULL) {
-    fprintf(stderr, "File %s not found\n", sourcePath);
-    exit(1);
-  }
-  syntaxTree = parse();
-  fclose(source);
-  fclose(listing);
-//  if (TraceParse)
-//    printTree(syntaxTree);
-  return syntaxTree;
-}
+#include "analyze.h"
+#include "parse.h"
+#include "scan.h"
+#include "source.h"
+#include "util.h"
+#include <algorithm>
+#include <stdio.h>
+
+/* allocate and set tracing flags */
+int EchoSource = FALSE;
+int TraceScan = FALSE;
+int TraceParse = TRUE;
+int TraceAnalyze = FALSE;
+
+std::unique_ptr<AnalyzeResult> analyzeCode(const char *text, size_t size,
+                                           FILE *listing,
+                                           const std::atomic<bool> *cancel) {
+  std::unique_ptr<AnalyzeResult> result(new AnalyzeResult);
+  CompilerContext ctx;
+  ctx.listing = listing;
+  ctx.cancel = cancel;
+  ctx.arena = &result->arena;
+  ctx.names = &result->names;
+  ctx.diagnostics = &result->diagnostics;
+  setScanBuffer(ctx, text, size);
+  /* scan once, then parse over the token array */
+  {
+    PhaseTimer timer(result->stats.scanNs);
+    tokenize(ctx, result->tokens);
+  }
+  if (cancel != NULL && cancel->load())
+    return NULL;
+  ctx.tokenArray = result->tokens.data();
+  ctx.tokenCount = result->tokens.size();
+  {
+    PhaseTimer timer(result->stats.parseNs);
+    result->tree = parse(ctx);
+  }
+  if (cancel != NULL && cancel->load())
+    return NULL;
+  {
+    PhaseTimer timer(result->stats.analyzeNs);
+    buildSymtab(result->symbols, result->tree);
+  }
+  if (TraceAnalyze && listing != NULL) {
+    fprintf(listing, "\nSymbol table:\n\n");
+    printSymTab(listing, result->symbols);
+    fprintf(listing, "\nChecking Types...\n");
+  }
+  {
+    PhaseTimer timer(result->stats.typeNs);
+    typeCheck(result->tree, result->typeErrors, listing);
+  }
+  if (TraceAnalyze && listing != NULL)
+    fprintf(listing, "\nType Checking Finished\n");
+  result->nodes = ctx.nodes;
+  result->stats.maxDepth = ctx.maxDepth;
+  countStats(*result);
+//  if (TraceParse)
+//    printTree(listing, result->tree);
+  return result;
+}
+
+std::unique_ptr<AnalyzeResult> analyzeCode(const char *sourcePath,
+                                           FILE *listing) {
+  SourceBuffer buffer;
+  int64_t readNs = 0;
+  bool mapped;
+  {
+    PhaseTimer timer(readNs);
+    mapped = buffer.map(sourcePath);
+  }
+  if (!mapped) {
+    std::unique_ptr<AnalyzeResult> result(new AnalyzeResult);
+    result->diagnostics.push_back({0, 0, SourceNotFoundD,
+                                   std::string("file not found: ") + sourcePath});
+    countStats(*result);
+    return result;
+  }
+  std::unique_ptr<AnalyzeResult> result =
+      analyzeCode(buffer.data(), buffer.size(), listing);
+  result->stats.readNs = readNs;
+  return result;
+}
+
+void countStats(AnalyzeResult &result) {
+  AnalyzeStats &s = result.stats;
+  s.tokens = (long)result.tokens.size();
+  s.nodes = result.nodes;
+  s.bytes = result.arena.bytesAllocated();
+  for (const std::unique_ptr<Arena> &a : result.arenas)
+    s.bytes += a->bytesAllocated();
+  s.diagnostics = (long)result.diagnostics.size();
+  s.typeErrors = (long)result.typeErrors.size();
+  s.symbols = result.symbols.size();
+}
+
+/* a statement names a variable when it assigns or
+ * reads it; for gives its node the name of 'to' or
+ * 'downto' instead
+ */
+static int namesVariable(const TreeNode *t) {
+  if (t->nodekind == ExpK)
+    return t->kind.exp == IdK && t->attr.name != NULL;
+  return (t->kind.stmt == AssignK || t->kind.stmt == RegK ||
+          t->kind.stmt == PlusEqK || t->kind.stmt == ReadK) &&
+         t->attr.name != NULL;
+}
+
+void buildSymtab(SymbolTable &st, TreeNode *syntaxTree) {
+  /* the symbol of every interned name met so far,
+   * which saves hashing it again at each reference
+   */
+  std::vector<int> known;
+  TreeWalk walk(syntaxTree);
+  TreeNode *t;
+  while ((t = walk.next()) != NULL) {
+    if (!namesVariable(t))
+      continue;
+    if (t->symbol < 0) {
+      st.insert(t->attr.name, t->lineno, st.size());
+      continue;
+    }
+    if ((size_t)t->symbol >= known.size())
+      known.resize(std::max((size_t)t->symbol + 1, 2 * known.size()), -1);
+    int &id = known[t->symbol];
+    if (id < 0) /* a new variable gets the next memory location */
+      id = st.insert(t->attr.name, t->lineno, st.size());
+    else
+      st.reference(id, t->lineno);
+  }
+  st.finish();
+}
+
+/* TypeChecker sets the types of one syntax tree */
+struct TypeChecker {
+  std::vector<Diagnostic> &errors;
+  FILE *listing;
+
+  void typeError(TreeNode *t, const char *message) {
+    if (listing != NULL)
+      fprintf(listing, "Type error at line %d: %s\n", t->lineno, message);
+    errors.push_back({t->lineno, 0, TypeMismatchD, message});
+  }
+
+  /* operands checks children first .. last of t
+   * against need and reports message once if one
+   * has another; a missing child, left by a syntax
+   * error, is not reported again
+   */
+  void operands(TreeNode *t, int first, int last, ExpType need,
+                const char *message) {
+    for (int i = first; i <= last; i++)
+      if (t->child[i] != NULL && t->child[i]->type != need) {
+        typeError(t, message);
+        return;
+      }
+  }
+
+  /* checkNode checks a single node, whose children
+   * are checked already
+   */
+  void checkNode(TreeNode *t) {
+    if (t->nodekind == ExpK) {
+      switch (t->kind.exp) {
+      case OpK:
+        switch (t->attr.op) {
+        case AND:
+        case OR:
+          t->type = Boolean;
+          operands(t, 0, 1, Boolean, "Op applied to non-boolean");
+          break;
+        case NOT:
+          t->type = Boolean;
+          operands(t, 0, 0, Boolean, "Op applied to non-boolean");
+          break;
+        case EQ:
+        case LT:
+        case GT:
+        case LTE:
+        case GTE:
+        case NEQ:
+          t->type = Boolean;
+          operands(t, 0, 1, Integer, "Op applied to non-integer");
+          break;
+        case UNION:
+        case CONCAT:
+        case CLOSURE:
+        case OPTION:
+          /* the operators of a regular expression
+           * make no value
+           */
+          t->type = Void;
+          break;
+        default:
+          t->type = Integer;
+          operands(t, 0, 1, Integer, "Op applied to non-integer");
+          break;
+        }
+        break;
+      case ConstK:
+      case IdK:
+        t->type = Integer;
+        break;
+      default:
+        break;
+      }
+      return;
+    }
+    switch (t->kind.stmt) {
+    case IfK:
+      operands(t, 0, 0, Boolean, "if test is not Boolean");
+      break;
+    case RepeatK:
+      operands(t, 1, 1, Boolean, "repeat test is not Boolean");
+      break;
+    case AssignK:
+      operands(t, 0, 0, Integer, "assignment of non-integer value");
+      break;
+    case RegK: {
+      /* the names and numbers of a regular
+       * expression stand for symbols, not values
+       */
+      TreeWalk walk(t->child[0]);
+      TreeNode *c;
+      while ((c = walk.next()) != NULL)
+        c->type = Void;
+      break;
+    }
+    case PlusEqK:
+      operands(t, 0, 0, Integer, "+= of non-integer value");
+      break;
+    case ForK:
+      /* its first child is the assignment of the
+       * start value, checked on its own
+       */
+      operands(t, 1, 1, Integer, "for bound is not Integer");
+      break;
+    default:
+      /* write prints Booleans as well as Integers */
+      break;
+    }
+  }
+};
+
+void typeCheck(TreeNode *syntaxTree, std::vector<Diagnostic> &errors,
+               FILE *listing) {
+  /* Frame is a node of the walk down and the next
+   * of its children to check; a checked node makes
+   * way for its sibling
+   */
+  struct Frame {
+    TreeNode *t;
+    int child;
+  };
+  TypeChecker checker{errors, listing};
+  std::vector<Frame> stack;
+  if (syntaxTree != NULL)
+    stack.push_back({syntaxTree, 0});
+  while (!stack.empty()) {
+    Frame &f = stack.back();
+    if (f.child < MAXCHILDREN) {
+      TreeNode *c = f.t->child[f.child++];
+      if (c != NULL)
+        stack.push_back({c, 0});
+      continue;
+    }
+    checker.checkNode(f.t);
+    if (f.t->sibling != NULL)
+      f = {f.t->sibling, 0};
+    else
+      stack.pop_back();
+  }
+}
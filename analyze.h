@@ -1,6 +1,85 @@
 #pragma once
 
 #include "globals.h"
+#include "arena.h"
+#include "diagnostic.h"
+#include "intern.h"
+#include "scan.h"
+#include "stats.h"
+#include "symtab.h"
+#include <memory>
+#include <vector>
+
+/* AnalyzeResult owns the syntax tree of one run:
+ * every node and identifier lives in its arena, so
+ * dropping the result releases the whole tree
+ */
+struct AnalyzeResult {
+  Arena arena;
+  /* more arenas, holding the statements of a text
+   * parsed in parallel
+   */
+  std::vector<std::unique_ptr<Arena>> arenas;
+  TreeNode *tree = NULL;
+  /* identifiers of the tree; attr.name of a node
+   * is names.name(symbol)
+   */
+  InternTable names{arena};
+  std::vector<Diagnostic> diagnostics;
+  /* every token, ENDFILE last, for passes that
+   * would otherwise scan the text again
+   */
+  std::vector<Token> tokens;
+  /* variables of the tree; empty for the results
+   * of an IncrementalParser
+   */
+  SymbolTable symbols;
+  /* mismatches found by typeCheck; diagnostics holds
+   * those of the parser alone, so that the parses of
+   * every kind can be compared
+   */
+  std::vector<Diagnostic> typeErrors;
+  long nodes = 0;  /* nodes in tree */
+  AnalyzeStats stats; /* of the run that made it */
+};
+
+/* Function buildSymtab constructs the symbol
+ * table by preorder traversal of the syntax tree;
+ * the names it records are those of the tree
+ */
+void buildSymtab(SymbolTable &st, TreeNode *syntaxTree);
+
+/* Procedure typeCheck performs type checking by a
+ * postorder syntax tree traversal: it sets type on
+ * every expression node, Void in a regular
+ * definition. Mismatches are added to errors and
+ * reported in listing when it is not NULL; an
+ * operand missing after a syntax error is not
+ * reported again
+ */
+void typeCheck(TreeNode *syntaxTree, std::vector<Diagnostic> &errors,
+               FILE *listing = NULL);
+
+/* countStats fills in the counters of result.stats
+ * that can be read off the finished result
+ */
+void countStats(AnalyzeResult &result);
+
+/* analyzeCode parses size bytes of TINY source
+ * held in memory; no file is touched. Tracing
+ * output goes to listing when it is not NULL.
+ * Each call has its own CompilerContext, so calls
+ * on different threads do not interfere. Another
+ * thread may set *cancel to stop it early, and then
+ * it returns NULL
+ */
+extern std::unique_ptr<AnalyzeResult>
+analyzeCode(const char *text, size_t size, FILE *listing = NULL,
+            const std::atomic<bool> *cancel = NULL);
+
+/* analyzeCode parses the file at sourcePath; an
+ * unreadable file is reported as a diagnostic
+ */
+extern std::unique_ptr<AnalyzeResult> analyzeCode(const char *sourcePath,
+                                                  FILE *listing = NULL);
 
-extern TreeNode* analyzeCode(const char *, const char*);
-extern const char* getTreeNodeInfo(TreeNode*);
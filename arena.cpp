@@ -0,0 +1,76 @@
+/****************************************************/
+/* File: arena.cpp                                  */
+/* Bump-pointer arena implementation                */
+/****************************************************/
+
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* first block size; every further block doubles
+ * until MAXBLOCK so that a tree of n nodes costs
+ * O(log n) system allocations
+ */
+#define FIRSTBLOCK (64 * 1024)
+#define MAXBLOCK (64 * 1024 * 1024)
+
+Arena::Arena()
+    : head(NULL), cur(NULL), end(NULL), nextSize(FIRSTBLOCK), blocks(0),
+      used(0), reserved(0) {}
+
+Arena::~Arena() { release(); }
+
+void Arena::release() {
+  while (head != NULL) {
+    Block *prev = head->prev;
+    free(head);
+    head = prev;
+  }
+  cur = end = NULL;
+  nextSize = FIRSTBLOCK;
+}
+
+/* grow chains a new block large enough for a
+ * request of size bytes at the given alignment
+ */
+bool Arena::grow(size_t size, size_t align) {
+  size_t need = sizeof(Block) + size + align;
+  size_t n = nextSize;
+  while (n < need)
+    n *= 2;
+  Block *b = (Block *)malloc(n);
+  if (b == NULL)
+    return false;
+  b->prev = head;
+  b->size = n;
+  head = b;
+  cur = (char *)(b + 1);
+  end = (char *)b + n;
+  blocks++;
+  reserved += n;
+  if (nextSize < MAXBLOCK)
+    nextSize *= 2;
+  return true;
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+  uintptr_t p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+  if (cur == NULL || p + size > (uintptr_t)end) {
+    if (!grow(size, align))
+      return NULL;
+    p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+  }
+  cur = (char *)(p + size);
+  used += size;
+  return (void *)p;
+}
+
+char *Arena::copyString(const char *s, size_t n) {
+  char *t = (char *)allocate(n + 1, 1);
+  if (t != NULL) {
+    memcpy(t, s, n);
+    t[n] = '\0';
+  }
+  return t;
+}
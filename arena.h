@@ -0,0 +1,62 @@
+/****************************************************/
+/* File: arena.h                                    */
+/* Bump-pointer arena holding the syntax tree nodes */
+/* and identifier strings of one analysis run       */
+/****************************************************/
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* An Arena hands out memory by bumping a pointer
+ * through large blocks obtained from malloc. Nothing
+ * is freed individually: the whole arena is released
+ * at once when it is destroyed (or release() is
+ * called), which only walks the handful of blocks
+ */
+class Arena {
+public:
+  Arena();
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /* allocate returns size bytes aligned to align,
+   * or NULL if the system is out of memory
+   */
+  void *allocate(size_t size, size_t align = alignof(max_align_t));
+
+  /* copyString stores a NUL terminated copy of the
+   * first n characters of s inside the arena
+   */
+  char *copyString(const char *s, size_t n);
+
+  /* release frees every block at once */
+  void release();
+
+  /* number of blocks requested from the system */
+  size_t systemAllocations() const { return blocks; }
+  /* bytes handed out by allocate() */
+  size_t bytesAllocated() const { return used; }
+  /* bytes obtained from the system */
+  size_t bytesReserved() const { return reserved; }
+
+private:
+  struct Block {
+    Block *prev;
+    size_t size;
+  };
+
+  bool grow(size_t size, size_t align);
+
+  Block *head;
+  char *cur;
+  char *end;
+  size_t nextSize;
+  size_t blocks;
+  size_t used;
+  size_t reserved;
+};
+
+#endif
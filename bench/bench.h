@@ -0,0 +1,101 @@
+/****************************************************/
+/* File: bench.h                                    */
+/* Shared declarations for the tinybench programs   */
+/****************************************************/
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "globals.h"
+#include <chrono>
+#include <string>
+
+struct AnalyzeResult;
+
+/* benchClock returns seconds on a monotonic clock */
+inline double benchClock(void) {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+/* sampleProgram returns n top-level statements
+ * mixing loops, conditionals and expressions
+ */
+std::string sampleProgram(int n);
+
+/* ProgramShape selects what generateProgram writes */
+typedef enum {
+  StraightShape,   /* long runs of assignments */
+  NestedShape,     /* if, repeat and for hundreds deep */
+  ExpressionShape, /* huge expressions over every operator */
+  CommentShape,    /* more comment than code */
+  RegexShape,      /* ::= regular definitions */
+  MixedShape       /* a bit of everything, like real programs */
+} ProgramShape;
+
+#define NSHAPES 6
+
+extern const char *const shapeNames[NSHAPES];
+
+/* generateProgram returns a program of about bytes
+ * bytes that parses without diagnostics; the same
+ * shape, size and seed always give the same text
+ */
+std::string generateProgram(ProgramShape shape, size_t bytes, unsigned seed);
+
+/* damage deletes n random characters of text, which
+ * leaves blocks open and statements cut in half
+ */
+std::string damage(std::string text, int n, unsigned seed);
+
+/* sameTree returns TRUE if the trees a and b have
+ * the same shape, kinds, attributes, lines, types
+ * and, unless ids is FALSE, name ids
+ */
+int sameTree(TreeNode *a, TreeNode *b, int ids = TRUE);
+
+/* sameAnalysis returns TRUE if a and b have equal
+ * trees, symbol tables, node counts, diagnostics,
+ * type errors and, unless ids is FALSE, names in
+ * the same order
+ */
+int sameAnalysis(const AnalyzeResult &a, const AnalyzeResult &b,
+                 int ids = TRUE);
+
+/* sameTokens returns TRUE if a and b scanned the
+ * same tokens
+ */
+int sameTokens(const AnalyzeResult &a, const AnalyzeResult &b);
+
+/* RunProgram is a loop-heavy program that reads
+ * its size, the ways of running programs are
+ * timed on
+ */
+typedef struct {
+  const char *name;
+  int input; /* size at 100% */
+  const char *text;
+} RunProgram;
+
+#define NRUNPROGRAMS 7
+
+extern const RunProgram runPrograms[NRUNPROGRAMS];
+
+/* each benchmark takes the arguments following its
+ * name and returns the process exit status
+ */
+int benchReserved(int argc, char *argv[]);
+int benchThreads(int argc, char *argv[]);
+int benchIncremental(int argc, char *argv[]);
+int benchTokens(int argc, char *argv[]);
+int benchScan(int argc, char *argv[]);
+int benchSuite(int argc, char *argv[]);
+int benchExpressions(int argc, char *argv[]);
+int benchDeep(int argc, char *argv[]);
+int benchParallel(int argc, char *argv[]);
+int benchPipe(int argc, char *argv[]);
+int benchSymbols(int argc, char *argv[]);
+int benchTypes(int argc, char *argv[]);
+int benchMachine(int argc, char *argv[]);
+int benchTM(int argc, char *argv[]);
+
+#endif
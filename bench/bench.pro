@@ -0,0 +1,32 @@
+# tinybench: micro-benchmarks for the compiler core (no Qt)
+
+TEMPLATE = app
+TARGET = tinybench
+
+CONFIG += console c++17 thread
+CONFIG -= qt app_bundle
+
+include(../core.pri)
+
+SOURCES += \
+    benchmain.cpp \
+    chunks.cpp \
+    deep.cpp \
+    edits.cpp \
+    exprparse.cpp \
+    generate.cpp \
+    pipe.cpp \
+    reserved.cpp \
+    scanrate.cpp \
+    suite.cpp \
+    symbols.cpp \
+    threads.cpp \
+    tmsim.cpp \
+    tokenbuf.cpp \
+    types.cpp \
+    vmrun.cpp
+
+HEADERS += \
+    bench.h
+
+win32: LIBS += -lpsapi
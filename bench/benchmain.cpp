@@ -0,0 +1,69 @@
+/****************************************************/
+/* File: benchmain.cpp                              */
+/* Command line driver for the tinybench programs   */
+/****************************************************/
+
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+
+static const struct {
+  const char *name;
+  int (*run)(int, char *[]);
+  const char *help;
+} benches[] = {
+    {"reserved", benchReserved,
+     "[words] [rounds]  reserved word lookup: perfect hash vs linear search"},
+    {"threads", benchThreads,
+     "[max] [rounds] [file]  concurrent analyses on 1..max threads"},
+    {"incremental", benchIncremental,
+     "[statements] [edits] [checked] [fuzz]  re-analysis after small edits "
+     "vs a full parse"},
+    {"tokens", benchTokens,
+     "[statements] [rounds]  parsing from a token buffer vs from the scanner"},
+    {"scan", benchScan,
+     "[rounds] [file]  scanner throughput: per character vs run kernels"},
+    {"suite", benchSuite,
+     "[bytes] [seed] [rounds] [json]  every front-end phase on generated "
+     "programs"},
+    {"expr", benchExpressions,
+     "[bytes] [rounds] [fuzz]  binding power loop vs one function per "
+     "level"},
+    {"deep", benchDeep,
+     "[levels] [stack KB]  tree walkers on one deeply nested tree, on a "
+     "small stack"},
+    {"parallel", benchParallel,
+     "[bytes] [threads] [rounds]  one program parsed in pieces on a pool"},
+    {"pipe", benchPipe,
+     "[bytes] [rounds]  a piped program: read whole vs scanned and parsed "
+     "on two threads"},
+    {"symtab", benchSymbols,
+     "[names] [rounds]  symbol table pass vs chained st_insert buckets"},
+    {"types", benchTypes,
+     "[bytes] [rounds]  type checking pass: cost and nodes typed"},
+    {"vm", benchMachine,
+     "[size %] [rounds]  bytecode machine and native code vs a tree walker"},
+    {"tm", benchTM,
+     "[size %] [rounds]  generated TM code: predecoded simulator vs tm.c's "
+     "loop"},
+};
+
+#define NBENCH (int)(sizeof(benches) / sizeof(benches[0]))
+
+static void usage(void) {
+  fprintf(stderr, "usage: tinybench <benchmark> [args]\n");
+  for (int i = 0; i < NBENCH; i++)
+    fprintf(stderr, "  %-10s %s\n", benches[i].name, benches[i].help);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  for (int i = 0; i < NBENCH; i++)
+    if (!strcmp(argv[1], benches[i].name))
+      return benches[i].run(argc - 2, argv + 2);
+  usage();
+  return 2;
+}
@@ -0,0 +1,76 @@
+/****************************************************/
+/* File: chunks.cpp                                 */
+/* Parallel parsing of one large program against   */
+/* the sequential parse                             */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+int benchParallel(int argc, char *argv[]) {
+  size_t bytes = argc > 0 ? (size_t)atol(argv[0]) : 32u << 20;
+  int threads = argc > 1 ? atoi(argv[1]) : 0;
+  int rounds = argc > 2 ? atoi(argv[2]) : 3;
+  WorkPool pool(threads > 1 ? threads : 4);
+
+  /* every shape, whole and damaged, cut into small
+   * pieces so that many of them begin in the wrong
+   * place
+   */
+  int checked = 0;
+  for (int shape = 0; shape < NSHAPES; shape++)
+    for (int damaged = 0; damaged < 2; damaged++) {
+      std::string text = generateProgram((ProgramShape)shape, 256 << 10, 7);
+      if (damaged)
+        text = damage(text, 200, shape);
+      std::unique_ptr<AnalyzeResult> a = analyzeCode(text.data(), text.size());
+      for (size_t chunk : {16, 200, 5000}) {
+        std::unique_ptr<AnalyzeResult> b =
+            analyzeParallel(text.data(), text.size(), pool, chunk);
+        if (!sameAnalysis(*a, *b)) {
+          fprintf(stderr, "%s%s program, pieces of %zu tokens: differs\n",
+                  damaged ? "damaged " : "", shapeNames[shape], chunk);
+          return 1;
+        }
+        checked++;
+      }
+    }
+  printf("%d parallel analyses equal the sequential ones\n", checked);
+
+  WorkPool timed(threads);
+  std::string text = generateProgram(MixedShape, bytes, 1);
+  double sequential = 1e30, parallel = 1e30;
+  long nodes = 0;
+  for (int r = 0; r < rounds; r++) {
+    double t0 = benchClock();
+    std::unique_ptr<AnalyzeResult> a = analyzeCode(text.data(), text.size());
+    double t = benchClock() - t0;
+    if (t < sequential)
+      sequential = t;
+    t0 = benchClock();
+    std::unique_ptr<AnalyzeResult> b =
+        analyzeParallel(text.data(), text.size(), timed);
+    t = benchClock() - t0;
+    if (t < parallel)
+      parallel = t;
+    if (!sameAnalysis(*a, *b)) {
+      fprintf(stderr, "parallel analysis differs\n");
+      return 1;
+    }
+    nodes = a->nodes;
+  }
+  printf("%zu bytes, %ld nodes, %d threads\n", text.size(), nodes,
+         timed.size());
+  printf("%-10s %10s %10s\n", "analysis", "ms", "MB/s");
+  printf("%-10s %10.2f %10.1f\n", "sequential", sequential * 1e3,
+         text.size() / sequential / 1e6);
+  printf("%-10s %10.2f %10.1f\n", "parallel", parallel * 1e3,
+         text.size() / parallel / 1e6);
+  printf("speedup    %.2fx\n", sequential / parallel);
+  return 0;
+}
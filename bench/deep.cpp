@@ -0,0 +1,164 @@
+/****************************************************/
+/* File: deep.cpp                                   */
+/* Depth stress: every tree walker on a syntax tree */
+/* nested a million levels, run on a small stack    */
+/****************************************************/
+
+#include "bench.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+#define NULLDEVICE "NUL"
+#else
+#define NULLDEVICE "/dev/null"
+#endif
+
+/* printTree writes 2 spaces per level on every
+ * line, quadratic in the depth, so the listing is
+ * only made of a tree at most this deep
+ */
+#define PRINTLEVELS 10000
+
+/* deepTree builds without an arena the tree of
+ *   if not x then (if not x then ... end); write i
+ * nested levels deep, one level at a time
+ */
+static TreeNode *deepTree(CompilerContext &ctx, int levels) {
+  TreeNode *root = NULL;
+  TreeNode **hole = &root;
+  for (int i = 0; i < levels; i++) {
+    ctx.lineno = i + 1;
+    TreeNode *s = newStmtNode(ctx, IfK);
+    TreeNode *test = newExpNode(ctx, OpK);
+    TreeNode *x = newExpNode(ctx, IdK);
+    TreeNode *w = newStmtNode(ctx, WriteK);
+    TreeNode *c = newExpNode(ctx, ConstK);
+    if (s == NULL || test == NULL || x == NULL || w == NULL || c == NULL)
+      break;
+    test->attr.op = NOT;
+    x->attr.name = copyString(ctx, "x");
+    test->child[0] = x;
+    c->attr.val = i;
+    w->child[0] = c;
+    s->child[0] = test;
+    s->sibling = w;
+    *hole = s;
+    hole = &s->child[1];
+  }
+  return root;
+}
+
+/* Stress holds the arguments and results of the
+ * walks done on the small stack
+ */
+struct Stress {
+  int levels;
+  FILE *sink;
+  long nodes;       /* created by deepTree */
+  long walked;      /* visited by TreeWalk */
+  int depth;        /* deepest node seen */
+  double walkTime, printTime, freeTime;
+};
+
+static void stress(Stress *s) {
+  CompilerContext ctx;
+  TreeNode *tree = deepTree(ctx, s->levels);
+  s->nodes = ctx.nodes;
+
+  double t0 = benchClock();
+  TreeWalk walk(tree);
+  int depth;
+  s->walked = 0;
+  s->depth = 0;
+  while (walk.next(&depth) != NULL) {
+    s->walked++;
+    if (depth > s->depth)
+      s->depth = depth;
+  }
+  s->walkTime = benchClock() - t0;
+
+  t0 = benchClock();
+  freeTree(tree);
+  s->freeTime = benchClock() - t0;
+
+  CompilerContext small;
+  tree = deepTree(small, s->levels < PRINTLEVELS ? s->levels : PRINTLEVELS);
+  t0 = benchClock();
+  printTree(s->sink, tree);
+  fflush(s->sink);
+  s->printTime = benchClock() - t0;
+  freeTree(tree);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI stressThread(LPVOID arg) {
+  stress((Stress *)arg);
+  return 0;
+}
+#else
+static void *stressThread(void *arg) {
+  stress((Stress *)arg);
+  return NULL;
+}
+#endif
+
+/* onSmallStack runs stress(s) on a thread with a
+ * stack of stackSize bytes; returns FALSE if no
+ * such thread can be started
+ */
+static int onSmallStack(size_t stackSize, Stress *s) {
+#ifdef _WIN32
+  HANDLE h = CreateThread(NULL, stackSize, stressThread, s,
+                          STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+  if (h == NULL)
+    return FALSE;
+  WaitForSingleObject(h, INFINITE);
+  CloseHandle(h);
+  return TRUE;
+#else
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  int ok = pthread_attr_setstacksize(&attr, stackSize) == 0 &&
+           pthread_create(&thread, &attr, stressThread, s) == 0;
+  pthread_attr_destroy(&attr);
+  if (ok)
+    pthread_join(thread, NULL);
+  return ok;
+#endif
+}
+
+int benchDeep(int argc, char *argv[]) {
+  Stress s = {};
+  s.levels = argc > 0 ? atoi(argv[0]) : 1000000;
+  size_t stackSize = (size_t)(argc > 1 ? atoi(argv[1]) : 256) * 1024;
+  s.sink = fopen(NULLDEVICE, "w");
+  if (s.sink == NULL) {
+    fprintf(stderr, "cannot open %s\n", NULLDEVICE);
+    return 1;
+  }
+  int started = onSmallStack(stackSize, &s);
+  fclose(s.sink);
+  if (!started) {
+    fprintf(stderr, "cannot start a thread with a %zu KB stack\n",
+            stackSize / 1024);
+    return 1;
+  }
+  printf("%d levels, %ld nodes, deepest at %d, on a %zu KB stack\n",
+         s.levels, s.nodes, s.depth, stackSize / 1024);
+  printf("%-10s %10s %10s\n", "walk", "ms", "ns/node");
+  printf("%-10s %10.2f %10.2f\n", "TreeWalk", s.walkTime * 1e3,
+         s.walkTime / s.nodes * 1e9);
+  printf("%-10s %10.2f %10.2f\n", "freeTree", s.freeTime * 1e3,
+         s.freeTime / s.nodes * 1e9);
+  printf("%-10s %10.2f %10s  (%d levels)\n", "printTree",
+         s.printTime * 1e3, "", s.levels < PRINTLEVELS ? s.levels : PRINTLEVELS);
+  return s.walked == s.nodes ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+/****************************************************/
+/* File: edits.cpp                                  */
+/* Edit-to-result latency: incremental re-analysis  */
+/* against analyzing the whole text again           */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "incremental.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* sameAsFull returns TRUE if the analysis of
+ * parser, with its symbol table and types, is what
+ * analyzeCode makes of its text. Names may be
+ * interned in another order
+ */
+static int sameAsFull(IncrementalParser &parser, const char *what) {
+  const std::string &text = parser.text();
+  std::unique_ptr<AnalyzeResult> full = analyzeCode(text.data(), text.size());
+  std::unique_ptr<AnalyzeResult> result = parser.analysis();
+  buildSymtab(result->symbols, result->tree);
+  typeCheck(result->tree, result->typeErrors);
+  if (sameAnalysis(*result, *full, FALSE) && sameTokens(*result, *full) &&
+      parser.nodeCount() == full->nodes &&
+      parser.diagnosticCount() == (long)full->diagnostics.size())
+    return TRUE;
+  fprintf(stderr, "%s: the incremental result differs from analyzeCode\n",
+          what);
+  return FALSE;
+}
+
+/* the text random edits type: each has blanks at
+ * both ends, so it never runs into a name next to it
+ */
+static const char *const fragments[] = {
+    " ",       "\n",      " ; ",     " { ",     " } ",   " if ",
+    " else ",  " repeat ", " until ", " for ",   " to ",  " do ",
+    " enddo ", " x ",      " := ",    " + ",     " * ",   " ( ",
+    " ) ",     " [ ",      " ] ",     " 7 ",     " write ", " < ",
+    " ::= ",   " a | b "};
+
+#define NFRAGMENTS (int)(sizeof(fragments) / sizeof(fragments[0]))
+
+/* fuzzEdits makes n random edits to a small
+ * program, each a deletion of up to 12 bytes, an
+ * insertion of a fragment or both, and checks the
+ * result after every one
+ */
+static int fuzzEdits(int n) {
+  std::string text = sampleProgram(300);
+  IncrementalParser parser;
+  parser.reset(text.data(), text.size());
+  srand(2);
+  for (int i = 0; i < n; i++) {
+    size_t size = parser.text().size();
+    size_t pos = (size_t)rand() % (size + 1);
+    size_t removed = rand() % 3 == 0 ? (size_t)rand() % 13 : 0;
+    if (removed > size - pos)
+      removed = size - pos;
+    const char *added = rand() % 4 == 0 ? "" : fragments[rand() % NFRAGMENTS];
+    parser.edit(pos, removed, added, strlen(added));
+    char what[64];
+    snprintf(what, sizeof(what), "random edit %d", i + 1);
+    if (!sameAsFull(parser, what))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+int benchIncremental(int argc, char *argv[]) {
+  int statements = argc > 0 ? atoi(argv[0]) : 50000;
+  int edits = argc > 1 ? atoi(argv[1]) : 2000;
+  int checked = argc > 2 ? atoi(argv[2]) : 40;
+  int fuzz = argc > 3 ? atoi(argv[3]) : 2000;
+  if (!fuzzEdits(fuzz))
+    return 1;
+  std::string text = sampleProgram(statements);
+
+  double t0 = benchClock();
+  std::unique_ptr<AnalyzeResult> full = analyzeCode(text.data(), text.size());
+  double fullTime = benchClock() - t0;
+
+  IncrementalParser parser;
+  t0 = benchClock();
+  parser.reset(text.data(), text.size());
+  double resetTime = benchClock() - t0;
+
+  /* each edit types a blank or a line break next
+   * to a blank and the next one takes it back; a
+   * line break moves every later line
+   */
+  const char *typed[2] = {" ", "\n"};
+  double editTime[2];
+  long scanned[2] = {0, 0}, parsed[2] = {0, 0};
+  srand(1);
+  for (int k = 0; k < 2; k++) {
+    size_t pos = 0;
+    editTime[k] = 0;
+    for (int i = 0; i < edits; i++) {
+      /* even edits type, odd ones take it back */
+      if (i % 2 == 0) {
+        pos = parser.text().find(' ', (size_t)rand() % text.size());
+        if (pos == std::string::npos)
+          pos = parser.text().find(' ');
+      }
+      t0 = benchClock();
+      if (i % 2 == 0)
+        parser.edit(pos, 0, typed[k], 1);
+      else
+        parser.edit(pos, 1, "", 0);
+      editTime[k] += benchClock() - t0;
+      scanned[k] += parser.tokensScanned();
+      parsed[k] += parser.statementsParsed();
+      /* checking takes two whole analyses, so only
+       * the first edits are checked
+       */
+      if (i < checked && !sameAsFull(parser, k ? "edit line" : "edit blank"))
+        return 1;
+    }
+    editTime[k] /= edits;
+  }
+
+  /* opening a block that is never closed changes
+   * the parse of everything after it
+   */
+  size_t middle = text.find("for", text.size() / 2);
+  t0 = benchClock();
+  parser.edit(middle, 0, "repeat ", 7);
+  double openTime = benchClock() - t0;
+  long openParsed = parser.statementsParsed();
+  if (checked > 0 && !sameAsFull(parser, "open block"))
+    return 1;
+  parser.edit(middle, 7, "", 0);
+
+  /* typing into a number a digit at a time, as the
+   * editor does, moves the gaps a character on
+   */
+  const char *digits = "12345678";
+  size_t number = parser.text().find_first_of("0123456789", middle);
+  int typedChars = 0;
+  t0 = benchClock();
+  for (int round = 0; round < 50; round++) {
+    for (size_t i = 0; digits[i] != 0; i++, typedChars++)
+      parser.edit(number + i, 0, digits + i, 1);
+    parser.edit(number, strlen(digits), "", 0);
+  }
+  double typeTime = (benchClock() - t0) / typedChars;
+
+  /* putting the pieces together for the tree view */
+  t0 = benchClock();
+  std::unique_ptr<AnalyzeResult> copy = parser.analysis();
+  double copyTime = benchClock() - t0;
+
+  printf("%d statements, %zu bytes, %ld tokens, %ld nodes\n", statements,
+         text.size(), (long)parser.tokenCount(), full->nodes);
+  printf("%-12s %12s %14s %14s\n", "analysis", "ms", "tokens scanned",
+         "stmts parsed");
+  printf("%-12s %12.3f %14ld %14s\n", "analyzeCode", fullTime * 1e3,
+         (long)full->tokens.size(), "");
+  printf("%-12s %12.3f %14ld %14ld\n", "reset", resetTime * 1e3,
+         (long)parser.tokenCount(), (long)statements + 2);
+  for (int k = 0; k < 2; k++)
+    printf("%-12s %12.3f %14.1f %14.1f\n", k ? "edit line" : "edit blank",
+           editTime[k] * 1e3, (double)scanned[k] / edits,
+           (double)parsed[k] / edits);
+  printf("%-12s %12.3f %14s %14ld\n", "open block", openTime * 1e3, "",
+         openParsed);
+  printf("%-12s %12.3f %14s %14s\n", "typing", typeTime * 1e3, "", "");
+  printf("%-12s %12.3f %14ld %14s\n", "analysis()", copyTime * 1e3,
+         (long)copy->tokens.size(), "");
+  printf("%d random edits and %d timed ones checked against analyzeCode\n",
+         fuzz, checked < edits ? checked : edits);
+  return parser.text() == text && sameAsFull(parser, "all edits") ? 0 : 1;
+}
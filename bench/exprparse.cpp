@@ -0,0 +1,400 @@
+/****************************************************/
+/* File: exprparse.cpp                              */
+/* Expression parsing: the binding power loop of    */
+/* parse.cpp against the call chain it replaced     */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "parse.h"
+#include "scan.h"
+#include "util.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* the former expression parser: one function per
+ * precedence level, with the helpers of parse.cpp
+ * it needs; the listing is never written here
+ */
+static void unexpectedToken(CompilerContext &ctx) {
+  std::string message("unexpected token -> ");
+  size_t at = message.size();
+  message.resize(at + tokenText(NULL, 0, ctx.token, ctx.tokenString));
+  tokenText(&message[at], message.size() - at + 1, ctx.token, ctx.tokenString);
+  addDiagnostic(ctx, UnexpectedTokenD, ctx.lineno, tokenColumn(ctx), message);
+  ctx.Error = TRUE;
+}
+
+static void match(CompilerContext &ctx, TokenType expected) {
+  if (ctx.token == expected)
+    ctx.token = getToken(ctx);
+  else
+    unexpectedToken(ctx);
+}
+
+static int tokenValue(CompilerContext &ctx) {
+  int val = 0;
+  for (char c : ctx.tokenString)
+    val = val * 10 + (c - '0');
+  return val;
+}
+
+static void setName(CompilerContext &ctx, TreeNode *t) {
+  if (ctx.names != NULL) {
+    t->symbol = ctx.names->intern(ctx.tokenString);
+    if (t->symbol >= 0) {
+      t->attr.name = (char *)ctx.names->name(t->symbol);
+      return;
+    }
+  }
+  t->attr.name = copyString(ctx, ctx.tokenString);
+}
+
+static TreeNode *chainExp(CompilerContext &ctx);
+static TreeNode *chainFactor(CompilerContext &ctx);
+
+static TreeNode *chainPower(CompilerContext &ctx) {
+  TreeNode *t = chainFactor(ctx);
+  while (ctx.token == POWER) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+      match(ctx, ctx.token);
+      p->child[1] = chainFactor(ctx);
+    }
+  }
+  return t;
+}
+
+static TreeNode *chainNotTerm(CompilerContext &ctx) {
+  TreeNode *t = NULL;
+  if (ctx.token == NOT) {
+    while (ctx.token == NOT) {
+      t = newExpNode(ctx, OpK);
+      if (t != NULL) {
+        t->attr.op = ctx.token;
+        match(ctx, ctx.token);
+        t->child[0] = chainNotTerm(ctx);
+      }
+    }
+  } else {
+    t = chainPower(ctx);
+  }
+  return t;
+}
+
+static TreeNode *chainTerm(CompilerContext &ctx) {
+  TreeNode *t = chainNotTerm(ctx);
+  while ((ctx.token == TIMES) || (ctx.token == OVER) || (ctx.token == REMAIN)) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+      match(ctx, ctx.token);
+      p->child[1] = chainNotTerm(ctx);
+    }
+  }
+  return t;
+}
+
+static TreeNode *chainSimpleExp(CompilerContext &ctx) {
+  TreeNode *t = chainTerm(ctx);
+  while ((ctx.token == PLUS) || (ctx.token == MINUS)) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+      match(ctx, ctx.token);
+      t->child[1] = chainTerm(ctx);
+    }
+  }
+  return t;
+}
+
+static TreeNode *chainAndExp(CompilerContext &ctx) {
+  TreeNode *t = chainSimpleExp(ctx);
+  if ((ctx.token == LT) || (ctx.token == EQ) || (ctx.token == LTE) ||
+      (ctx.token == GTE) || (ctx.token == GT) || (ctx.token == NEQ)) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+    }
+    match(ctx, ctx.token);
+    if (t != NULL)
+      t->child[1] = chainSimpleExp(ctx);
+  }
+  return t;
+}
+
+static TreeNode *chainOrExp(CompilerContext &ctx) {
+  TreeNode *t = chainAndExp(ctx);
+  while (ctx.token == AND) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+    }
+    match(ctx, ctx.token);
+    if (t != NULL)
+      t->child[1] = chainAndExp(ctx);
+  }
+  return t;
+}
+
+static TreeNode *chainExp(CompilerContext &ctx) {
+  TreeNode *t = chainOrExp(ctx);
+  while (ctx.token == OR) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+    }
+    match(ctx, ctx.token);
+    if (t != NULL)
+      t->child[1] = chainOrExp(ctx);
+  }
+  return t;
+}
+
+static TreeNode *chainFactor(CompilerContext &ctx) {
+  TreeNode *t = NULL;
+  switch (ctx.token) {
+  case NUM:
+    t = newExpNode(ctx, ConstK);
+    if ((t != NULL) && (ctx.token == NUM))
+      t->attr.val = tokenValue(ctx);
+    match(ctx, NUM);
+    break;
+  case ID:
+    t = newExpNode(ctx, IdK);
+    if ((t != NULL) && (ctx.token == ID))
+      setName(ctx, t);
+    match(ctx, ID);
+    break;
+  case LPAREN:
+    match(ctx, LPAREN);
+    t = chainExp(ctx);
+    match(ctx, RPAREN);
+    break;
+  default:
+    unexpectedToken(ctx);
+    ctx.token = getToken(ctx);
+    break;
+  }
+  return t;
+}
+
+static int sameDiagnostics(const std::vector<Diagnostic> &a,
+                           const std::vector<Diagnostic> &b) {
+  if (a.size() != b.size())
+    return FALSE;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].line != b[i].line || a[i].column != b[i].column ||
+        a[i].code != b[i].code || a[i].message != b[i].message)
+      return FALSE;
+  return TRUE;
+}
+
+/* sameTree walks both trees in step; with the same
+ * links present at every node, the same order of
+ * nodes means the same shape
+ */
+int sameTree(TreeNode *a, TreeNode *b, int ids) {
+  TreeWalk wa(a), wb(b);
+  int da, db;
+  for (;;) {
+    TreeNode *s = wa.next(&da), *t = wb.next(&db);
+    if (s == NULL || t == NULL)
+      return s == t;
+    if (da != db || s->nodekind != t->nodekind ||
+        s->kind.exp != t->kind.exp || s->lineno != t->lineno ||
+        (ids && s->symbol != t->symbol) || s->type != t->type ||
+        (s->sibling == NULL) != (t->sibling == NULL))
+      return FALSE;
+    for (int i = 0; i < MAXCHILDREN; i++)
+      if ((s->child[i] == NULL) != (t->child[i] == NULL))
+        return FALSE;
+    if (s->nodekind == StmtK || s->kind.exp == IdK) {
+      if ((s->attr.name == NULL) != (t->attr.name == NULL) ||
+          (s->attr.name != NULL && strcmp(s->attr.name, t->attr.name) != 0))
+        return FALSE;
+    } else if (s->kind.exp == OpK ? s->attr.op != t->attr.op
+                                  : s->attr.val != t->attr.val)
+      return FALSE;
+  }
+}
+
+int sameAnalysis(const AnalyzeResult &a, const AnalyzeResult &b, int ids) {
+  if (a.nodes != b.nodes || (ids && a.names.size() != b.names.size()) ||
+      !sameDiagnostics(a.diagnostics, b.diagnostics) ||
+      !sameDiagnostics(a.typeErrors, b.typeErrors) ||
+      !sameTree(a.tree, b.tree, ids))
+    return FALSE;
+  for (int i = 0; ids && i < a.names.size(); i++)
+    if (strcmp(a.names.name(i), b.names.name(i)) != 0)
+      return FALSE;
+  const SymbolTable &s = a.symbols, &t = b.symbols;
+  if (s.size() != t.size())
+    return FALSE;
+  for (int id = 0; id < s.size(); id++) {
+    SymbolTable::LineList l = s.references(id), m = t.references(id);
+    if (s.name(id) != t.name(id) || s.location(id) != t.location(id) ||
+        s.declared(id) != t.declared(id) || l.count != m.count ||
+        memcmp(l.lines, m.lines, l.count * sizeof(int)) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+int sameTokens(const AnalyzeResult &a, const AnalyzeResult &b) {
+  if (a.tokens.size() != b.tokens.size())
+    return FALSE;
+  for (size_t i = 0; i < a.tokens.size(); i++) {
+    const Token &s = a.tokens[i], &t = b.tokens[i];
+    if (s.offset != t.offset || s.length != t.length || s.line != t.line ||
+        s.type != t.type)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Parsed is one parser's result on a token buffer */
+struct Parsed {
+  Arena arena;
+  std::vector<Diagnostic> diagnostics;
+  std::vector<TreeNode *> trees;
+  size_t tokenNext = 0;
+  long nodes = 0;
+};
+
+/* parseAll parses an expression at each of starts
+ * in tokens of text, with the new parser unless
+ * chain is set
+ */
+static void parseAll(const std::string &text, const std::vector<Token> &tokens,
+                     const std::vector<size_t> &starts, int chain,
+                     Parsed &out) {
+  InternTable names{out.arena};
+  CompilerContext ctx;
+  ctx.text = text.data();
+  ctx.textsize = text.size();
+  ctx.tokenArray = tokens.data();
+  ctx.tokenCount = tokens.size();
+  ctx.arena = &out.arena;
+  ctx.names = &names;
+  ctx.diagnostics = &out.diagnostics;
+  for (size_t start : starts) {
+    ctx.tokenNext = start;
+    ctx.token = getToken(ctx);
+    out.trees.push_back(chain ? chainExp(ctx) : parseExpression(ctx));
+  }
+  out.tokenNext = ctx.tokenNext;
+  out.nodes = ctx.nodes;
+}
+
+/* sameParse compares the two parsers on text, with
+ * an expression at each of starts
+ */
+static int sameParse(const std::string &text, const std::vector<Token> &tokens,
+                     const std::vector<size_t> &starts) {
+  Parsed a, b;
+  parseAll(text, tokens, starts, FALSE, a);
+  parseAll(text, tokens, starts, TRUE, b);
+  if (a.tokenNext != b.tokenNext || a.nodes != b.nodes ||
+      !sameDiagnostics(a.diagnostics, b.diagnostics))
+    return FALSE;
+  for (size_t i = 0; i < a.trees.size(); i++)
+    if (!sameTree(a.trees[i], b.trees[i]))
+      return FALSE;
+  return TRUE;
+}
+
+static void scanText(const std::string &text, std::vector<Token> &tokens) {
+  CompilerContext ctx;
+  setScanBuffer(ctx, text.data(), text.size());
+  tokens.clear();
+  tokenize(ctx, tokens);
+}
+
+/* randomExpression returns up to n tokens of
+ * expression syntax in any order, mostly malformed
+ */
+static std::string randomExpression(std::mt19937 &rng, int n) {
+  static const char *const words[] = {
+      "a",  "b", "7", "42", "(", ")", "not", "and", "or", "+",  "-",
+      "*",  "/", "%", "^",  "<", "<=", "=",  "<>",  ">",  ">=", ";"};
+  const int nwords = (int)(sizeof(words) / sizeof(words[0]));
+  std::string s;
+  for (int i = 1 + (int)(rng() % n); i > 0; i--) {
+    s += words[rng() % nwords];
+    s += rng() % 8 ? " " : "\n";
+  }
+  return s;
+}
+
+int benchExpressions(int argc, char *argv[]) {
+  size_t bytes = argc > 0 ? (size_t)atol(argv[0]) : 4u << 20;
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  int fuzz = argc > 2 ? atoi(argv[2]) : 20000;
+
+  /* malformed input: trees and diagnostics agree */
+  std::mt19937 rng(20241018);
+  std::vector<Token> tokens;
+  std::vector<size_t> starts{0};
+  for (int i = 0; i < fuzz; i++) {
+    std::string text = randomExpression(rng, 30);
+    scanText(text, tokens);
+    if (!sameParse(text, tokens, starts)) {
+      fprintf(stderr, "parsers differ on:\n%s\n", text.c_str());
+      return 1;
+    }
+  }
+
+  /* the right side of every assignment of an
+   * expression-heavy program
+   */
+  std::string text = generateProgram(ExpressionShape, bytes, 1);
+  scanText(text, tokens);
+  starts.clear();
+  for (size_t i = 1; i < tokens.size(); i++)
+    if (tokens[i].type == ASSIGN)
+      starts.push_back(i + 1);
+  if (!sameParse(text, tokens, starts)) {
+    fprintf(stderr, "parsers differ on the generated program\n");
+    return 1;
+  }
+
+  double best[2] = {1e30, 1e30};
+  long nodes = 0;
+  for (int r = 0; r < rounds; r++)
+    for (int chain = 0; chain < 2; chain++) {
+      Parsed out;
+      double t0 = benchClock();
+      parseAll(text, tokens, starts, chain, out);
+      double t = benchClock() - t0;
+      if (t < best[chain])
+        best[chain] = t;
+      nodes = out.nodes;
+    }
+  printf("%d random expressions and %zu generated ones parse alike\n", fuzz,
+         starts.size());
+  printf("%-8s %10s %12s %10s\n", "parser", "ms", "Mtokens/s", "ns/node");
+  static const char *const names[] = {"powers", "chain"};
+  for (int chain = 0; chain < 2; chain++)
+    printf("%-8s %10.2f %12.1f %10.2f\n", names[chain], best[chain] * 1e3,
+           tokens.size() / best[chain] / 1e6, best[chain] / nodes * 1e9);
+  printf("speedup  %.2fx\n", best[1] / best[0]);
+  return 0;
+}
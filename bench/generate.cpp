@@ -0,0 +1,350 @@
+/****************************************************/
+/* File: generate.cpp                               */
+/* Synthetic TINY programs for the benchmarks       */
+/****************************************************/
+
+#include "bench.h"
+#include "scan.h"
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+std::string sampleProgram(int n) {
+  std::string s = "read x;\n";
+  char line[160];
+  for (int i = 0; i < n; i++) {
+    snprintf(line, sizeof(line),
+             "for i := 1 to x do { step %d }\n"
+             "  if (i %% 3 = 0) s += i * %d else s := s - (i ^ 2);\n"
+             "  write s and not (i <> x)\nenddo;\n",
+             i, i);
+    s += line;
+  }
+  s += "write s\n";
+  return s;
+}
+
+const char *const shapeNames[NSHAPES] = {"straight", "nested",  "expression",
+                                         "comment",  "regex",   "mixed"};
+
+/* Generator writes one program following the
+ * grammar of parse.cpp, so every program it makes
+ * parses without diagnostics
+ */
+struct Generator {
+  std::mt19937 rng;
+  std::string out;
+  int width;  /* most operands per operator chain */
+  int indent; /* current block depth */
+
+  int pick(int n) { return (int)(rng() % (unsigned)n); }
+  bool chance(int percent) { return pick(100) < percent; }
+
+  void newline() {
+    out += '\n';
+    out.append(2 * indent, ' ');
+  }
+
+  void name() {
+    static const char *const names[] = {"x",     "y",   "i",     "j",
+                                        "count", "sum", "total", "limit",
+                                        "value", "acc", "n",     "step"};
+    if (chance(80)) {
+      out += names[pick(sizeof(names) / sizeof(names[0]))];
+      return;
+    }
+    std::string s;
+    for (int n = 1 + pick(10); n > 0; n--)
+      s += (char)((chance(80) ? 'a' : 'A') + pick(26));
+    /* a name must not spell a reserved word */
+    while (reservedLookup(s) != ID)
+      s += 'x';
+    out += s;
+  }
+
+  void number() { out += std::to_string(chance(70) ? pick(100) : rng() % 100000); }
+
+  /* the expression functions follow the grammar
+   * levels exp .. factor whose binding powers
+   * parse.cpp keeps; depth bounds the parentheses
+   */
+  void factor(int depth) {
+    if (depth > 0 && chance(20)) {
+      out += '(';
+      exp(depth - 1);
+      out += ')';
+    } else if (chance(50))
+      name();
+    else
+      number();
+  }
+
+  void power(int depth) {
+    factor(depth);
+    for (int n = chance(15) ? 1 + pick(2) : 0; n > 0; n--) {
+      out += " ^ ";
+      factor(depth);
+    }
+  }
+
+  void notTerm(int depth) {
+    if (chance(10))
+      out += "not ";
+    power(depth);
+  }
+
+  void term(int depth) {
+    static const char *const ops[] = {" * ", " / ", " % "};
+    notTerm(depth);
+    for (int n = pick(width); n > 0; n--) {
+      out += ops[pick(3)];
+      notTerm(depth);
+    }
+  }
+
+  void simpleExp(int depth) {
+    term(depth);
+    for (int n = pick(width); n > 0; n--) {
+      out += chance(50) ? " + " : " - ";
+      term(depth);
+    }
+  }
+
+  void andExp(int depth) {
+    static const char *const ops[] = {" < ", " <= ", " > ",
+                                      " >= ", " = ", " <> "};
+    simpleExp(depth);
+    if (chance(30)) {
+      out += ops[pick(6)];
+      simpleExp(depth);
+    }
+  }
+
+  void orExp(int depth) {
+    andExp(depth);
+    for (int n = chance(30) ? pick(width) : 0; n > 0; n--) {
+      out += " and ";
+      andExp(depth);
+    }
+  }
+
+  void exp(int depth) {
+    orExp(depth);
+    for (int n = chance(30) ? pick(width) : 0; n > 0; n--) {
+      out += " or ";
+      orExp(depth);
+    }
+  }
+
+  void regFactor(int depth) {
+    if (depth > 0 && chance(30)) {
+      out += '(';
+      regUnion(depth - 1);
+      out += ')';
+    } else if (chance(80))
+      name();
+    else
+      number();
+    while (chance(25))
+      out += chance(50) ? "#" : "?";
+  }
+
+  void regConcat(int depth) {
+    regFactor(depth);
+    for (int n = pick(width); n > 0; n--) {
+      out += " & ";
+      regFactor(depth);
+    }
+  }
+
+  void regUnion(int depth) {
+    regConcat(depth);
+    for (int n = pick(width); n > 0; n--) {
+      out += " | ";
+      regConcat(depth);
+    }
+  }
+
+  void comment(int length) {
+    static const char *const words[] = {
+        "the",  "loop", "sums",    "every", "value", "until", "limit",
+        "then", "it",   "reports", "count", "of",    "steps", "taken"};
+    out += "{ ";
+    for (int n = 0; n < length;) {
+      const char *w = words[pick(sizeof(words) / sizeof(words[0]))];
+      out += w;
+      n += (int)strlen(w) + 1;
+      if (chance(8))
+        newline();
+      else
+        out += ' ';
+    }
+    out += '}';
+    newline();
+  }
+
+  /* simple writes a statement without blocks */
+  void simple(int depth) {
+    switch (pick(5)) {
+    case 0:
+      out += "read ";
+      name();
+      break;
+    case 1:
+      out += "write ";
+      exp(depth);
+      break;
+    case 2:
+      name();
+      out += " += ";
+      exp(depth);
+      break;
+    default:
+      name();
+      out += " := ";
+      exp(depth);
+      break;
+    }
+  }
+
+  /* block writes one of the compound statements
+   * around body, which writes a sequence; an else
+   * part gets a few simple statements
+   */
+  template <typename Body> void block(int kind, Body body) {
+    switch (kind) {
+    case 0:
+      out += "if (";
+      exp(1);
+      out += ") [";
+      indent++;
+      newline();
+      body();
+      indent--;
+      newline();
+      out += ']';
+      if (chance(50)) {
+        out += " else [";
+        indent++;
+        newline();
+        sequence(0, 1 + pick(3));
+        indent--;
+        newline();
+        out += ']';
+      }
+      break;
+    case 1:
+      out += "repeat";
+      indent++;
+      newline();
+      body();
+      indent--;
+      newline();
+      out += "until ";
+      exp(1);
+      break;
+    default:
+      out += "for ";
+      name();
+      out += " := ";
+      simpleExp(0);
+      out += chance(50) ? " to " : " downto ";
+      simpleExp(0);
+      out += " do";
+      indent++;
+      newline();
+      body();
+      indent--;
+      newline();
+      out += "enddo";
+      break;
+    }
+  }
+
+  /* statement writes a statement with blocks at
+   * most depth deep
+   */
+  void statement(int depth) {
+    if (depth > 0 && chance(25))
+      block(pick(3), [&] { sequence(depth - 1, 1 + pick(4)); });
+    else
+      simple(1);
+  }
+
+  void sequence(int depth, int n) {
+    for (int i = 0; i < n; i++) {
+      if (i > 0) {
+        out += ';';
+        newline();
+      }
+      statement(depth);
+    }
+  }
+
+  /* nest writes blocks depth deep around a single
+   * assignment
+   */
+  void nest(int depth) {
+    if (depth == 0)
+      simple(0);
+    else
+      block(pick(3), [&] { nest(depth - 1); });
+  }
+
+  /* one top-level statement of the given shape */
+  void topLevel(ProgramShape shape) {
+    switch (shape) {
+    case StraightShape:
+      name();
+      out += " := ";
+      simpleExp(0);
+      break;
+    case NestedShape:
+      nest(100 + pick(400));
+      break;
+    case ExpressionShape:
+      name();
+      out += " := ";
+      exp(2);
+      break;
+    case CommentShape:
+      comment(200 + pick(2000));
+      simple(0);
+      break;
+    case RegexShape:
+      name();
+      out += " ::= ";
+      regUnion(3);
+      break;
+    default:
+      if (chance(10))
+        comment(20 + pick(200));
+      statement(3);
+      break;
+    }
+  }
+};
+
+std::string generateProgram(ProgramShape shape, size_t bytes, unsigned seed) {
+  Generator g;
+  g.rng.seed(seed * 31u + (unsigned)shape);
+  g.width = shape == ExpressionShape ? 6 : 3;
+  g.indent = 0;
+  g.out.reserve(bytes + 4096);
+  while (g.out.size() < bytes) {
+    if (!g.out.empty()) {
+      g.out += ';';
+      g.newline();
+    }
+    g.topLevel(shape);
+  }
+  g.out += '\n';
+  return g.out;
+}
+
+std::string damage(std::string text, int n, unsigned seed) {
+  std::mt19937 rng(seed);
+  for (int i = 0; i < n && !text.empty(); i++)
+    text.erase(rng() % text.size(), 1);
+  return text;
+}
@@ -0,0 +1,155 @@
+/****************************************************/
+/* File: pipe.cpp                                   */
+/* Programs read through a pipe: read whole, then   */
+/* analyzed, against the scanner and parser running */
+/* on two threads                                   */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* the writer end of the pipe is fed this much at a
+ * time, like a producer upstream of a shell pipe
+ */
+#define WRITEBLOCK 4096
+
+#ifdef _WIN32
+#define pipe(fds) _pipe(fds, 1 << 16, _O_BINARY)
+#define write _write
+#define close _close
+#define fdopen _fdopen
+#endif
+
+/* writeAll writes text to fd and closes it */
+static void writeAll(int fd, const std::string &text) {
+  size_t done = 0;
+  while (done < text.size()) {
+    size_t n = text.size() - done < WRITEBLOCK ? text.size() - done : WRITEBLOCK;
+    long w = (long)write(fd, text.data() + done, (unsigned)n);
+    if (w <= 0)
+      break;
+    done += (size_t)w;
+  }
+  close(fd);
+}
+
+/* throughPipe analyzes text as it arrives from a
+ * pipe fed by another thread; seconds receives the
+ * time from the first byte written to the result
+ */
+static std::unique_ptr<AnalyzeResult>
+throughPipe(const std::string &text, int pipelined, double *seconds) {
+  int fds[2];
+  if (pipe(fds) != 0)
+    return NULL;
+  FILE *in = fdopen(fds[0], "rb");
+  if (in == NULL) {
+    close(fds[0]);
+    close(fds[1]);
+    return NULL;
+  }
+  double t0 = benchClock();
+  std::thread writer(writeAll, fds[1], std::cref(text));
+  std::unique_ptr<AnalyzeResult> result = analyzeStream(in, pipelined);
+  *seconds = benchClock() - t0;
+  writer.join();
+  fclose(in);
+  return result;
+}
+
+/* checkPipe returns TRUE if both ways of reading
+ * text from a pipe give the analysis of analyzeCode
+ */
+static int checkPipe(const std::string &text, const char *what) {
+  std::unique_ptr<AnalyzeResult> a = analyzeCode(text.data(), text.size());
+  for (int pipelined = 0; pipelined < 2; pipelined++) {
+    double t;
+    std::unique_ptr<AnalyzeResult> b = throughPipe(text, pipelined, &t);
+    if (b == NULL) {
+      fprintf(stderr, "cannot open a pipe\n");
+      return FALSE;
+    }
+    if (!sameAnalysis(*a, *b) || !sameTokens(*a, *b)) {
+      fprintf(stderr, "%s, %s: differs\n", what,
+              pipelined ? "pipelined" : "read whole");
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+int benchPipe(int argc, char *argv[]) {
+  size_t bytes = argc > 0 ? (size_t)atol(argv[0]) : 32u << 20;
+  int rounds = argc > 1 ? atoi(argv[1]) : 3;
+
+  /* every shape, whole and damaged, large enough to
+   * fill the ring many times; then texts that end
+   * early or in the middle of a line or comment
+   */
+  int checked = 0;
+  for (int shape = 0; shape < NSHAPES; shape++)
+    for (int damaged = 0; damaged < 2; damaged++) {
+      std::string text = generateProgram((ProgramShape)shape, 1 << 20, 7);
+      if (damaged)
+        text = damage(text, 200, shape);
+      std::string what = std::string(damaged ? "damaged " : "") +
+                         shapeNames[shape] + " program";
+      if (!checkPipe(text, what.c_str()))
+        return 1;
+      checked++;
+    }
+  const char *edges[] = {"", "\n", "x := 1", "x := 1;\n{ open",
+                         "read x;\nwrite x\n\n\n"};
+  for (const char *edge : edges) {
+    if (!checkPipe(edge, "short text"))
+      return 1;
+    checked++;
+  }
+  std::string longLine = generateProgram(MixedShape, 1 << 20, 3);
+  for (char &c : longLine)
+    if (c == '\n')
+      c = ' ';
+  if (!checkPipe(longLine, "program on one line"))
+    return 1;
+  checked++;
+  printf("%d programs read through a pipe equal analyzeCode\n", checked);
+
+  std::string text = generateProgram(MixedShape, bytes, 1);
+  double whole = 1e30, pipelined = 1e30;
+  long nodes = 0;
+  for (int r = 0; r < rounds; r++) {
+    double t;
+    std::unique_ptr<AnalyzeResult> a = throughPipe(text, FALSE, &t);
+    if (t < whole)
+      whole = t;
+    std::unique_ptr<AnalyzeResult> b = throughPipe(text, TRUE, &t);
+    if (t < pipelined)
+      pipelined = t;
+    if (a == NULL || b == NULL || !sameAnalysis(*a, *b)) {
+      fprintf(stderr, "pipelined analysis differs\n");
+      return 1;
+    }
+    nodes = a->nodes;
+  }
+  printf("%zu bytes, %ld nodes, %u hardware threads\n", text.size(), nodes,
+         std::thread::hardware_concurrency());
+  printf("%-10s %10s %10s\n", "analysis", "ms", "MB/s");
+  printf("%-10s %10.2f %10.1f\n", "read whole", whole * 1e3,
+         text.size() / whole / 1e6);
+  printf("%-10s %10.2f %10.1f\n", "pipelined", pipelined * 1e3,
+         text.size() / pipelined / 1e6);
+  printf("speedup    %.2fx\n", whole / pipelined);
+  return 0;
+}
@@ -0,0 +1,86 @@
+/****************************************************/
+/* File: reserved.cpp                               */
+/* Reserved word lookup: perfect hash against the   */
+/* linear strcmp search the scanner used to do      */
+/****************************************************/
+
+#include "bench.h"
+#include "scan.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/* the former reservedLookup */
+static TokenType linearLookup(std::string_view s) {
+  int i;
+  for (i = 0; i < MAXRESERVED; i++)
+    if (s == reservedWords[i].str)
+      return reservedWords[i].tok;
+  return ID;
+}
+
+/* identifierCorpus returns n lexemes shaped like
+ * scanner output: one in five a reserved word, the
+ * rest identifiers of 1 to 10 letters
+ */
+static std::vector<std::string> identifierCorpus(int n) {
+  std::mt19937 rng(20240611);
+  std::vector<std::string> words;
+  words.reserve(n);
+  for (int i = 0; i < n; i++) {
+    if (rng() % 5 == 0)
+      words.emplace_back(reservedWords[rng() % MAXRESERVED].str);
+    else {
+      std::string w(1 + rng() % 10, 'a');
+      for (char &c : w)
+        c = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"[rng() % 52];
+      words.push_back(w);
+    }
+  }
+  return words;
+}
+
+template <class Lookup>
+static double timeLookup(const std::vector<std::string_view> &words,
+                         int rounds, Lookup lookup, long *checksum) {
+  long sum = 0;
+  double t0 = benchClock();
+  for (int r = 0; r < rounds; r++)
+    for (std::string_view w : words)
+      sum += lookup(w);
+  double t = benchClock() - t0;
+  *checksum = sum;
+  return t;
+}
+
+int benchReserved(int argc, char *argv[]) {
+  int n = argc > 0 ? atoi(argv[0]) : 1 << 16;
+  int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  std::vector<std::string> corpus = identifierCorpus(n);
+  std::vector<std::string_view> words(corpus.begin(), corpus.end());
+
+  for (std::string_view w : words)
+    if (reservedLookup(w) != linearLookup(w)) {
+      fprintf(stderr, "lookup mismatch on \"%.*s\"\n", (int)w.size(),
+              w.data());
+      return 1;
+    }
+
+  long hashSum, linearSum;
+  double hashTime = timeLookup(
+      words, rounds, [](std::string_view w) { return reservedLookup(w); },
+      &hashSum);
+  double linearTime = timeLookup(
+      words, rounds, [](std::string_view w) { return linearLookup(w); },
+      &linearSum);
+  double lookups = (double)n * rounds;
+  printf("%-8s %12s %10s\n", "lookup", "Mlookups/s", "ns/lookup");
+  printf("%-8s %12.1f %10.2f\n", "hash", lookups / hashTime / 1e6,
+         hashTime / lookups * 1e9);
+  printf("%-8s %12.1f %10.2f\n", "linear", lookups / linearTime / 1e6,
+         linearTime / lookups * 1e9);
+  printf("speedup  %.2fx\n", linearTime / hashTime);
+  return hashSum == linearSum ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/****************************************************/
+/* File: scanrate.cpp                               */
+/* Scanner throughput with and without the kernels  */
+/* that skip runs of characters                     */
+/****************************************************/
+
+#include "bench.h"
+#include "scan.h"
+#include "source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/* scanRate tokenizes text rounds times and returns
+ * the seconds each round took
+ */
+static double scanRate(const std::string &text, int rounds,
+                       std::vector<Token> &tokens) {
+  double t0 = benchClock();
+  for (int r = 0; r < rounds; r++) {
+    CompilerContext ctx;
+    setScanBuffer(ctx, text.data(), text.size());
+    tokens.clear();
+    tokenize(ctx, tokens);
+  }
+  return (benchClock() - t0) / rounds;
+}
+
+static bool sameTokens(const std::vector<Token> &a,
+                       const std::vector<Token> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].offset != b[i].offset || a[i].length != b[i].length ||
+        a[i].line != b[i].line || a[i].type != b[i].type)
+      return false;
+  return true;
+}
+
+int benchScan(int argc, char *argv[]) {
+  int rounds = argc > 0 ? atoi(argv[0]) : 20;
+  SourceBuffer file;
+  std::string text;
+  if (argc > 1) {
+    if (!file.map(argv[1])) {
+      fprintf(stderr, "cannot read %s\n", argv[1]);
+      return 1;
+    }
+    text.assign(file.data(), file.size());
+  } else
+    text = sampleProgram(50000);
+
+  std::vector<Token> plain, fast;
+  ScanKernels = FALSE;
+  double plainTime = scanRate(text, rounds, plain);
+  ScanKernels = TRUE;
+  double fastTime = scanRate(text, rounds, fast);
+
+  printf("%zu bytes, %zu tokens\n", text.size(), plain.size());
+  printf("%-16s %10s %10s %12s\n", "scanner", "ms", "MB/s", "Mtokens/s");
+  printf("%-16s %10.3f %10.1f %12.1f\n", "per character", plainTime * 1e3,
+         text.size() / plainTime / 1e6, plain.size() / plainTime / 1e6);
+  printf("%-16s %10.3f %10.1f %12.1f\n",
+         (std::string("kernels: ") + scanKernel()).c_str(), fastTime * 1e3,
+         text.size() / fastTime / 1e6, fast.size() / fastTime / 1e6);
+  return sameTokens(plain, fast) ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/****************************************************/
+/* File: suite.cpp                                  */
+/* Front-end benchmark suite: getToken, parse,      */
+/* printTree, nodeLabel and analyzeCode on          */
+/* generated programs of every shape, as JSON       */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "parse.h"
+#include "scan.h"
+#include "util.h"
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/* every operator new of the program is counted, so
+ * a phase can report what it allocated on the heap
+ */
+static std::atomic<size_t> heapBytes(0);
+
+void *operator new(size_t size) {
+  heapBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+/* peakRss returns the most memory the process has
+ * had resident so far, in bytes
+ */
+static size_t peakRss(void) {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return pmc.PeakWorkingSetSize;
+  return 0;
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+#ifdef __APPLE__
+  return (size_t)ru.ru_maxrss;
+#else
+  return (size_t)ru.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+#ifdef _WIN32
+#define NULLDEVICE "NUL"
+#else
+#define NULLDEVICE "/dev/null"
+#endif
+
+typedef enum {
+  ScanPhase,
+  ParsePhase,
+  PrintPhase,
+  LabelPhase,
+  AnalyzePhase
+} Phase;
+#define NPHASES 5
+
+static const char *const phaseNames[NPHASES] = {
+    "getToken", "parse", "printTree", "nodeLabel", "analyzeCode"};
+
+/* labelTree formats the label of every node as the
+ * Dialog does and returns the total length
+ */
+static size_t labelTree(TreeNode *tree) {
+  size_t n = 0;
+  char buf[128];
+  TreeWalk walk(tree);
+  const TreeNode *t;
+  while ((t = walk.next()) != NULL)
+    n += nodeLabel(buf, sizeof(buf), t);
+  return n;
+}
+
+/* Measure is one row of the results: the fastest
+ * of the rounds, and what one round produced
+ */
+struct Measure {
+  double seconds;
+  long tokens;
+  long nodes;
+  size_t allocated; /* heap and arena bytes */
+  size_t diagnostics;
+};
+
+/* runPhase runs phase once over text; tokens and
+ * tree are those of text, for the phases that
+ * start from them
+ */
+static Measure runPhase(Phase phase, const std::string &text,
+                        const std::vector<Token> &tokens,
+                        const AnalyzeResult &tree, FILE *sink) {
+  Measure m = {0, 0, 0, 0, 0};
+  size_t heap = heapBytes.load(std::memory_order_relaxed);
+  double t0 = benchClock();
+  switch (phase) {
+  case ScanPhase: {
+    CompilerContext ctx;
+    setScanBuffer(ctx, text.data(), text.size());
+    while (getToken(ctx) != ENDFILE)
+      m.tokens++;
+    m.tokens++;
+    break;
+  }
+  case ParsePhase: {
+    Arena arena;
+    InternTable names(arena);
+    std::vector<Diagnostic> diagnostics;
+    CompilerContext ctx;
+    ctx.arena = &arena;
+    ctx.names = &names;
+    ctx.diagnostics = &diagnostics;
+    ctx.text = text.data();
+    ctx.textsize = text.size();
+    ctx.tokenArray = tokens.data();
+    ctx.tokenCount = tokens.size();
+    parse(ctx);
+    m.seconds = benchClock() - t0;
+    m.tokens = (long)tokens.size();
+    m.nodes = ctx.nodes;
+    m.allocated = arena.bytesReserved();
+    m.diagnostics = diagnostics.size();
+    break;
+  }
+  case PrintPhase:
+    printTree(sink, tree.tree);
+    fflush(sink);
+    m.tokens = (long)tree.tokens.size();
+    m.nodes = tree.nodes;
+    break;
+  case LabelPhase:
+    if (labelTree(tree.tree) == 0 && tree.nodes > 0)
+      m.diagnostics = 1;
+    m.tokens = (long)tree.tokens.size();
+    m.nodes = tree.nodes;
+    break;
+  case AnalyzePhase: {
+    std::unique_ptr<AnalyzeResult> r = analyzeCode(text.data(), text.size());
+    m.seconds = benchClock() - t0;
+    m.tokens = (long)r->tokens.size();
+    m.nodes = r->nodes;
+    m.allocated = r->arena.bytesReserved();
+    m.diagnostics = r->diagnostics.size();
+    break;
+  }
+  }
+  /* parse and analyzeCode stop the clock before
+   * their results are freed
+   */
+  if (m.seconds == 0)
+    m.seconds = benchClock() - t0;
+  m.allocated += heapBytes.load(std::memory_order_relaxed) - heap;
+  return m;
+}
+
+int benchSuite(int argc, char *argv[]) {
+  size_t bytes = argc > 0 ? (size_t)atol(argv[0]) : 4000000;
+  unsigned seed = argc > 1 ? (unsigned)atol(argv[1]) : 1;
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  const char *jsonPath = argc > 3 ? argv[3] : NULL;
+  if (rounds < 1)
+    rounds = 1;
+  FILE *sink = fopen(NULLDEVICE, "w");
+  FILE *json = stdout;
+  if (sink == NULL ||
+      (jsonPath != NULL && strcmp(jsonPath, "-") &&
+       (json = fopen(jsonPath, "w")) == NULL)) {
+    fprintf(stderr, "cannot open %s\n", sink ? jsonPath : NULLDEVICE);
+    return 1;
+  }
+
+  if (jsonPath != NULL)
+    fprintf(json,
+            "{\"suite\":{\"bytes\":%zu,\"seed\":%u,\"rounds\":%d,"
+            "\"kernel\":\"%s\"},\n\"results\":[",
+            bytes, seed, rounds, scanKernel());
+  printf("%-10s %-11s %10s %10s %10s %12s %10s\n", "corpus", "phase", "ms",
+         "Mtokens/s", "Mnodes/s", "allocated", "peak RSS");
+  int failed = 0;
+  for (int s = 0; s < NSHAPES; s++) {
+    std::string text = generateProgram((ProgramShape)s, bytes, seed);
+    std::unique_ptr<AnalyzeResult> tree =
+        analyzeCode(text.data(), text.size());
+    for (int p = 0; p < NPHASES; p++) {
+      Measure best;
+      for (int r = 0; r < rounds; r++) {
+        Measure m = runPhase((Phase)p, text, tree->tokens, *tree, sink);
+        if (r == 0 || m.seconds < best.seconds)
+          best = m;
+      }
+      size_t rss = peakRss();
+      failed |= best.diagnostics != 0;
+      printf("%-10s %-11s %10.3f %10.2f %10.2f %12zu %10zu\n", shapeNames[s],
+             phaseNames[p], best.seconds * 1e3,
+             best.tokens / best.seconds / 1e6, best.nodes / best.seconds / 1e6,
+             best.allocated, rss);
+      if (jsonPath != NULL)
+        fprintf(json,
+                "%s\n{\"corpus\":\"%s\",\"phase\":\"%s\",\"bytes\":%zu,"
+                "\"seconds\":%.6f,\"tokens\":%ld,\"nodes\":%ld,"
+                "\"tokens_per_s\":%.1f,\"nodes_per_s\":%.1f,"
+                "\"bytes_allocated\":%zu,\"peak_rss\":%zu}",
+                s + p ? "," : "", shapeNames[s], phaseNames[p], text.size(),
+                best.seconds, best.tokens, best.nodes,
+                best.tokens / best.seconds, best.nodes / best.seconds,
+                best.allocated, rss);
+    }
+  }
+  if (jsonPath != NULL)
+    fputs("\n]}\n", json);
+  if (json != stdout)
+    fclose(json);
+  fclose(sink);
+  return failed;
+}
@@ -0,0 +1,213 @@
+/****************************************************/
+/* File: symbols.cpp                                */
+/* Symbol table pass: open addressing over flat     */
+/* arrays against the chained buckets of st_insert  */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "util.h"
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/* the former table: SIZE buckets of names, each
+ * with a linked list of its lines, as in Louden
+ */
+#define SIZE 211
+#define SHIFT 4
+
+/* st_insert walks a whole bucket, so with this many
+ * names or more the chained table is not timed
+ */
+#define CHAINEDMAX 200000
+
+typedef struct LineListRec {
+  int lineno;
+  struct LineListRec *next;
+} * LineList;
+
+typedef struct BucketListRec {
+  const char *name;
+  LineList lines;
+  int memloc;
+  struct BucketListRec *next;
+} * BucketList;
+
+struct ChainedTable {
+  BucketList hashTable[SIZE] = {};
+  int count = 0;
+};
+
+static int hash(const char *key) {
+  int temp = 0;
+  int i = 0;
+  while (key[i] != '\0') {
+    temp = ((temp << SHIFT) + key[i]) % SIZE;
+    ++i;
+  }
+  return temp;
+}
+
+static void st_insert(ChainedTable &st, const char *name, int lineno,
+                      int loc) {
+  int h = hash(name);
+  BucketList l = st.hashTable[h];
+  while ((l != NULL) && (strcmp(name, l->name) != 0))
+    l = l->next;
+  if (l == NULL) { /* variable not yet in table */
+    l = (BucketList)malloc(sizeof(struct BucketListRec));
+    l->name = name;
+    l->lines = (LineList)malloc(sizeof(struct LineListRec));
+    l->lines->lineno = lineno;
+    l->memloc = loc;
+    l->lines->next = NULL;
+    l->next = st.hashTable[h];
+    st.hashTable[h] = l;
+    st.count++;
+  } else { /* found in table, so just add line number */
+    LineList t = l->lines;
+    while (t->next != NULL)
+      t = t->next;
+    t->next = (LineList)malloc(sizeof(struct LineListRec));
+    t->next->lineno = lineno;
+    t->next->next = NULL;
+  }
+}
+
+static BucketList st_find(const ChainedTable &st, const char *name) {
+  BucketList l = st.hashTable[hash(name)];
+  while ((l != NULL) && (strcmp(name, l->name) != 0))
+    l = l->next;
+  return l;
+}
+
+static void st_free(ChainedTable &st) {
+  for (BucketList &b : st.hashTable)
+    while (b != NULL) {
+      BucketList next = b->next;
+      while (b->lines != NULL) {
+        LineList l = b->lines->next;
+        free(b->lines);
+        b->lines = l;
+      }
+      free(b);
+      b = next;
+    }
+}
+
+/* buildChained fills st like buildSymtab would */
+static void buildChained(ChainedTable &st, TreeNode *tree) {
+  TreeWalk walk(tree);
+  TreeNode *t;
+  while ((t = walk.next()) != NULL) {
+    int named = t->nodekind == ExpK
+                    ? t->kind.exp == IdK
+                    : t->kind.stmt == AssignK || t->kind.stmt == PlusEqK ||
+                          t->kind.stmt == ReadK || t->kind.stmt == RegK;
+    if (named && t->attr.name != NULL)
+      st_insert(st, t->attr.name, t->lineno, st.count);
+  }
+}
+
+/* sameTables returns TRUE if both tables hold the
+ * same variables, locations and lines
+ */
+static int sameTables(const SymbolTable &st, const ChainedTable &chained) {
+  if (st.size() != chained.count)
+    return FALSE;
+  for (int id = 0; id < st.size(); id++) {
+    std::string name(st.name(id));
+    BucketList b = st_find(chained, name.c_str());
+    if (b == NULL || b->memloc != st.location(id) ||
+        b->lines->lineno != st.declared(id))
+      return FALSE;
+    SymbolTable::LineList lines = st.references(id);
+    LineList l = b->lines;
+    for (size_t i = 0; i < lines.count; i++, l = l->next)
+      if (l == NULL || l->lineno != lines.lines[i])
+        return FALSE;
+    if (l != NULL)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* variableName spells i in letters, since TINY
+ * identifiers have no digits
+ */
+static std::string variableName(int i) {
+  std::string s = "v";
+  do {
+    s += (char)('a' + i % 26);
+    i /= 26;
+  } while (i > 0);
+  return s;
+}
+
+/* namesProgram returns a program of n statements
+ * that declare n variables, each one assigned from
+ * an earlier one and read again now and then
+ */
+static std::string namesProgram(int n) {
+  std::mt19937 rng(n);
+  std::string out = "read " + variableName(0);
+  for (int i = 1; i < n; i++) {
+    out += ";\n" + variableName(i) + " := " + variableName(rng() % i) + " + " +
+           std::to_string(i);
+    if (rng() % 8 == 0)
+      out += ";\nwrite " + variableName(rng() % (i + 1));
+  }
+  out += "\n";
+  return out;
+}
+
+int benchSymbols(int argc, char *argv[]) {
+  int most = argc > 0 ? atoi(argv[0]) : 1000000;
+  int rounds = argc > 1 ? atoi(argv[1]) : 3;
+  printf("%-8s %10s %10s %10s %10s %10s\n", "names", "refs", "parse ms",
+         "symtab ms", "ns/ref", "chained ms");
+  for (int n = 1000; n <= most; n *= 10) {
+    std::string text = namesProgram(n);
+    double parse = 1e30, symtab = 1e30, chained = 1e30;
+    long refs = 0;
+    for (int r = 0; r < rounds; r++) {
+      std::unique_ptr<AnalyzeResult> a = analyzeCode(text.data(), text.size());
+      if (a->symbols.size() != n || !a->diagnostics.empty()) {
+        fprintf(stderr, "%d names: symbol table has %d\n", n,
+                a->symbols.size());
+        return 1;
+      }
+      if (a->stats.parseNs * 1e-9 < parse)
+        parse = a->stats.parseNs * 1e-9;
+      if (a->stats.analyzeNs * 1e-9 < symtab)
+        symtab = a->stats.analyzeNs * 1e-9;
+      refs = 0;
+      for (int id = 0; id < n; id++)
+        refs += (long)a->symbols.references(id).count;
+      if (n < CHAINEDMAX) {
+        ChainedTable st;
+        double t0 = benchClock();
+        buildChained(st, a->tree);
+        double t = benchClock() - t0;
+        if (t < chained)
+          chained = t;
+        int same = sameTables(a->symbols, st);
+        st_free(st);
+        if (!same) {
+          fprintf(stderr, "%d names: tables differ\n", n);
+          return 1;
+        }
+      }
+    }
+    printf("%-8d %10ld %10.2f %10.2f %10.1f ", n, refs, parse * 1e3,
+           symtab * 1e3, symtab / refs * 1e9);
+    if (n < CHAINEDMAX)
+      printf("%10.2f\n", chained * 1e3);
+    else
+      printf("%10s\n", "-");
+  }
+  return 0;
+}
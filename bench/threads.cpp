@@ -0,0 +1,64 @@
+/****************************************************/
+/* File: threads.cpp                                */
+/* Stress test for reentrant analysis: the same     */
+/* program parsed on 1..n threads at once           */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "source.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+int benchThreads(int argc, char *argv[]) {
+  int maxThreads = argc > 0 ? atoi(argv[0]) : 0;
+  int rounds = argc > 1 ? atoi(argv[1]) : 20;
+  SourceBuffer file;
+  std::string text;
+  if (argc > 2) {
+    if (!file.map(argv[2])) {
+      fprintf(stderr, "cannot read %s\n", argv[2]);
+      return 1;
+    }
+    text.assign(file.data(), file.size());
+  } else
+    text = sampleProgram(20000);
+  if (maxThreads <= 0)
+    maxThreads = (int)std::thread::hardware_concurrency();
+  if (maxThreads <= 0)
+    maxThreads = 1;
+
+  printf("%-8s %10s %10s %8s\n", "threads", "MB/s", "parses/s", "scaling");
+  double single = 0;
+  for (int n = 1; n <= maxThreads; n++) {
+    std::atomic<long> failures(0);
+    std::vector<std::thread> pool;
+    double t0 = benchClock();
+    for (int k = 0; k < n; k++)
+      pool.emplace_back([&] {
+        for (int r = 0; r < rounds; r++) {
+          std::unique_ptr<AnalyzeResult> result =
+              analyzeCode(text.data(), text.size());
+          if (result->tree == NULL || !result->diagnostics.empty())
+            failures++;
+        }
+      });
+    for (std::thread &t : pool)
+      t.join();
+    double t = benchClock() - t0;
+    double parses = (double)n * rounds / t;
+    if (n == 1)
+      single = parses;
+    printf("%-8d %10.1f %10.1f %7.2fx\n", n, parses * text.size() / 1e6,
+           parses, parses / single);
+    if (failures > 0) {
+      fprintf(stderr, "%ld parses failed\n", (long)failures);
+      return 1;
+    }
+  }
+  return 0;
+}
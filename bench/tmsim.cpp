@@ -0,0 +1,230 @@
+/****************************************************/
+/* File: tmsim.cpp                                  */
+/* Running generated TM code: the predecoded        */
+/* simulator against the loop of tm.c               */
+/****************************************************/
+
+#include "bench.h"
+#include "analyze.h"
+#include "bytecode.h"
+#include "cgen.h"
+#include "runtime.h"
+#include "tm.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/* loudenTM runs tm as tm.c does: every step
+ * fetches through the pc register, checks it, and
+ * takes apart the instruction as read
+ */
+static int loudenTM(const TmCode &tm, FILE *in, FILE *out, DiagCode *stop) {
+  int reg[NO_REGS] = {0};
+  std::vector<int> dMem(DADDR_SIZE, 0);
+  dMem[0] = DADDR_SIZE - 1;
+  int size = (int)tm.source.size();
+  for (;;) {
+    int pc = reg[PC_REG];
+    if (pc < 0 || pc >= size) {
+      *stop = MemoryFaultD;
+      return FALSE;
+    }
+    reg[PC_REG] = pc + 1;
+    const TmInstruction &i = tm.source[pc];
+    int r = i.r, s = i.s, t = i.t, m = 0;
+    if (i.op > opRRLim) {
+      m = tinyAdd(i.d, reg[s]);
+      if (i.op < opRMLim && (m < 0 || m >= DADDR_SIZE)) {
+        *stop = MemoryFaultD;
+        return FALSE;
+      }
+    }
+    switch (i.op) {
+    case opHALT:
+      return TRUE;
+    case opIN:
+      if (in == NULL || fscanf(in, "%d", &reg[r]) != 1) {
+        *stop = NoInputD;
+        return FALSE;
+      }
+      break;
+    case opOUT:
+      fprintf(out, "%d\n", reg[r]);
+      break;
+    case opADD:
+      reg[r] = tinyAdd(reg[s], reg[t]);
+      break;
+    case opSUB:
+      reg[r] = tinySub(reg[s], reg[t]);
+      break;
+    case opMUL:
+      reg[r] = tinyMul(reg[s], reg[t]);
+      break;
+    case opDIV:
+      if (reg[t] == 0) {
+        *stop = DivisionByZeroD;
+        return FALSE;
+      }
+      reg[r] = tinyDiv(reg[s], reg[t]);
+      break;
+    case opLD:
+      reg[r] = dMem[m];
+      break;
+    case opST:
+      dMem[m] = reg[r];
+      break;
+    case opLDA:
+      reg[r] = m;
+      break;
+    case opLDC:
+      reg[r] = i.d;
+      break;
+    case opJLT:
+      if (reg[r] < 0)
+        reg[PC_REG] = m;
+      break;
+    case opJLE:
+      if (reg[r] <= 0)
+        reg[PC_REG] = m;
+      break;
+    case opJGT:
+      if (reg[r] > 0)
+        reg[PC_REG] = m;
+      break;
+    case opJGE:
+      if (reg[r] >= 0)
+        reg[PC_REG] = m;
+      break;
+    case opJEQ:
+      if (reg[r] == 0)
+        reg[PC_REG] = m;
+      break;
+    case opJNE:
+      if (reg[r] != 0)
+        reg[PC_REG] = m;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/* Outcome is the output and end of one run */
+struct Outcome {
+  std::string output;
+  int ended;
+  DiagCode stop;
+  double seconds;
+};
+
+static std::string readBack(FILE *f) {
+  std::string s;
+  rewind(f);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    s.append(buf, n);
+  return s;
+}
+
+/* way says how outcome runs: 0 tm.c's loop, 1 the
+ * simulator, 2 the bytecode machine
+ */
+static Outcome outcome(int way, const TmCode &tm, const Bytecode &bc,
+                       int input) {
+  Outcome o;
+  FILE *in = tmpfile(), *out = tmpfile();
+  fprintf(in, "%d\n", input);
+  rewind(in);
+  Diagnostic error = {0, 0, NoInputD, ""};
+  double t0 = benchClock();
+  if (way == 0)
+    o.ended = loudenTM(tm, in, out, &o.stop);
+  else {
+    o.ended = way == 1 ? runTM(tm, in, out, &error)
+                       : runBytecode(bc, in, out, &error);
+    o.stop = error.code;
+  }
+  o.seconds = benchClock() - t0;
+  o.output = readBack(out);
+  fclose(in);
+  fclose(out);
+  return o;
+}
+
+static int sameOutcome(const Outcome &a, const Outcome &b) {
+  return a.output == b.output && a.ended == b.ended &&
+         (a.ended || a.stop == b.stop);
+}
+
+/* generate writes the TM code of result, with the
+ * comments of TraceCode if trace, and loads it
+ */
+static int generate(const AnalyzeResult &result, int trace, TmCode &tm,
+                    size_t *bytes) {
+  FILE *code = tmpfile();
+  int saved = TraceCode;
+  TraceCode = trace;
+  int ok = codeGen(result, code, "bench.tm");
+  TraceCode = saved;
+  *bytes = (size_t)ftell(code);
+  rewind(code);
+  Diagnostic error;
+  if (ok && !loadTM(code, tm, &error)) {
+    fprintf(stderr, "line %d: %s\n", error.line, error.message.c_str());
+    ok = FALSE;
+  }
+  fclose(code);
+  return ok;
+}
+
+int benchTM(int argc, char *argv[]) {
+  int scale = argc > 0 ? atoi(argv[0]) : 100;
+  int rounds = argc > 1 ? atoi(argv[1]) : 3;
+  printf("%-8s %8s %8s %8s %10s %10s %10s %8s\n", "program", "input",
+         "TM code", "bytes", "tm.c ms", "tm ms", "vm ms", "speedup");
+  for (int p = 0; p < NRUNPROGRAMS; p++) {
+    const char *text = runPrograms[p].text;
+    int input = (int)((long)runPrograms[p].input * scale / 100);
+    std::unique_ptr<AnalyzeResult> result = analyzeCode(text, strlen(text));
+    TmCode tm, traced;
+    Bytecode bc;
+    size_t bytes, tracedBytes;
+    if (!generate(*result, FALSE, tm, &bytes) ||
+        !generate(*result, TRUE, traced, &tracedBytes) ||
+        !compileBytecode(*result, bc)) {
+      fprintf(stderr, "%s: not compiled\n", runPrograms[p].name);
+      return 1;
+    }
+    /* the comments of TraceCode change nothing */
+    if (tm.source.size() != traced.source.size() ||
+        memcmp(tm.source.data(), traced.source.data(),
+               tm.source.size() * sizeof(TmInstruction)) != 0) {
+      fprintf(stderr, "%s: traced code differs\n", runPrograms[p].name);
+      return 1;
+    }
+    double louden = 1e30, fast = 1e30, vm = 1e30;
+    for (int r = 0; r < rounds; r++) {
+      Outcome a = outcome(0, tm, bc, input), b = outcome(1, tm, bc, input),
+              c = outcome(2, tm, bc, input);
+      if (!sameOutcome(a, b) || !sameOutcome(a, c)) {
+        fprintf(stderr, "%s: the %s differs from tm.c's loop\n",
+                runPrograms[p].name,
+                !sameOutcome(a, b) ? "simulator" : "bytecode machine");
+        return 1;
+      }
+      if (a.seconds < louden)
+        louden = a.seconds;
+      if (b.seconds < fast)
+        fast = b.seconds;
+      if (c.seconds < vm)
+        vm = c.seconds;
+    }
+    printf("%-8s %8d %8zu %8zu %10.2f %10.2f %10.2f %7.2fx\n",
+           runPrograms[p].name, input, tm.source.size() - 1, bytes,
+           louden * 1e3, fast * 1e3, vm * 1e3, louden / fast);
+  }
+  return 0;
+}
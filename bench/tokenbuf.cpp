@@ -0,0 +1,114 @@
+/****************************************************/
+/* File: tokenbuf.cpp                               */
+/* Token buffer: parsing while scanning against     */
+/* scanning once and parsing the stored tokens      */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "parse.h"
+#include "scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* parseText parses text, from a buffer of tokens
+ * if tokens is not NULL, else straight from the
+ * scanner; returns the number of nodes
+ */
+static long parseText(const std::string &text, std::vector<Token> *tokens) {
+  Arena arena;
+  InternTable names{arena};
+  std::vector<Diagnostic> diagnostics;
+  CompilerContext ctx;
+  ctx.arena = &arena;
+  ctx.names = &names;
+  ctx.diagnostics = &diagnostics;
+  setScanBuffer(ctx, text.data(), text.size());
+  if (tokens != NULL) {
+    tokens->clear();
+    tokenize(ctx, *tokens);
+    ctx.tokenArray = tokens->data();
+    ctx.tokenCount = tokens->size();
+  }
+  parse(ctx);
+  return ctx.nodes;
+}
+
+/* countScanned counts numbers by scanning again */
+static long countScanned(const std::string &text) {
+  CompilerContext ctx;
+  setScanBuffer(ctx, text.data(), text.size());
+  long n = 0;
+  Token t;
+  do {
+    t = scanToken(ctx);
+    n += t.type == NUM;
+  } while (t.type != ENDFILE);
+  return n;
+}
+
+static long countBuffered(const std::vector<Token> &tokens) {
+  long n = 0;
+  for (const Token &t : tokens)
+    n += t.type == NUM;
+  return n;
+}
+
+int benchTokens(int argc, char *argv[]) {
+  int statements = argc > 0 ? atoi(argv[0]) : 50000;
+  int rounds = argc > 1 ? atoi(argv[1]) : 10;
+  std::string text = sampleProgram(statements);
+  std::vector<Token> tokens;
+
+  double t0 = benchClock();
+  long nodes = 0;
+  for (int r = 0; r < rounds; r++)
+    nodes = parseText(text, NULL);
+  double streamTime = (benchClock() - t0) / rounds;
+
+  t0 = benchClock();
+  long bufferedNodes = 0;
+  for (int r = 0; r < rounds; r++)
+    bufferedNodes = parseText(text, &tokens);
+  double bufferTime = (benchClock() - t0) / rounds;
+
+  t0 = benchClock();
+  for (int r = 0; r < rounds; r++) {
+    CompilerContext ctx;
+    setScanBuffer(ctx, text.data(), text.size());
+    tokens.clear();
+    tokenize(ctx, tokens);
+  }
+  double scanTime = (benchClock() - t0) / rounds;
+
+  /* a second pass over the tokens, as a highlighter
+   * or a statistics tool would make
+   */
+  t0 = benchClock();
+  long scannedNums = 0;
+  for (int r = 0; r < rounds; r++)
+    scannedNums = countScanned(text);
+  double rescanTime = (benchClock() - t0) / rounds;
+  t0 = benchClock();
+  long bufferedNums = 0;
+  for (int r = 0; r < rounds; r++)
+    bufferedNums = countBuffered(tokens);
+  double reuseTime = (benchClock() - t0) / rounds;
+
+  printf("%d statements, %zu bytes, %zu tokens of %zu bytes (%.2f bytes of "
+         "tokens per byte of text)\n",
+         statements, text.size(), tokens.size(), sizeof(Token),
+         (double)tokens.size() * sizeof(Token) / text.size());
+  printf("%-22s %10s %14s\n", "pass", "ms", "Mtokens/s");
+  printf("%-22s %10.3f %14.1f\n", "scan and parse", streamTime * 1e3,
+         tokens.size() / streamTime / 1e6);
+  printf("%-22s %10.3f %14.1f\n", "tokenize, then parse", bufferTime * 1e3,
+         tokens.size() / bufferTime / 1e6);
+  printf("%-22s %10.3f %14.1f\n", "  of which tokenize", scanTime * 1e3,
+         tokens.size() / scanTime / 1e6);
+  printf("%-22s %10.3f %14.1f\n", "count numbers: rescan", rescanTime * 1e3,
+         tokens.size() / rescanTime / 1e6);
+  printf("%-22s %10.3f %14.1f\n", "count numbers: reuse", reuseTime * 1e3,
+         tokens.size() / reuseTime / 1e6);
+  return nodes == bufferedNodes && scannedNums == bufferedNums ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/****************************************************/
+/* File: types.cpp                                  */
+/* Type checking pass: its cost against the parse   */
+/* and the share of expressions it gives a value   */
+/****************************************************/
+
+#include "analyze.h"
+#include "bench.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+/* typedProgram returns sampleProgram with its
+ * tests and operands of the types they need
+ */
+static std::string typedProgram(int n) {
+  std::string s = "read x;\n";
+  char line[200];
+  for (int i = 0; i < n; i++) {
+    snprintf(line, sizeof(line),
+             "for i := 1 to x do { step %d }\n"
+             "  if (i %% 3 = 0) s += i * %d else s := s - (i ^ 2);\n"
+             "  write s > 0 and not (i <> x)\nenddo;\n"
+             "repeat x := x - 1 until x <= 0 or s = %d;\n",
+             i, i, i);
+    s += line;
+  }
+  s += "write s\n";
+  return s;
+}
+
+/* Typing counts the expression nodes of a tree and
+ * those of them typeCheck gave an Integer or Boolean
+ * type, which are all but those of regular
+ * definitions
+ */
+struct Typing {
+  long expressions = 0;
+  long typed = 0;
+};
+
+static Typing countTyped(TreeNode *tree) {
+  Typing p;
+  TreeWalk walk(tree);
+  TreeNode *t;
+  while ((t = walk.next()) != NULL)
+    if (t->nodekind == ExpK) {
+      p.expressions++;
+      p.typed += t->type != Void;
+    }
+  return p;
+}
+
+int benchTypes(int argc, char *argv[]) {
+  size_t bytes = argc > 0 ? (size_t)atol(argv[0]) : 8u << 20;
+  int rounds = argc > 1 ? atoi(argv[1]) : 3;
+
+  /* a well typed program has a value everywhere */
+  std::string text = typedProgram(1000);
+  std::unique_ptr<AnalyzeResult> a = analyzeCode(text.data(), text.size());
+  Typing p = countTyped(a->tree);
+  if (!a->typeErrors.empty() || p.typed != p.expressions) {
+    fprintf(stderr, "typed program: %zu type errors, %ld of %ld typed\n",
+            a->typeErrors.size(), p.typed, p.expressions);
+    return 1;
+  }
+
+  printf("%-10s %10s %10s %10s %10s %10s %10s\n", "program", "nodes",
+         "typed %", "errors", "parse ms", "types ms", "ns/node");
+  for (int shape = 0; shape < NSHAPES; shape++) {
+    text = generateProgram((ProgramShape)shape, bytes, 1);
+    double parse = 1e30, types = 1e30;
+    for (int r = 0; r < rounds; r++) {
+      a = analyzeCode(text.data(), text.size());
+      if (a->stats.parseNs * 1e-9 < parse)
+        parse = a->stats.parseNs * 1e-9;
+      if (a->stats.typeNs * 1e-9 < types)
+        types = a->stats.typeNs * 1e-9;
+    }
+    p = countTyped(a->tree);
+    printf("%-10s %10ld %10.1f %10zu %10.2f %10.2f %10.1f\n",
+           shapeNames[shape], a->nodes,
+           p.expressions ? 100.0 * p.typed / p.expressions : 100.0,
+           a->typeErrors.size(), parse * 1e3, types * 1e3,
+           types / a->nodes * 1e9);
+  }
+  return 0;
+}
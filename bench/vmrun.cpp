@@ -0,0 +1,298 @@
+/****************************************************/
+/* File: vmrun.cpp                                  */
+/* Running programs: bytecode machine and native    */
+/* code against a tree-walking evaluator            */
+/****************************************************/
+
+#include "bench.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "runtime.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/* Walker runs a syntax tree as it stands, the way
+ * the machine is measured against: each variable
+ * has the cell of its interned id
+ */
+struct Walker {
+  std::vector<int> memory;
+  FILE *in;
+  FILE *out;
+  int stopped = FALSE;
+  Diagnostic error;
+
+  void stop(TreeNode *t, DiagCode code, const char *message) {
+    if (!stopped)
+      error = {t->lineno, 0, code, message};
+    stopped = TRUE;
+  }
+
+  int eval(TreeNode *t) {
+    switch (t->kind.exp) {
+    case ConstK:
+      return t->attr.val;
+    case IdK:
+      return memory[t->symbol];
+    default:
+      break;
+    }
+    int x = eval(t->child[0]);
+    if (t->attr.op == NOT)
+      return !x;
+    int y = eval(t->child[1]);
+    switch (t->attr.op) {
+    case PLUS:
+      return tinyAdd(x, y);
+    case MINUS:
+      return tinySub(x, y);
+    case TIMES:
+      return tinyMul(x, y);
+    case OVER:
+    case REMAIN:
+      if (y == 0) {
+        stop(t, DivisionByZeroD, "division by 0");
+        return 0;
+      }
+      return t->attr.op == OVER ? tinyDiv(x, y) : tinyMod(x, y);
+    case POWER:
+      return tinyPow(x, y);
+    case LT:
+      return x < y;
+    case LTE:
+      return x <= y;
+    case GT:
+      return x > y;
+    case GTE:
+      return x >= y;
+    case EQ:
+      return x == y;
+    case NEQ:
+      return x != y;
+    case AND:
+      return x & y;
+    case OR:
+      return x | y;
+    default:
+      return 0;
+    }
+  }
+
+  void exec(TreeNode *t) {
+    for (; t != NULL && !stopped; t = t->sibling)
+      switch (t->kind.stmt) {
+      case IfK: {
+        int test = eval(t->child[0]);
+        if (!stopped)
+          exec(test ? t->child[1] : t->child[2]);
+        break;
+      }
+      case RepeatK:
+        do
+          exec(t->child[0]);
+        while (!stopped && !eval(t->child[1]));
+        break;
+      case AssignK: {
+        int value = eval(t->child[0]);
+        if (!stopped)
+          memory[t->symbol] = value;
+        break;
+      }
+      case PlusEqK: {
+        int value = eval(t->child[0]);
+        if (!stopped)
+          memory[t->symbol] = tinyAdd(memory[t->symbol], value);
+        break;
+      }
+      case ReadK:
+        if (in == NULL || fscanf(in, "%d", &memory[t->symbol]) != 1)
+          stop(t, NoInputD, "no input for read");
+        break;
+      case WriteK: {
+        int value = eval(t->child[0]);
+        if (!stopped && out != NULL)
+          fprintf(out, "%d\n", value);
+        break;
+      }
+      case ForK: {
+        int down = strcmp(t->attr.name, "downto") == 0;
+        int &v = memory[t->child[0]->symbol];
+        exec(t->child[0]);
+        int bound = eval(t->child[1]);
+        int more = down ? v >= bound : v <= bound;
+        while (!stopped && more) {
+          exec(t->child[2]);
+          /* tested before the step, which wraps at a limit */
+          more = down ? v > bound : v < bound;
+          v = down ? tinySub(v, 1) : tinyAdd(v, 1);
+        }
+        break;
+      }
+      default:
+        break;
+      }
+  }
+};
+
+/* the loop-heavy programs, each reading its size */
+const RunProgram runPrograms[NRUNPROGRAMS] = {
+    {"nested", 1500,
+     "read n; s := 0;\n"
+     "for i := 1 to n do\n"
+     "  for j := 1 to n do s += i * j % 7 enddo\n"
+     "enddo;\n"
+     "write s"},
+    {"collatz", 30000,
+     "read n; steps := 0;\n"
+     "for k := 1 to n do\n"
+     "  x := k;\n"
+     "  repeat\n"
+     "    if (x % 2 = 0) x := x / 2 else x := 3 * x + 1;\n"
+     "    steps += 1\n"
+     "  until x <= 1\n"
+     "enddo;\n"
+     "write steps"},
+    {"primes", 100000,
+     "read n; c := 0;\n"
+     "for p := 2 to n do\n"
+     "  d := 2; q := 1;\n"
+     "  repeat\n"
+     "    if (p % d = 0) q := 0;\n"
+     "    d += 1\n"
+     "  until d * d > p or q = 0;\n"
+     "  c += q\n"
+     "enddo;\n"
+     "write c"},
+    {"powers", 2000000,
+     "read n; s := 0;\n"
+     "for i := n downto 1 do\n"
+     "  s := (s + i ^ 3 % 1009) % 100003;\n"
+     "  if (s > 50000 and not (i % 3 <> 0)) write s\n"
+     "enddo;\n"
+     "write s"},
+    /* stops on its last round */
+    {"divide", 1000,
+     "read n; s := 0;\n"
+     "for i := n downto 0 do s += 100000 / i enddo;\n"
+     "write s"},
+    /* more loops than loop registers */
+    {"deep", 12,
+     "read n; s := 0;\n"
+     "for a := 1 to n do for b := a to n do for c := b to n do\n"
+     "  for d := 1 to 3 do for e := d downto 1 do\n"
+     "    for f := 1 to 2 do for g := f to 2 do\n"
+     "      s += a * b - c + d * e - f * g\n"
+     "    enddo enddo\n"
+     "  enddo enddo\n"
+     "enddo enddo enddo;\n"
+     "write s; write a + b + c + d + e + f + g"},
+    /* the corners of the arithmetic; stops reading */
+    {"edges", 100,
+     "read n; m := 0 - 2147483647 - 1;\n"
+     "write m / (0 - 1); write m % (0 - 1); write m * n;\n"
+     "write 2 ^ (0 - n); write (0 - 3) ^ 3; write 7 % (0 - n);\n"
+     "for i := 1 to 3 do for i := i to 4 do write i enddo enddo;\n"
+     "for i := 2147483645 to 2147483647 do write i enddo; write i;\n"
+     "for i := m + 2 downto m do write i enddo; write i;\n"
+     "s := 0;\n"
+     "repeat read x; s += x until x = 0"},
+};
+
+/* Run is the output and outcome of one run */
+struct Run {
+  std::string output;
+  int ended;
+  Diagnostic error;
+  double seconds;
+};
+
+static std::string readBack(FILE *f) {
+  std::string s;
+  rewind(f);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    s.append(buf, n);
+  return s;
+}
+
+/* run runs program p as native code if native is
+ * given, on the machine if bc is, and with the walker
+ * otherwise
+ */
+static Run run(const AnalyzeResult &result, const Bytecode *bc,
+               const NativeCode *native, int input) {
+  Run r;
+  FILE *in = tmpfile(), *out = tmpfile();
+  fprintf(in, "%d\n", input);
+  rewind(in);
+  double t0 = benchClock();
+  if (native != NULL)
+    r.ended = native->run(in, out, &r.error);
+  else if (bc != NULL)
+    r.ended = runBytecode(*bc, in, out, &r.error);
+  else {
+    Walker w{std::vector<int>(result.names.size(), 0), in, out, FALSE, {}};
+    w.exec(result.tree);
+    r.ended = !w.stopped;
+    r.error = w.error;
+  }
+  r.seconds = benchClock() - t0;
+  r.output = readBack(out);
+  fclose(in);
+  fclose(out);
+  return r;
+}
+
+static int sameRun(const Run &a, const Run &b) {
+  return a.output == b.output && a.ended == b.ended &&
+         (a.ended ||
+          (a.error.code == b.error.code && a.error.line == b.error.line));
+}
+
+int benchMachine(int argc, char *argv[]) {
+  int scale = argc > 0 ? atoi(argv[0]) : 100;
+  int rounds = argc > 1 ? atoi(argv[1]) : 3;
+  printf("%-8s %8s %8s %8s %10s %10s %10s %8s\n", "program", "input",
+         "code", "native", "walker ms", "vm ms", "native ms", "vs vm");
+  for (int p = 0; p < NRUNPROGRAMS; p++) {
+    const char *text = runPrograms[p].text;
+    int input = (int)((long)runPrograms[p].input * scale / 100);
+    std::unique_ptr<AnalyzeResult> result = analyzeCode(text, strlen(text));
+    Bytecode bc;
+    if (!compileBytecode(*result, bc)) {
+      fprintf(stderr, "%s: not compiled\n", runPrograms[p].name);
+      return 1;
+    }
+    /* where there is no native code the machine
+     * stands in, as in runProgram
+     */
+    std::unique_ptr<NativeCode> native = compileNative(*result);
+    double walker = 1e30, vm = 1e30, jit = 1e30;
+    for (int r = 0; r < rounds; r++) {
+      Run a = run(*result, NULL, NULL, input),
+          b = run(*result, &bc, NULL, input),
+          c = run(*result, &bc, native.get(), input);
+      if (!sameRun(a, b) || !sameRun(a, c)) {
+        fprintf(stderr, "%s: the %s differs from the walker\n",
+                runPrograms[p].name,
+                !sameRun(a, b) ? "machine" : "native code");
+        return 1;
+      }
+      if (a.seconds < walker)
+        walker = a.seconds;
+      if (b.seconds < vm)
+        vm = b.seconds;
+      if (c.seconds < jit)
+        jit = c.seconds;
+    }
+    printf("%-8s %8d %8zu %8zu %10.2f %10.2f %10.2f %7.2fx\n",
+           runPrograms[p].name, input, bc.code.size(),
+           native != NULL ? native->size() : (size_t)0, walker * 1e3,
+           vm * 1e3, jit * 1e3, vm / jit);
+  }
+  return 0;
+}
@@ -0,0 +1,268 @@
+/****************************************************/
+/* File: bytecode.cpp                               */
+/* Compiling the syntax tree of a TINY program to   */
+/* the stack code of the virtual machine (vm.h)     */
+/****************************************************/
+
+#include "bytecode.h"
+#include "runtime.h"
+#include "util.h"
+#include <string.h>
+
+static const char *const bcNames[BCOPS] = {
+    "HALT",  "PUSH",  "LOAD",  "STORE", "READ",  "WRITE", "POP",   "JUMP",
+    "JUMPF", "NOT",   "AND",   "OR",    "ADD",   "SUB",   "MUL",   "DIV",
+    "MOD",   "POW",   "LT",    "LE",    "GT",    "GE",    "EQ",    "NE",
+    "ADDC",  "SUBC",  "MULC",  "DIVC",  "MODC",  "POWC",  "LTC",   "LEC",
+    "GTC",   "GEC",   "EQC",   "NEC",   "ADDV",  "SUBV",  "MULV",  "DIVV",
+    "MODV",  "POWV",  "LTV",   "LEV",   "GTV",   "GEV",   "EQV",   "NEV",
+    "JLT",   "JLE",   "JGT",   "JGE",   "JEQ",   "JNE",   "JLTC",  "JLEC",
+    "JGTC",  "JGEC",  "JEQC",  "JNEC",  "JLTV",  "JLEV",  "JGTV",  "JGEV",
+    "JEQV",  "JNEV",  "INC",   "FORTO", "FORDOWN", "NEXTTO", "NEXTDOWN"};
+
+const char *bcName(int op) {
+  return op >= 0 && op < BCOPS ? bcNames[op] : "?";
+}
+
+/* binaryOp returns the instruction of the operator
+ * of an OpK node, or bcHALT for one without
+ */
+static int binaryOp(TokenType op) {
+  switch (op) {
+  case PLUS:
+    return bcADD;
+  case MINUS:
+    return bcSUB;
+  case TIMES:
+    return bcMUL;
+  case OVER:
+    return bcDIV;
+  case REMAIN:
+    return bcMOD;
+  case POWER:
+    return bcPOW;
+  case LT:
+    return bcLT;
+  case LTE:
+    return bcLE;
+  case GT:
+    return bcGT;
+  case GTE:
+    return bcGE;
+  case EQ:
+    return bcEQ;
+  case NEQ:
+    return bcNE;
+  case AND:
+    return bcAND;
+  case OR:
+    return bcOR;
+  default:
+    return bcHALT;
+  }
+}
+
+/* jumpForm returns the comparison and jump that op
+ * and a JUMPF after it make, or bcHALT if op is no
+ * comparison
+ */
+static int jumpForm(int op) {
+  if (op >= bcLT && op <= bcNE)
+    return bcJLT + (op - bcLT);
+  if (op >= bcLTC && op <= bcNEC)
+    return bcJLTC + (op - bcLTC);
+  if (op >= bcLTV && op <= bcNEV)
+    return bcJLTV + (op - bcLTV);
+  return bcHALT;
+}
+
+/* BcCompiler emits the code of one tree. Statement
+ * sequences are followed along their siblings, so
+ * it recurses only as deep as the parser did
+ */
+struct BcCompiler {
+  Bytecode &bc;
+  const SymbolTable &symbols;
+  size_t barrier = 0; /* first instruction that may be joined */
+  int depth = 0;      /* of the operand stack */
+  int lineno = 0;     /* of the node being compiled */
+
+  /* emit appends an instruction, joining it with the
+   * ones before it where they make a common pair,
+   * and returns where it ended up
+   */
+  int emit(int op, int a = 0, int b = 0) {
+    std::vector<BcInstruction> &code = bc.code;
+    size_t n = code.size();
+    BcInstruction *last = n > barrier ? &code[n - 1] : NULL;
+    BcInstruction *before = n > barrier + 1 ? &code[n - 2] : NULL;
+    if (last != NULL && op >= bcADD && op <= bcNE &&
+        (last->op == bcPUSH || last->op == bcLOAD)) {
+      last->op = op + (last->op == bcPUSH ? BINARYOPS : 2 * BINARYOPS);
+      bc.lines[n - 1] = lineno; /* where / and % report 0 */
+      return (int)n - 1;
+    }
+    if (last != NULL && op == bcJUMPF && jumpForm(last->op) != bcHALT) {
+      last->op = jumpForm(last->op);
+      last->b = b;
+      return (int)n - 1;
+    }
+    if (before != NULL && op == bcSTORE && before->op == bcLOAD &&
+        before->a == a && (last->op == bcADDC || last->op == bcSUBC)) {
+      int step = last->op == bcADDC ? last->a : tinySub(0, last->a);
+      code.pop_back();
+      bc.lines.pop_back();
+      before->op = bcINC;
+      before->b = step;
+      return (int)n - 2;
+    }
+    code.push_back({(uint32_t)op, a, b});
+    bc.lines.push_back(lineno);
+    return (int)n;
+  }
+
+  /* label returns the next instruction, a jump
+   * target: nothing before it is joined with it
+   */
+  int label() {
+    barrier = bc.code.size();
+    return (int)barrier;
+  }
+
+  /* push and pop keep the deepest stack in bc */
+  void push(int n = 1) {
+    depth += n;
+    if (depth > bc.maxStack)
+      bc.maxStack = depth;
+  }
+  void pop(int n = 1) { depth -= n; }
+
+  int cell(const TreeNode *t) {
+    return symbols.location(symbols.lookup(t->attr.name));
+  }
+
+  void expression(TreeNode *t) {
+    lineno = t->lineno;
+    switch (t->kind.exp) {
+    case ConstK:
+      emit(bcPUSH, t->attr.val);
+      push();
+      break;
+    case IdK:
+      emit(bcLOAD, cell(t));
+      push();
+      break;
+    case OpK:
+      expression(t->child[0]);
+      if (t->attr.op == NOT) {
+        lineno = t->lineno;
+        emit(bcNOT);
+        break;
+      }
+      expression(t->child[1]);
+      lineno = t->lineno;
+      emit(binaryOp(t->attr.op));
+      pop();
+      break;
+    }
+  }
+
+  void statements(TreeNode *t) {
+    for (; t != NULL; t = t->sibling)
+      statement(t);
+  }
+
+  void statement(TreeNode *t) {
+    int at, skip;
+    lineno = t->lineno;
+    switch (t->kind.stmt) {
+    case IfK:
+      expression(t->child[0]);
+      at = emit(bcJUMPF);
+      pop();
+      statements(t->child[1]);
+      if (t->child[2] != NULL) {
+        lineno = t->lineno;
+        skip = emit(bcJUMP);
+        bc.code[at].b = label();
+        statements(t->child[2]);
+        bc.code[skip].b = label();
+      } else
+        bc.code[at].b = label();
+      break;
+    case RepeatK:
+      at = label();
+      statements(t->child[0]);
+      expression(t->child[1]);
+      emit(bcJUMPF, 0, at);
+      pop();
+      break;
+    case RegK:
+      /* a regular definition makes no code */
+      break;
+    case AssignK:
+      expression(t->child[0]);
+      emit(bcSTORE, cell(t));
+      pop();
+      break;
+    case PlusEqK:
+      emit(bcLOAD, cell(t));
+      push();
+      expression(t->child[0]);
+      emit(bcADD);
+      pop();
+      emit(bcSTORE, cell(t));
+      pop();
+      break;
+    case ReadK:
+      emit(bcREAD, cell(t));
+      break;
+    case WriteK:
+      expression(t->child[0]);
+      emit(bcWRITE);
+      pop();
+      break;
+    case ForK: {
+      /* v := start; bound; FORTO v, end;
+       * body: ...; NEXTTO v, body; end: POP
+       */
+      int down = strcmp(t->attr.name, "downto") == 0;
+      int v = cell(t->child[0]);
+      statement(t->child[0]);
+      expression(t->child[1]);
+      lineno = t->lineno;
+      at = emit(down ? bcFORDOWN : bcFORTO, v);
+      int body = label();
+      statements(t->child[2]);
+      lineno = t->lineno;
+      emit(down ? bcNEXTDOWN : bcNEXTTO, v, body);
+      bc.code[at].b = label();
+      emit(bcPOP);
+      pop();
+      break;
+    }
+    default:
+      break;
+    }
+  }
+};
+
+int compileBytecode(const AnalyzeResult &result, Bytecode &bc) {
+  bc = Bytecode();
+  if (!result.diagnostics.empty() || !result.typeErrors.empty())
+    return FALSE;
+  bc.cells = result.symbols.size();
+  BcCompiler compiler{bc, result.symbols};
+  compiler.statements(result.tree);
+  compiler.label();
+  compiler.emit(bcHALT);
+  return TRUE;
+}
+
+void printBytecode(FILE *listing, const Bytecode &bc) {
+  for (size_t i = 0; i < bc.code.size(); i++) {
+    const BcInstruction &in = bc.code[i];
+    fprintf(listing, "%5zu: %-8s %d, %d\t(line %d)\n", i, bcName(in.op), in.a,
+            in.b, bc.lines[i]);
+  }
+}
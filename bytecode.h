@@ -0,0 +1,96 @@
+/****************************************************/
+/* File: bytecode.h                                 */
+/* Compiling the syntax tree of a TINY program to   */
+/* the stack code of the virtual machine (vm.h)     */
+/****************************************************/
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#include "analyze.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* the instructions of the stack machine. x and y
+ * are the values below and at the top of the
+ * operand stack, a and b the operands of the
+ * instruction; a jump target is always b
+ */
+typedef enum {
+  bcHALT,
+  bcPUSH,  /* push a */
+  bcLOAD,  /* push cell a */
+  bcSTORE, /* pop into cell a */
+  bcREAD,  /* read a value into cell a */
+  bcWRITE, /* pop and write */
+  bcPOP,
+  bcJUMP,  /* go to b */
+  bcJUMPF, /* pop, go to b if it is 0 */
+  bcNOT,
+  bcAND,
+  bcOR,
+  /* binary operators: pop y and x, push x op y */
+  bcADD, bcSUB, bcMUL, bcDIV, bcMOD, bcPOW,
+  bcLT, bcLE, bcGT, bcGE, bcEQ, bcNE,
+  /* the same with y the constant a: PUSH a, op */
+  bcADDC, bcSUBC, bcMULC, bcDIVC, bcMODC, bcPOWC,
+  bcLTC, bcLEC, bcGTC, bcGEC, bcEQC, bcNEC,
+  /* the same with y cell a: LOAD a, op */
+  bcADDV, bcSUBV, bcMULV, bcDIVV, bcMODV, bcPOWV,
+  bcLTV, bcLEV, bcGTV, bcGEV, bcEQV, bcNEV,
+  /* a comparison of any form and JUMPF: pop its
+   * operands, go to b unless x op y
+   */
+  bcJLT, bcJLE, bcJGT, bcJGE, bcJEQ, bcJNE,
+  bcJLTC, bcJLEC, bcJGTC, bcJGEC, bcJEQC, bcJNEC,
+  bcJLTV, bcJLEV, bcJGTV, bcJGEV, bcJEQV, bcJNEV,
+  bcINC, /* add b to cell a: LOAD a, ADDC b, STORE a */
+  /* for loops keep their bound at the top of the
+   * stack while the body runs
+   */
+  bcFORTO,    /* go to b if cell a > y */
+  bcFORDOWN,  /* go to b if cell a < y */
+  bcNEXTTO,   /* go to b if cell a < y; add 1 to cell a */
+  bcNEXTDOWN  /* go to b if cell a > y; subtract 1 from cell a */
+} BcOp;
+
+/* BCOPS = the number of instructions */
+#define BCOPS (bcNEXTDOWN + 1)
+
+/* BINARYOPS = operators in each form, bcADD .. bcNE */
+#define BINARYOPS (bcNE - bcADD + 1)
+
+typedef struct {
+  uint32_t op; /* BcOp */
+  int32_t a;
+  int32_t b;
+} BcInstruction;
+
+/* Bytecode is one compiled program; every variable
+ * has the cell of its location in the symbol table
+ */
+struct Bytecode {
+  std::vector<BcInstruction> code;
+  std::vector<int> lines; /* source line of each instruction */
+  int cells = 0;          /* variables */
+  int maxStack = 0;       /* deepest the operand stack gets */
+};
+
+/* compileBytecode compiles the tree of result into
+ * bc; common pairs of instructions are joined into
+ * one as they are emitted. Only a tree without
+ * diagnostics or type errors is compiled, so the
+ * machine needs no type checks; for any other it
+ * returns FALSE
+ */
+int compileBytecode(const AnalyzeResult &result, Bytecode &bc);
+
+/* bcName returns the mnemonic of op, e.g. "ADDC" */
+const char *bcName(int op);
+
+/* Procedure printBytecode lists bc to listing,
+ * one instruction per line
+ */
+void printBytecode(FILE *listing, const Bytecode &bc);
+
+#endif
@@ -0,0 +1,476 @@
+/****************************************************/
+/* File: cgen.cpp                                   */
+/* The code generator implementation                */
+/* for the TINY compiler                            */
+/* (generates code for the TM machine)              */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "cgen.h"
+#include "globals.h"
+#include <string.h>
+
+int TraceCode = FALSE;
+
+/* pc = program counter  */
+#define pc 7
+
+/* mp = "memory pointer" points
+ * to top of memory (for temp storage)
+ */
+#define mp 6
+
+/* gp = "global pointer" points
+ * to bottom of memory for (global)
+ * variable storage
+ */
+#define gp 5
+
+/* accumulator */
+#define ac 0
+
+/* 2nd accumulator */
+#define ac1 1
+
+/* scratch registers of the longer sequences */
+#define t1 2
+#define t2 3
+#define t3 4
+
+/* CodeGenerator holds what code.c and cgen.c keep
+ * in globals, so several programs can be generated
+ * at once
+ */
+struct CodeGenerator {
+  FILE *code;
+  const SymbolTable &symbols;
+
+  /* TM location number for current instruction emission */
+  int emitLoc = 0;
+
+  /* Highest TM location emitted so far
+   * For use in conjunction with emitSkip,
+   * emitBackup, and emitRestore
+   */
+  int highEmitLoc = 0;
+
+  /* tmpOffset is the memory offset for temps
+   * It is decremented each time a temp is
+   * stored, and incremeted when loaded again
+   */
+  int tmpOffset = 0;
+
+  CodeGenerator(FILE *code, const SymbolTable &symbols)
+      : code(code), symbols(symbols) {}
+
+  /* Procedure emitComment prints a comment line
+   * with comment c in the code file
+   */
+  void emitComment(const char *c) {
+    if (TraceCode)
+      fprintf(code, "* %s\n", c);
+  }
+
+  /* Procedure emitRO emits a register-only
+   * TM instruction
+   * op = the opcode
+   * r = target register
+   * s = 1st source register
+   * t = 2nd source register
+   * c = a comment to be printed if TraceCode is TRUE
+   */
+  void emitRO(const char *op, int r, int s, int t, const char *c) {
+    fprintf(code, "%3d:  %5s  %d,%d,%d ", emitLoc++, op, r, s, t);
+    if (TraceCode)
+      fprintf(code, "\t%s", c);
+    fprintf(code, "\n");
+    if (highEmitLoc < emitLoc)
+      highEmitLoc = emitLoc;
+  }
+
+  /* Procedure emitRM emits a register-to-memory
+   * TM instruction
+   * op = the opcode
+   * r = target register
+   * d = the offset
+   * s = the base register
+   * c = a comment to be printed if TraceCode is TRUE
+   */
+  void emitRM(const char *op, int r, int d, int s, const char *c) {
+    fprintf(code, "%3d:  %5s  %d,%d(%d) ", emitLoc++, op, r, d, s);
+    if (TraceCode)
+      fprintf(code, "\t%s", c);
+    fprintf(code, "\n");
+    if (highEmitLoc < emitLoc)
+      highEmitLoc = emitLoc;
+  }
+
+  /* Function emitSkip skips "howMany" code
+   * locations for later backpatch. It also
+   * returns the current code position
+   */
+  int emitSkip(int howMany) {
+    int i = emitLoc;
+    emitLoc += howMany;
+    if (highEmitLoc < emitLoc)
+      highEmitLoc = emitLoc;
+    return i;
+  }
+
+  /* Procedure emitBackup backs up to
+   * loc = a previously skipped location
+   */
+  void emitBackup(int loc) {
+    if (loc > highEmitLoc)
+      emitComment("BUG in emitBackup");
+    emitLoc = loc;
+  }
+
+  /* Procedure emitRestore restores the current
+   * code position to the highest previously
+   * unemitted position
+   */
+  void emitRestore(void) { emitLoc = highEmitLoc; }
+
+  /* Procedure emitRM_Abs converts an absolute reference
+   * to a pc-relative reference when emitting a
+   * register-to-memory TM instruction
+   * op = the opcode
+   * r = target register
+   * a = the absolute location in memory
+   * c = a comment to be printed if TraceCode is TRUE
+   */
+  void emitRM_Abs(const char *op, int r, int a, const char *c) {
+    emitRM(op, r, a - (emitLoc + 1), pc, c);
+  }
+
+  int loc(const TreeNode *t) {
+    return symbols.location(symbols.lookup(t->attr.name));
+  }
+
+  /* Procedure emitDifference leaves in ac a value of
+   * the sign of ac1 - ac. The subtraction alone
+   * wraps around for operands far apart, so the
+   * halves of the operands, which cannot overflow,
+   * decide unless they are equal
+   */
+  void emitDifference(void) {
+    emitRM("LDC", t1, 2, 0, "load 2");
+    emitRO("DIV", t2, ac1, t1, "left half");
+    emitRO("DIV", t1, ac, t1, "right half");
+    emitRO("SUB", t1, t2, t1, "compare halves");
+    emitRO("SUB", ac, ac1, ac, "difference");
+    emitRM("JEQ", t1, 1, pc, "halves equal: keep difference");
+    emitRM("LDA", ac, 0, t1, "else difference of halves");
+  }
+
+  /* Procedure emitCompare leaves in ac 1 if ac1 op ac
+   * and 0 otherwise, jump being the jump of op
+   */
+  void emitCompare(const char *jump) {
+    emitDifference();
+    emitRM(jump, ac, 2, pc, "br if true");
+    emitRM("LDC", ac, 0, ac, "false case");
+    emitRM("LDA", pc, 1, pc, "unconditional jmp");
+    emitRM("LDC", ac, 1, ac, "true case");
+  }
+
+  /* Procedure emitPower leaves in ac ac1 raised to
+   * the power ac by squaring, as tinyPow; a
+   * negative power gives 0
+   */
+  void emitPower(void) {
+    emitRM("LDA", t3, 0, ac, "exponent");
+    emitRM("LDA", t2, 0, ac1, "base");
+    emitRM("LDC", ac, 0, 0, "0 for a negative power");
+    int negative = emitSkip(1);
+    emitRM("LDC", ac, 1, 0, "result = 1");
+    int top = emitSkip(0);
+    int done = emitSkip(1);
+    emitRM("LDC", t1, 2, 0, "load 2");
+    emitRO("DIV", t1, t3, t1, "exponent / 2");
+    emitRO("ADD", ac1, t1, t1, "");
+    emitRO("SUB", ac1, t3, ac1, "lowest bit of exponent");
+    emitRM("JEQ", ac1, 1, pc, "skip if even");
+    emitRO("MUL", ac, ac, t2, "result *= base");
+    emitRO("MUL", t2, t2, t2, "base *= base");
+    emitRM("LDA", t3, 0, t1, "exponent /= 2");
+    emitRM_Abs("LDA", pc, top, "jmp back to test");
+    int end = emitSkip(0);
+    emitBackup(negative);
+    emitRM_Abs("JLT", t3, end, "power: jmp to end if negative");
+    emitBackup(done);
+    emitRM_Abs("JEQ", t3, end, "power: jmp to end if exponent is 0");
+    emitRestore();
+  }
+
+  /* Procedure genStmt generates code at a statement node */
+  void genStmt(TreeNode *tree) {
+    TreeNode *p1, *p2, *p3;
+    int savedLoc1, savedLoc2, currentLoc;
+    int location;
+    switch (tree->kind.stmt) {
+
+    case IfK:
+      emitComment("-> if");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      p3 = tree->child[2];
+      /* generate code for test expression */
+      cGen(p1);
+      savedLoc1 = emitSkip(1);
+      emitComment("if: jump to else belongs here");
+      /* recurse on then part */
+      cGen(p2);
+      savedLoc2 = emitSkip(1);
+      emitComment("if: jump to end belongs here");
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc1);
+      emitRM_Abs("JEQ", ac, currentLoc, "if: jmp to else");
+      emitRestore();
+      /* recurse on else part */
+      cGen(p3);
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc2);
+      emitRM_Abs("LDA", pc, currentLoc, "jmp to end");
+      emitRestore();
+      emitComment("<- if");
+      break; /* if_k */
+
+    case RepeatK:
+      emitComment("-> repeat");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      savedLoc1 = emitSkip(0);
+      emitComment("repeat: jump after body comes back here");
+      /* generate code for body */
+      cGen(p1);
+      /* generate code for test */
+      cGen(p2);
+      emitRM_Abs("JEQ", ac, savedLoc1, "repeat: jmp back to body");
+      emitComment("<- repeat");
+      break; /* repeat */
+
+    case RegK:
+      /* a regular definition makes no code */
+      break;
+
+    case AssignK:
+      emitComment("-> assign");
+      /* generate code for rhs */
+      cGen(tree->child[0]);
+      /* now store value */
+      location = loc(tree);
+      emitRM("ST", ac, location, gp, "assign: store value");
+      emitComment("<- assign");
+      break; /* assign_k */
+
+    case PlusEqK:
+      emitComment("-> +=");
+      cGen(tree->child[0]);
+      location = loc(tree);
+      emitRM("LD", ac1, location, gp, "+=: load variable");
+      emitRO("ADD", ac, ac1, ac, "op +");
+      emitRM("ST", ac, location, gp, "+=: store value");
+      emitComment("<- +=");
+      break;
+
+    case ReadK:
+      emitRO("IN", ac, 0, 0, "read integer value");
+      location = loc(tree);
+      emitRM("ST", ac, location, gp, "read: store value");
+      break;
+
+    case WriteK:
+      /* generate code for expression to write */
+      cGen(tree->child[0]);
+      /* now output it */
+      emitRO("OUT", ac, 0, 0, "write ac");
+      break;
+
+    case ForK: {
+      /* the bound is computed once and kept as a
+       * temp while the body runs
+       */
+      int down = strcmp(tree->attr.name, "downto") == 0;
+      emitComment(down ? "-> for downto" : "-> for to");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      p3 = tree->child[2];
+      location = loc(p1);
+      cGen(p1);
+      cGen(p2);
+      int bound = tmpOffset--;
+      emitRM("ST", ac, bound, mp, "for: push bound");
+      emitRM("LD", ac1, location, gp, "for: load variable");
+      emitRM("LD", ac, bound, mp, "for: load bound");
+      emitDifference();
+      savedLoc1 = emitSkip(1);
+      emitComment("for: jump past the loop belongs here");
+      savedLoc2 = emitSkip(0);
+      cGen(p3);
+      /* the variable is compared before its step,
+       * which wraps past the largest or smallest int
+       */
+      emitRM("LD", ac1, location, gp, "for: load variable");
+      emitRM("LD", ac, bound, mp, "for: load bound");
+      emitDifference();
+      emitRM("LDA", ac1, down ? -1 : 1, ac1, "for: step");
+      emitRM("ST", ac1, location, gp, "for: store variable");
+      emitRM_Abs(down ? "JGT" : "JLT", ac, savedLoc2,
+                 "for: jmp back to body");
+      currentLoc = emitSkip(0);
+      emitBackup(savedLoc1);
+      emitRM_Abs(down ? "JLT" : "JGT", ac, currentLoc,
+                 "for: jmp past the loop");
+      emitRestore();
+      tmpOffset++;
+      emitComment(down ? "<- for downto" : "<- for to");
+      break;
+    }
+
+    default:
+      break;
+    }
+  } /* genStmt */
+
+  /* Procedure genExp generates code at an expression node */
+  void genExp(TreeNode *tree) {
+    TreeNode *p1, *p2;
+    switch (tree->kind.exp) {
+
+    case ConstK:
+      emitComment("-> Const");
+      /* gen code to load integer constant using LDC */
+      emitRM("LDC", ac, tree->attr.val, 0, "load const");
+      emitComment("<- Const");
+      break; /* ConstK */
+
+    case IdK:
+      emitComment("-> Id");
+      emitRM("LD", ac, loc(tree), gp, "load id value");
+      emitComment("<- Id");
+      break; /* IdK */
+
+    case OpK:
+      emitComment("-> Op");
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      if (tree->attr.op == NOT) {
+        cGen(p1);
+        emitRM("LDC", ac1, 1, 0, "load 1");
+        emitRO("SUB", ac, ac1, ac, "op not");
+        emitComment("<- Op");
+        break;
+      }
+      /* gen code for ac = left arg */
+      cGen(p1);
+      /* gen code to push left operand */
+      emitRM("ST", ac, tmpOffset--, mp, "op: push left");
+      /* gen code for ac = right operand */
+      cGen(p2);
+      /* now load left operand */
+      emitRM("LD", ac1, ++tmpOffset, mp, "op: load left");
+      switch (tree->attr.op) {
+      case PLUS:
+        emitRO("ADD", ac, ac1, ac, "op +");
+        break;
+      case MINUS:
+        emitRO("SUB", ac, ac1, ac, "op -");
+        break;
+      case TIMES:
+        emitRO("MUL", ac, ac1, ac, "op *");
+        break;
+      case OVER:
+        emitRO("DIV", ac, ac1, ac, "op /");
+        break;
+      case REMAIN:
+        emitRO("DIV", t1, ac1, ac, "op %: quotient");
+        emitRO("MUL", t1, t1, ac, "");
+        emitRO("SUB", ac, ac1, t1, "op %");
+        break;
+      case POWER:
+        emitPower();
+        break;
+      /* Booleans are 0 and 1 */
+      case AND:
+        emitRO("MUL", ac, ac1, ac, "op and");
+        break;
+      case OR:
+        emitRO("ADD", ac, ac1, ac, "op or");
+        emitRM("JEQ", ac, 1, pc, "br if false");
+        emitRM("LDC", ac, 1, ac, "true case");
+        break;
+      case LT:
+        emitCompare("JLT");
+        break;
+      case LTE:
+        emitCompare("JLE");
+        break;
+      case GT:
+        emitCompare("JGT");
+        break;
+      case GTE:
+        emitCompare("JGE");
+        break;
+      case EQ:
+        emitCompare("JEQ");
+        break;
+      case NEQ:
+        emitCompare("JNE");
+        break;
+      default:
+        emitComment("BUG: Unknown operator");
+        break;
+      } /* case op */
+      emitComment("<- Op");
+      break; /* OpK */
+
+    default:
+      break;
+    }
+  } /* genExp */
+
+  /* Procedure cGen recursively generates code by
+   * tree traversal
+   */
+  void cGen(TreeNode *tree) {
+    for (; tree != NULL; tree = tree->sibling) {
+      switch (tree->nodekind) {
+      case StmtK:
+        genStmt(tree);
+        break;
+      case ExpK:
+        genExp(tree);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+};
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+int codeGen(const AnalyzeResult &result, FILE *code, const char *codefile) {
+  if (!result.diagnostics.empty() || !result.typeErrors.empty())
+    return FALSE;
+  CodeGenerator gen(code, result.symbols);
+  char s[4096];
+  snprintf(s, sizeof(s), "File: %s", codefile);
+  gen.emitComment("TINY Compilation to TM Code");
+  gen.emitComment(s);
+  /* generate standard prelude */
+  gen.emitComment("Standard prelude:");
+  gen.emitRM("LD", mp, 0, ac, "load maxaddress from location 0");
+  gen.emitRM("ST", ac, 0, ac, "clear location 0");
+  gen.emitComment("End of standard prelude.");
+  /* generate code for TINY program */
+  gen.cGen(result.tree);
+  /* finish */
+  gen.emitComment("End of execution.");
+  gen.emitRO("HALT", 0, 0, 0, "");
+  return TRUE;
+}
@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: cgen.h                                     */
+/* The code generator interface to the TINY         */
+/* compiler                                         */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+#ifndef _CGEN_H_
+#define _CGEN_H_
+
+#include "analyze.h"
+#include <stdio.h>
+
+/* Procedure codeGen generates TM code for the tree
+ * of result to the code file by traversal of the
+ * syntax tree. The third parameter (codefile) is
+ * the file name of the code file, and is used to
+ * print the file name as a comment in the code
+ * file when TraceCode is set. Like Louden's, the
+ * code is written in the order it is generated, so
+ * jumps forward are backpatched onto earlier
+ * locations. It returns FALSE, writing nothing,
+ * for a tree that compileBytecode refuses
+ */
+int codeGen(const AnalyzeResult &result, FILE *code, const char *codefile);
+
+#endif
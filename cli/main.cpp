@@ -0,0 +1,207 @@
+/****************************************************/
+/* File: main.cpp                                   */
+/* tinycheck: analyzes many TINY sources on all     */
+/* cores and reports diagnostics and throughput as  */
+/* JSON lines                                       */
+/****************************************************/
+
+#include "analyze.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "workpool.h"
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/* FileReport is what a worker keeps of one file
+ * once its tree has been dropped
+ */
+struct FileReport {
+  std::vector<Diagnostic> diagnostics;
+  long tokens = 0;
+  long nodes = 0;
+  size_t bytes = 0;
+};
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: tinycheck [-j threads] [-l listfile] [-q] path...\n"
+          "  path      a .tny file, a directory searched for .tny files,\n"
+          "            or - for stdin, scanned and parsed on two threads\n"
+          "  -l file   read more paths from file, one per line (- = stdin)\n"
+          "  -j n      worker threads (default: one per core); a single\n"
+          "            file has its statements parsed on all of them\n"
+          "  -q        report only files with diagnostics\n");
+}
+
+/* addPath appends path, or every .tny file below
+ * it if it is a directory
+ */
+static void addPath(const std::string &path, std::vector<std::string> &files) {
+  std::error_code ec;
+  if (fs::is_directory(path, ec)) {
+    for (fs::recursive_directory_iterator it(path, ec), end; it != end;
+         it.increment(ec))
+      if (it->is_regular_file(ec) && it->path().extension() == ".tny")
+        files.push_back(it->path().string());
+  } else
+    files.push_back(path);
+}
+
+static bool addList(const char *list, std::vector<std::string> &files) {
+  FILE *f = strcmp(list, "-") ? fopen(list, "r") : stdin;
+  if (f == NULL)
+    return false;
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    size_t n = strcspn(line, "\r\n");
+    line[n] = '\0';
+    if (n > 0)
+      addPath(line, files);
+  }
+  if (f != stdin)
+    fclose(f);
+  return true;
+}
+
+/* analyzeFile analyzes the file at path, or stdin
+ * for "-"
+ */
+static std::unique_ptr<AnalyzeResult> analyzeFile(const std::string &path) {
+  return path == "-" ? analyzeStream(stdin) : analyzeCode(path.c_str());
+}
+
+/* fillReport keeps what the report of file needs
+ * of its analysis; stdin has the size where its
+ * ENDFILE token is
+ */
+static void fillReport(FileReport &r, const std::string &file,
+                       AnalyzeResult &result) {
+  r.diagnostics = std::move(result.diagnostics);
+  r.diagnostics.insert(r.diagnostics.end(), result.typeErrors.begin(),
+                       result.typeErrors.end());
+  r.tokens = (long)result.tokens.size();
+  r.nodes = result.nodes;
+  if (file == "-") {
+    r.bytes = result.tokens.empty() ? 0 : result.tokens.back().offset;
+    return;
+  }
+  std::error_code ec;
+  uintmax_t size = fs::file_size(file, ec);
+  r.bytes = ec ? 0 : (size_t)size;
+}
+
+/* printString writes s as a JSON string literal */
+static void printString(FILE *out, const std::string &s) {
+  fputc('"', out);
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\')
+      fprintf(out, "\\%c", c);
+    else if (c == '\n')
+      fputs("\\n", out);
+    else if (c < 0x20)
+      fprintf(out, "\\u%04x", c);
+    else
+      fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+static void printReport(FILE *out, const std::string &file,
+                        const FileReport &r) {
+  fputs("{\"file\":", out);
+  printString(out, file);
+  fprintf(out, ",\"ok\":%s,\"bytes\":%zu,\"tokens\":%ld,\"nodes\":%ld",
+          r.diagnostics.empty() ? "true" : "false", r.bytes, r.tokens,
+          r.nodes);
+  fputs(",\"diagnostics\":[", out);
+  for (size_t i = 0; i < r.diagnostics.size(); i++) {
+    const Diagnostic &d = r.diagnostics[i];
+    fprintf(out, "%s{\"line\":%d,\"column\":%d,\"code\":\"%s\",\"message\":",
+            i ? "," : "", d.line, d.column, diagCodeName(d.code));
+    printString(out, d.message);
+    fputc('}', out);
+  }
+  fputs("]}\n", out);
+}
+
+int main(int argc, char *argv[]) {
+  int threads = 0;
+  bool quiet = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+      if (!addList(argv[++i], files)) {
+        fprintf(stderr, "tinycheck: cannot read %s\n", argv[i]);
+        return 2;
+      }
+    } else if (!strcmp(argv[i], "-q"))
+      quiet = true;
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage();
+      return 2;
+    } else
+      addPath(argv[i], files);
+  }
+  if (files.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<FileReport> reports(files.size());
+  auto start = std::chrono::steady_clock::now();
+  {
+    WorkPool pool(threads);
+    threads = pool.size();
+    if (files.size() == 1) {
+      /* a single file has its statements parsed on
+       * all the threads instead
+       */
+      SourceBuffer buffer;
+      std::unique_ptr<AnalyzeResult> result =
+          files[0] != "-" && buffer.map(files[0].c_str())
+              ? analyzeParallel(buffer.data(), buffer.size(), pool)
+              : analyzeFile(files[0]);
+      fillReport(reports[0], files[0], *result);
+    } else {
+      for (size_t i = 0; i < files.size(); i++)
+        pool.submit([&, i] {
+          fillReport(reports[i], files[i], *analyzeFile(files[i]));
+        });
+      pool.wait();
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  long failed = 0, tokens = 0, nodes = 0;
+  size_t bytes = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    const FileReport &r = reports[i];
+    failed += !r.diagnostics.empty();
+    tokens += r.tokens;
+    nodes += r.nodes;
+    bytes += r.bytes;
+    if (!quiet || !r.diagnostics.empty())
+      printReport(stdout, files[i], r);
+  }
+  if (seconds <= 0)
+    seconds = 1e-9;
+  printf("{\"summary\":{\"files\":%zu,\"failed\":%ld,\"threads\":%d,"
+         "\"seconds\":%.6f,\"bytes\":%zu,\"tokens\":%ld,\"nodes\":%ld,"
+         "\"files_per_s\":%.1f,\"tokens_per_s\":%.1f,\"nodes_per_s\":%.1f,"
+         "\"bytes_per_s\":%.1f}}\n",
+         files.size(), failed, threads, seconds, bytes, tokens, nodes,
+         files.size() / seconds, tokens / seconds, nodes / seconds,
+         bytes / seconds);
+  return failed ? 1 : 0;
+}
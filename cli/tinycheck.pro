@@ -0,0 +1,12 @@
+# tinycheck: headless batch analysis of TINY sources (no Qt)
+
+TEMPLATE = app
+TARGET = tinycheck
+
+CONFIG += console c++17 thread
+CONFIG -= qt app_bundle
+
+include(../core.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,95 @@
+/****************************************************/
+/* File: context.h                                  */
+/* Per-invocation state of the TINY compiler: each  */
+/* analysis owns one, so several can run at once    */
+/****************************************************/
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include "globals.h"
+#include "arena.h"
+#include "diagnostic.h"
+#include "intern.h"
+#include "source.h"
+#include <atomic>
+#include <string_view>
+#include <vector>
+
+/* LineState records where a line starts and whether
+ * the scanner enters it inside a comment, which is
+ * all it needs to resume scanning there
+ */
+typedef struct {
+  unsigned offset; /* offset of the first character */
+  int inComment;   /* TRUE if a comment is open */
+} LineState;
+
+struct Token;
+class TokenFeed;
+
+struct CompilerContext {
+  /* scanner state */
+  const char *text = NULL; /* start of the scanned buffer */
+  size_t textsize = 0;     /* size of the scanned buffer */
+  size_t textpos = 0;      /* start of the next line in text */
+  size_t tokenStart = 0;   /* offset of the current lexeme */
+  const char *lineBuf = ""; /* the current line, inside text */
+  int linepos = 0;          /* current position in lineBuf */
+  int bufsize = 0;          /* current size of lineBuf */
+  int lineno = 0;
+  int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+  int inComment = FALSE; /* TRUE while inside a comment */
+  std::string_view tokenString; /* lexeme of the last token */
+  SourceBuffer sourceBuffer;    /* holds source when read from a stream */
+  /* TRUE reads the source stream a block at a
+   * time, as lines are needed, instead of whole
+   */
+  int streamed = FALSE;
+  /* receives the state at the start of every line
+   * scanned, or NULL
+   */
+  std::vector<LineState> *lineStates = NULL;
+  /* tokens scanned earlier, or NULL: getToken then
+   * replays tokenArray[tokenNext] instead of scanning
+   */
+  const Token *tokenArray = NULL;
+  size_t tokenCount = 0;
+  size_t tokenNext = 0;
+  /* appends tokens to tokenArray when replay runs
+   * out of them, or NULL
+   */
+  TokenFeed *tokenFeed = NULL;
+  size_t echoed = 0; /* offset of the first line not echoed */
+  int echoLine = 0;  /* lines echoed while replaying */
+
+  /* parser state */
+  TokenType token = ENDFILE; /* holds current token */
+
+  FILE *source = NULL;  /* source code text file */
+  FILE *listing = NULL; /* listing output text file, or NULL */
+  FILE *code = NULL;    /* code text file for TM simulator */
+
+  /* storage of the syntax tree, or NULL for malloc */
+  Arena *arena = NULL;
+  /* canonical identifier strings, or NULL */
+  InternTable *names = NULL;
+  /* receives every error, or NULL */
+  std::vector<Diagnostic> *diagnostics = NULL;
+
+  /* set by another thread to abandon the run: the
+   * scanner and token replay then skip to ENDFILE.
+   * NULL if the run cannot be cancelled
+   */
+  const std::atomic<bool> *cancel = NULL;
+
+  /* Error = TRUE prevents further passes if an error occurs */
+  int Error = FALSE;
+
+  /* work counters */
+  long tokens = 0; /* tokens returned by getToken */
+  long nodes = 0;  /* syntax tree nodes created */
+  int depth = 0;    /* current recursion of the parser */
+  int maxDepth = 0; /* deepest recursion so far */
+};
+
+#endif
@@ -0,0 +1,58 @@
+# Compiler core shared by the Dialog and the Qt-free targets
+
+INCLUDEPATH += $$PWD
+CONFIG += thread
+
+# the scanner skips character runs 16 bytes at a time with SSE2;
+# CONFIG+=avx2 builds 32-byte kernels for CPUs that have AVX2
+avx2 {
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+    else: QMAKE_CXXFLAGS += -mavx2
+}
+
+# the per-phase timers of AnalyzeStats are built in unless
+# CONFIG+=nostats compiles them away
+nostats: DEFINES += NO_STATS
+
+SOURCES += \
+    $$PWD/analyze.cpp \
+    $$PWD/arena.cpp \
+    $$PWD/bytecode.cpp \
+    $$PWD/cgen.cpp \
+    $$PWD/incremental.cpp \
+    $$PWD/intern.cpp \
+    $$PWD/jit.cpp \
+    $$PWD/parallel.cpp \
+    $$PWD/parse.cpp \
+    $$PWD/pipeline.cpp \
+    $$PWD/scan.cpp \
+    $$PWD/source.cpp \
+    $$PWD/symtab.cpp \
+    $$PWD/tm.cpp \
+    $$PWD/util.cpp \
+    $$PWD/vm.cpp \
+    $$PWD/workpool.cpp
+
+HEADERS += \
+    $$PWD/analyze.h \
+    $$PWD/arena.h \
+    $$PWD/bytecode.h \
+    $$PWD/cgen.h \
+    $$PWD/context.h \
+    $$PWD/incremental.h \
+    $$PWD/intern.h \
+    $$PWD/jit.h \
+    $$PWD/diagnostic.h \
+    $$PWD/globals.h \
+    $$PWD/parallel.h \
+    $$PWD/parse.h \
+    $$PWD/pipeline.h \
+    $$PWD/runtime.h \
+    $$PWD/scan.h \
+    $$PWD/source.h \
+    $$PWD/stats.h \
+    $$PWD/symtab.h \
+    $$PWD/tm.h \
+    $$PWD/util.h \
+    $$PWD/vm.h \
+    $$PWD/workpool.h
@@ -0,0 +1,38 @@
+/****************************************************/
+/* File: diagnostic.h                               */
+/* Structured error reports of the TINY compiler    */
+/****************************************************/
+#ifndef _DIAGNOSTIC_H_
+#define _DIAGNOSTIC_H_
+
+#include <string>
+
+typedef enum {
+  UnexpectedTokenD, /* the parser met a token it cannot use */
+  TrailingCodeD,    /* code follows the end of the program */
+  SourceNotFoundD,  /* the source file cannot be opened */
+  OutOfMemoryD,
+  TypeMismatchD,    /* an operand or test has the wrong type */
+  DivisionByZeroD,  /* a running program divided by 0 */
+  NoInputD,         /* a running program read past its input */
+  MemoryFaultD      /* a TM program left its memory */
+} DiagCode;
+
+/* A Diagnostic with no token to point at has 0 for
+ * its column, as type errors, which are found on
+ * the tree; one with no source line, as a missing
+ * file, has 0 for both
+ */
+typedef struct {
+  int line;   /* 1-based source line, or 0 */
+  int column; /* 1-based column of the offending token, or 0 */
+  DiagCode code;
+  std::string message;
+} Diagnostic;
+
+/* Function diagCodeName returns a stable
+ * identifier for code, e.g. "unexpected-token"
+ */
+const char *diagCodeName(DiagCode code);
+
+#endif
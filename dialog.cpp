@@ -1,101 +1,290 @@
-#include "dialog.h"
-#include "QDebug"
-#include "QDir"
-#include "QFileDialog"
-#include "QMessageBox"
-#include "QTextStream"
-#include "ui_dialog.h"
-
-Dialog::Dialog(QWidget *parent) : QDialog(parent), ui(new Ui::Dialog) {
-  ui->setupUi(this);
-}
-
-Dialog::~Dialog() { delete ui; }
-
-void Dialog::on_chooseFile_clicked() {
-  // 获取文件名
-  QString fileName{
-      QFileDialog::getOpenFileName(this, "打开源文件", ".", "源文件(*.tny);;文本文件(*.txt, *)")};
-  // 构造文件对象
-  QFile file{fileName};
-
-  if (fileName.isEmpty())
-    return;
-
-  // 读取全部内容
-  if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    ui->source->setText(file.readAll());
-    QMessageBox::information(this, "提示", "读取成功");
-    file.close();
-  }
-
-  // 文件打开失败
-  else
-    QMessageBox::information(this, "提示", "读取失败");
-}
-
-void Dialog::on_saveFile_clicked() {
-  QString tempPath = QDir::homePath();
-  QString savePath = QFileDialog::getSaveFileName(this, tr("SaveSourceCode"), tempPath, "TINY(*.tny);;TEXT(*.txt, *)");
-  if (savePath.isEmpty())
-    return;
-  QFile file(savePath);
-  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-    QMessageBox::information(this, "提示", "文件保存失败");
-    return;
-  }
-  // 写文件
-  QString content = ui->source->toPlainText().toUtf8();
-  QTextStream out(&file);
-  out << content << '\n';
-  file.close();
-  QMessageBox::information(this, "提示", "文件保存成功");
-}
-
-void Dialog::on_analyze_clicked() {
-  QString sourcePath = QDir::tempPath() + "/TinySourceCode";
-//  QString resPath = QDir::tempPath() + "/TinyResult";
-  QString errPath = QDir::tempPath() + "/TinyError";
-  QFile source(sourcePath);
-  if (!source.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-    QMessageBox::information(this, "提示", "缺失文件访问权限");
-    return;
-  }
-  qDebug() << "分析源程序：" << ui->source->toPlainText() << '\n' << "临时文件: " << sourcePath << '\n' ;
-
-  QTextStream out(&source);
-  out << ui->source->toPlainText().toUtf8();
-  source.close();
-
-  TreeNode* node = analyzeCode(sourcePath.toStdString().c_str(), errPath.toStdString().c_str());
-  QFile error(errPath);
-  if (!error.open(QIODevice::ReadWrite)) {
-    QMessageBox::information(this, "提示", "结果解析失败");
-    return;
-  }
-  QString parseErr = error.readAll().trimmed();
-  ui->error->setText(parseErr.size() == 0 ? "未发现错误" : parseErr);
-  error.close();
-
-  ui->result->clear();
-  traverseTree(node, 0);
-  QMessageBox::information(this, "提示", "解析成功");
-  // 删除临时文件
-  QFile::remove(sourcePath);
-  QFile::remove(errPath);
-}
-
-void Dialog::traverseTree(TreeNode* tree, QTreeWidgetItem* p) {
-  if (tree == NULL) return;
-  QTreeWidgetItem *item;
-  while (tree) {
-    if (p == 0)
-        item = new QTreeWidgetItem(ui->result);
-    else
-        item = new QTreeWidgetItem(p);
-    item->setText(0, getTreeNodeInfo(tree));
-    for (int i = 0; i < MAXCHILDREN; ++i)
-        traverseTree(tree->child[i], item);
-    tree = tree->sibling;
-  }
-}
+#include "dialog.h"
+#include "QDebug"
+#include "QDir"
+#include "QFileDialog"
+#include "QFutureWatcher"
+#include "QMessageBox"
+#include "QTextBlock"
+#include "QTextCursor"
+#include "QTextDocument"
+#include "QTextStream"
+#include "QtConcurrent"
+#include "ui_dialog.h"
+
+// 边输入边分析时，停止输入这么多毫秒后才开始分析
+#define DEBOUNCEMS 300
+
+Dialog::Dialog(QWidget *parent) : QDialog(parent), ui(new Ui::Dialog) {
+  ui->setupUi(this);
+  model = new SyntaxTreeModel(this);
+  ui->result->setModel(model);
+  // 每次编辑后只重新分析改动的部分
+  connect(ui->source->document(), &QTextDocument::contentsChange, this,
+          &Dialog::sourceChanged);
+  // 着色时直接读取增量分析的记号，须在上面的连接之后创建
+  highlighter = new TinyHighlighter(ui->source->document(), &incremental);
+  debounce.setSingleShot(true);
+  debounce.setInterval(DEBOUNCEMS);
+  connect(&debounce, &QTimer::timeout, this, &Dialog::settle);
+}
+
+Dialog::~Dialog() {
+  // 后台的分析不再需要，让它尽快结束
+  cancelAnalysis();
+  delete ui;
+}
+
+void Dialog::on_chooseFile_clicked() {
+  // 获取文件名
+  QString fileName{
+      QFileDialog::getOpenFileName(this, "打开源文件", ".", "源文件(*.tny);;文本文件(*.txt, *)")};
+  // 构造文件对象
+  QFile file{fileName};
+
+  if (fileName.isEmpty())
+    return;
+
+  // 读取全部内容
+  if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QByteArray content;
+    readNs = 0;
+    {
+      PhaseTimer timer(readNs);
+      content = file.readAll();
+    }
+    ui->source->setText(content);
+    ui->status->setText("读取成功");
+    file.close();
+  }
+
+  // 文件打开失败
+  else
+    QMessageBox::information(this, "提示", "读取失败");
+}
+
+void Dialog::on_saveFile_clicked() {
+  QString tempPath = QDir::homePath();
+  QString savePath = QFileDialog::getSaveFileName(this, tr("SaveSourceCode"), tempPath, "TINY(*.tny);;TEXT(*.txt, *)");
+  if (savePath.isEmpty())
+    return;
+  QFile file(savePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    QMessageBox::information(this, "提示", "文件保存失败");
+    return;
+  }
+  // 写文件
+  QString content = ui->source->toPlainText().toUtf8();
+  QTextStream out(&file);
+  out << content << '\n';
+  file.close();
+  QMessageBox::information(this, "提示", "文件保存成功");
+}
+
+void Dialog::on_analyze_clicked() { startAnalysis(); }
+
+// 关闭时不停计时器，落后的增量分析仍要在停止输入后对齐
+void Dialog::on_liveAnalyze_toggled(bool checked) {
+  if (checked)
+    startAnalysis();
+}
+
+// 停止输入片刻后：先对齐落后的增量分析，再按需分析
+void Dialog::settle() {
+  syncSource();
+  if (ui->liveAnalyze->isChecked())
+    startAnalysis();
+}
+
+// 把增量分析与整段源码对齐，花的时间与源码长度相当，
+// 所以只在停止输入后或要分析时才做，不在每次按键时做
+void Dialog::syncSource() {
+  if (!resync)
+    return;
+  resync = false;
+  QString plain = ui->source->toPlainText();
+  QByteArray text = plain.toUtf8();
+  incremental.update(text.constData(), text.size());
+  characters = plain.size();
+  // 落后期间着色跳过了改动的行
+  highlighter->setStale(false);
+  highlighter->rehighlight();
+  showEditStats();
+}
+
+// 增量分析已有语法树，复制一份交给后台线程建立符号表、检查类型，界面不必等待；
+// 之后的改动会取消它，结果只在仍对应当前源码时才显示
+void Dialog::startAnalysis() {
+  debounce.stop();
+  syncSource();
+  cancelAnalysis();
+  auto cancel = std::make_shared<std::atomic<bool>>(false);
+  running = cancel;
+  unsigned current = revision;
+  std::shared_ptr<AnalyzeResult> analysis = incremental.analysis();
+  using Result = std::shared_ptr<const AnalyzeResult>;
+  auto *watcher = new QFutureWatcher<Result>(this);
+  connect(watcher, &QFutureWatcher<Result>::finished, this,
+          [this, watcher, cancel, current] {
+            Result analysis = watcher->result();
+            watcher->deleteLater();
+            if (running == cancel)
+              running.reset();
+            if (analysis && current == revision)
+              applyAnalysis(analysis);
+          });
+  watcher->setFuture(QtConcurrent::run([analysis, cancel]() -> Result {
+    {
+      PhaseTimer timer(analysis->stats.analyzeNs);
+      buildSymtab(analysis->symbols, analysis->tree);
+    }
+    if (cancel->load())
+      return nullptr;
+    {
+      PhaseTimer timer(analysis->stats.typeNs);
+      typeCheck(analysis->tree, analysis->typeErrors);
+    }
+    countStats(*analysis);
+    return analysis;
+  }));
+  ui->status->setText("正在分析…");
+}
+
+// 取消正在进行的分析，它的结果不再显示
+void Dialog::cancelAnalysis() {
+  if (running) {
+    running->store(true);
+    running.reset();
+  }
+}
+
+// 在界面线程上显示分析结果
+void Dialog::applyAnalysis(std::shared_ptr<const AnalyzeResult> analysis) {
+  QStringList errors;
+  for (const Diagnostic &d : analysis->diagnostics)
+    errors << QString(">>> Syntax error at line %1, column %2: %3")
+                  .arg(d.line)
+                  .arg(d.column)
+                  .arg(QString::fromStdString(d.message));
+  for (const Diagnostic &d : analysis->typeErrors)
+    errors << QString(">>> Type error at line %1: %2")
+                  .arg(d.line)
+                  .arg(QString::fromStdString(d.message));
+  ui->error->setText(errors.isEmpty() ? "未发现错误" : errors.join('\n'));
+
+  // 先放下旧的语法树，再只显示新树的顶层节点，其余在展开时再取出
+  freeNs = viewNs = 0;
+  {
+    PhaseTimer timer(freeNs);
+    model->setAnalysis(nullptr);
+  }
+  {
+    PhaseTimer timer(viewNs);
+    model->setAnalysis(analysis);
+  }
+  showStats(analysis->stats);
+}
+
+// 把字符位置上的改动换算成字节：改动所在行的起点取自增量分析的行表，
+// 删去的字符按旧文本的 UTF-8 编码逐个跳过，只花与改动大小相当的时间；
+// 换算不了时返回 false
+bool Dialog::mapEdit(int position, int removed, int added, size_t &pos,
+                     size_t &removedBytes, QByteArray &bytes) {
+  const std::string &text = incremental.text();
+  QTextBlock block = ui->source->document()->findBlock(position);
+  if (!block.isValid())
+    return false;
+  size_t n = (size_t)block.blockNumber();
+  size_t start;
+  if (n < incremental.lineCount())
+    start = incremental.line(n).offset;
+  // 空的最后一行不在行表里
+  else if (n == incremental.lineCount() && (n == 0 || text.back() == '\n'))
+    start = text.size();
+  else
+    return false;
+  pos = start + block.text().left(position - block.position()).toUtf8().size();
+  // UTF-16 的字符数：四字节的 UTF-8 字符占两个
+  size_t end = pos;
+  int units = removed;
+  while (units > 0 && end < text.size()) {
+    unsigned char c = (unsigned char)text[end];
+    int length = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+    units -= length == 4 ? 2 : 1;
+    end += length;
+  }
+  if (units != 0 || end > text.size())
+    return false;
+  removedBytes = end - pos;
+  QTextCursor cursor(ui->source->document());
+  cursor.setPosition(position);
+  cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+  QString s = cursor.selectedText().replace(QChar::ParagraphSeparator, '\n');
+  if (s.size() != added)
+    return false;
+  bytes = s.toUtf8();
+  return true;
+}
+
+void Dialog::sourceChanged(int position, int removed, int added) {
+  size_t pos, removedBytes;
+  QByteArray bytes;
+  bool mapped = !resync && mapEdit(position, removed, added, pos,
+                                   removedBytes, bytes);
+  // 着色只改格式，文字没变
+  if (mapped && (size_t)bytes.size() == removedBytes &&
+      incremental.text().compare(pos, removedBytes, bytes.constData(),
+                                 bytes.size()) == 0)
+    return;
+  // 源码变了，正在进行的分析已经过时
+  revision++;
+  cancelAnalysis();
+  if (mapped) {
+    incremental.edit(pos, removedBytes, bytes.constData(), bytes.size());
+    characters += added - removed;
+    mapped = characters == ui->source->document()->characterCount() - 1;
+  }
+  // 否则等停止输入后再与整段文本比较，不在每次按键时取出全文
+  if (!mapped) {
+    resync = true;
+    highlighter->setStale(true);
+  } else
+    showEditStats();
+  if (resync || ui->liveAnalyze->isChecked())
+    debounce.start();
+}
+
+// 编辑后只显示增量分析的计数，不与上次完整分析的各阶段耗时混在一起
+void Dialog::showEditStats() {
+  ui->status->setText(QString("编辑后：记号 %1  节点 %2  错误 %3")
+                          .arg(incremental.tokenCount())
+                          .arg(incremental.nodeCount())
+                          .arg(incremental.diagnosticCount()));
+}
+
+// 在状态栏显示一次分析各阶段的耗时与计数
+void Dialog::showStats(const AnalyzeStats &s) {
+  QString counts =
+      QString("记号 %1  节点 %2  变量 %3  内存 %4 KB  错误 %5  类型错误 %6")
+          .arg(s.tokens)
+          .arg(s.nodes)
+          .arg(s.symbols)
+          .arg((qulonglong)(s.bytes / 1024))
+          .arg(s.diagnostics)
+          .arg(s.typeErrors);
+#ifndef NO_STATS
+  auto ms = [](int64_t ns) { return QString::number(ns / 1e6, 'f', 2); };
+  ui->status->setText(
+      QString("读取 %1 ms  扫描 %2 ms  语法分析 %3 ms  符号表 %4 ms  类型检查 %5 ms  树视图 %6 ms  释放 %7 ms\n")
+          .arg(ms(readNs))
+          .arg(ms(s.scanNs))
+          .arg(ms(s.parseNs))
+          .arg(ms(s.analyzeNs))
+          .arg(ms(s.typeNs))
+          .arg(ms(viewNs))
+          .arg(ms(freeNs)) +
+      counts + QString("  最大递归深度 %1").arg(s.maxDepth));
+#else
+  // 计时与递归深度在编译时关闭了
+  ui->status->setText(counts);
+#endif
+}
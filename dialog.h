@@ -1,34 +1,63 @@
-//#ifndef DIALOG_H
-//#define DIALOG_H
-#pragma once
-
-#include <QDialog>
-#include "analyze.h"
-#include <QTreeWidget>
-
-QT_BEGIN_NAMESPACE
-
-namespace Ui { class Dialog; }
-
-QT_END_NAMESPACE
-
-class Dialog : public QDialog
-{
-    Q_OBJECT
-
-public:
-    Dialog(QWidget *parent = nullptr);
-    ~Dialog();
-
-private slots:
-    void on_chooseFile_clicked();
-
-    void on_saveFile_clicked();
-
-    void on_analyze_clicked();
-
-private:
-    Ui::Dialog *ui;
-    void traverseTree(TreeNode*, QTreeWidgetItem *);
-};
-//#endif // DIALOG_H
+//#ifndef DIALOG_H
+//#define DIALOG_H
+#pragma once
+
+#include <QDialog>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include "analyze.h"
+#include "highlighter.h"
+#include "incremental.h"
+#include "treemodel.h"
+
+QT_BEGIN_NAMESPACE
+
+namespace Ui { class Dialog; }
+
+QT_END_NAMESPACE
+
+class Dialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    Dialog(QWidget *parent = nullptr);
+    ~Dialog();
+
+private slots:
+    void on_chooseFile_clicked();
+
+    void on_saveFile_clicked();
+
+    void on_analyze_clicked();
+
+    void on_liveAnalyze_toggled(bool checked);
+
+    void sourceChanged(int position, int removed, int added);
+
+private:
+    void settle();
+    void syncSource();
+    bool mapEdit(int position, int removed, int added, size_t &pos,
+                 size_t &removedBytes, QByteArray &bytes);
+    void startAnalysis();
+    void cancelAnalysis();
+    void applyAnalysis(std::shared_ptr<const AnalyzeResult> analysis);
+    void showStats(const AnalyzeStats &s);
+    void showEditStats();
+
+    Ui::Dialog *ui;
+    IncrementalParser incremental;           // 随编辑增量更新的分析结果
+    bool resync = false;                     // 有改动没能换算成字节，增量分析落后于源码
+    long characters = 0;                     // 增量分析对应的源码字符数
+    SyntaxTreeModel *model;                  // 语法树视图的数据，按需展开
+    TinyHighlighter *highlighter;            // 用分析得到的记号为源码着色
+    int64_t readNs = 0;                      // 上次读取源文件的耗时
+    int64_t viewNs = 0;                      // 上次建立语法树视图的耗时
+    int64_t freeNs = 0;                      // 上次释放旧语法树的耗时
+    unsigned revision = 0;                   // 源码每改动一次加一
+    std::shared_ptr<std::atomic<bool>> running; // 后台分析的取消标志，没有则为空
+    QTimer debounce;                         // 停止输入片刻后才对齐源码、边输入边分析
+};
+//#endif // DIALOG_H
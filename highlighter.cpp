@@ -0,0 +1,49 @@
+#include "highlighter.h"
+
+TinyHighlighter::TinyHighlighter(QTextDocument *document,
+                                 const IncrementalParser *p)
+    : QSyntaxHighlighter(document), parser(p) {
+  reserved.setForeground(Qt::darkBlue);
+  reserved.setFontWeight(QFont::Bold);
+  number.setForeground(Qt::darkMagenta);
+  comment.setForeground(Qt::darkGreen);
+  error.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+  error.setUnderlineColor(Qt::red);
+}
+
+void TinyHighlighter::highlightBlock(const QString &text) {
+  size_t n = (size_t)currentBlock().blockNumber();
+  size_t lines = parser->lineCount();
+  if (stale || n >= lines)
+    return;
+  const std::string &source = parser->text();
+  size_t start = parser->line(n).offset;
+  size_t end = n + 1 < lines ? parser->line(n + 1).offset : source.size();
+  // 注释跨行时下一行的状态随之改变，Qt 会接着重画下一行
+  setCurrentBlockState(n + 1 < lines ? parser->line(n + 1).inComment : 0);
+
+  // 记号之间只有空白和注释，先整行按注释着色，再逐个覆盖记号
+  setFormat(0, text.size(), comment);
+  size_t bytes = end - start - (end > start && source[end - 1] == '\n');
+  bool ascii = bytes == (size_t)text.size();
+  for (size_t i = parser->firstToken(start); i < parser->tokenCount(); i++) {
+    Token t = parser->token(i);
+    if (t.offset >= end || t.type == ENDFILE)
+      break;
+    int column = (int)(t.offset - start), length = (int)t.length;
+    // 含多字节字符的行要把字节偏移换算成字符位置
+    if (!ascii) {
+      column = QString::fromUtf8(source.data() + start, column).size();
+      length = QString::fromUtf8(source.data() + t.offset, length).size();
+    }
+    TokenType type = (TokenType)t.type;
+    if (type >= IF && type <= NOT)
+      setFormat(column, length, reserved);
+    else if (type == NUM)
+      setFormat(column, length, number);
+    else if (type == ERROR)
+      setFormat(column, length, error);
+    else
+      setFormat(column, length, QTextCharFormat());
+  }
+}
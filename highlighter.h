@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QSyntaxHighlighter>
+#include <QTextCharFormat>
+#include "incremental.h"
+
+// 按增量分析已有的记号着色，不再另行扫描源码；
+// 须在 Dialog::sourceChanged 之后连接 contentsChange，才能读到新记号
+class TinyHighlighter : public QSyntaxHighlighter
+{
+    Q_OBJECT
+
+public:
+    TinyHighlighter(QTextDocument *document, const IncrementalParser *parser);
+
+    // 增量分析落后于源码时，记号对不上各行，暂不着色
+    void setStale(bool s) { stale = s; }
+
+protected:
+    void highlightBlock(const QString &text) override;
+
+private:
+    const IncrementalParser *parser;
+    bool stale = false;
+    QTextCharFormat reserved;   // 保留字
+    QTextCharFormat number;
+    QTextCharFormat comment;    // 记号之间的注释
+    QTextCharFormat error;      // 非法字符
+};
@@ -0,0 +1,386 @@
+/****************************************************/
+/* File: incremental.cpp                            */
+/* Incremental re-scanning and re-parsing           */
+/****************************************************/
+
+#include "incremental.h"
+#include "parse.h"
+#include "util.h"
+#include <algorithm>
+
+/* replaced statements stay in the arena until
+ * their nodes outnumber both MINGARBAGE and the
+ * live ones; the text is then analyzed afresh
+ */
+#define MINGARBAGE 65536
+
+/* the parser gets the tokens after an edit
+ * FEEDTOKENS at a time
+ */
+#define FEEDTOKENS 1024
+
+/* firstAt returns the index of the first element
+ * of v, from from on, whose offset is at least
+ * offset
+ */
+template <typename T, typename Mover>
+static size_t firstAt(const GapBuffer<T, Mover> &v, size_t from,
+                      size_t offset) {
+  size_t lo = from, hi = v.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (v.get(mid).offset < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* A GapFeed lets the parser read the tokens of a
+ * GapBuffer, moving the gap past them as it goes:
+ * only the tokens before the gap are up to date
+ */
+template <typename Mover> class GapFeed : public TokenFeed {
+public:
+  explicit GapFeed(GapBuffer<Token, Mover> &tokens) : tokens(tokens) {}
+
+  void refill(CompilerContext &ctx) override {
+    tokens.moveGap(std::min(tokens.size(),
+                            std::max(ctx.tokenNext + 1,
+                                     tokens.gap() + FEEDTOKENS)));
+    ctx.tokenArray = tokens.data();
+    ctx.tokenCount = tokens.gap();
+  }
+
+private:
+  GapBuffer<Token, Mover> &tokens;
+};
+
+/* hasName returns TRUE if attr.name is what t holds */
+static int hasName(const TreeNode *t) {
+  if (t->nodekind == ExpK)
+    return t->kind.exp == IdK;
+  return t->kind.stmt != IfK && t->kind.stmt != RepeatK &&
+         t->kind.stmt != WriteK;
+}
+
+/* copyTree copies t, its siblings and all their
+ * children into the arena of result, moved lines
+ * down, with the names of result: ids maps the ids
+ * of names to those there, or to -1 until known
+ */
+static TreeNode *copyTree(AnalyzeResult &result, const InternTable &names,
+                          const TreeNode *t, int lines,
+                          std::vector<int> &ids) {
+  TreeNode *copy = NULL;
+  std::vector<std::pair<const TreeNode *, TreeNode **>> stack{{t, &copy}};
+  while (!stack.empty()) {
+    const TreeNode *from = stack.back().first;
+    TreeNode **to = stack.back().second;
+    stack.pop_back();
+    for (; from != NULL; from = from->sibling) {
+      TreeNode *c = (TreeNode *)result.arena.allocate(sizeof(TreeNode),
+                                                      alignof(TreeNode));
+      if (c == NULL)
+        break;
+      *c = *from;
+      c->lineno += lines;
+      c->sibling = NULL;
+      if (from->symbol >= 0) {
+        int &id = ids[from->symbol];
+        if (id < 0)
+          id = result.names.intern(names.name(from->symbol));
+        c->symbol = id;
+      }
+      if (c->symbol >= 0)
+        c->attr.name = (char *)result.names.name(c->symbol);
+      else if (hasName(from) && from->attr.name != NULL)
+        c->attr.name = result.arena.copyString(from->attr.name,
+                                               strlen(from->attr.name));
+      for (int i = MAXCHILDREN - 1; i >= 0; i--) {
+        c->child[i] = NULL;
+        if (from->child[i] != NULL)
+          stack.push_back({from->child[i], &c->child[i]});
+      }
+      *to = c;
+      to = &c->sibling;
+    }
+  }
+  return copy;
+}
+
+IncrementalParser::IncrementalParser()
+    : end(0), nodes(0), garbage(0), diagnostics(0), scanNs(0), parseNs(0),
+      scanned(0), parsed(0) {
+  analyzeAll();
+}
+
+void IncrementalParser::reset(const char *text, size_t size) {
+  source.assign(text, size);
+  analyzeAll();
+}
+
+void IncrementalParser::analyzeAll() {
+  std::vector<Step> noSteps;
+  steps.assign(noSteps);
+  storage.reset(new Storage);
+  nodes = garbage = diagnostics = 0;
+  trailing.clear();
+  CompilerContext ctx;
+  std::vector<LineState> newLines;
+  std::vector<Token> newTokens;
+  setScanBuffer(ctx, source.data(), source.size());
+  ctx.lineStates = &newLines;
+  {
+    PhaseTimer timer(scanNs);
+    tokenize(ctx, newTokens);
+  }
+  scanned = (long)newTokens.size();
+  tokens.assign(newTokens);
+  lines.assign(newLines);
+  PhaseTimer timer(parseNs);
+  parseSteps(0, 0, 0);
+  finish();
+}
+
+void IncrementalParser::update(const char *text, size_t size) {
+  size_t n = std::min(size, source.size());
+  size_t head = 0;
+  while (head < n && text[head] == source[head])
+    head++;
+  size_t tail = 0;
+  while (tail < n - head &&
+         text[size - 1 - tail] == source[source.size() - 1 - tail])
+    tail++;
+  if (head == n && size == source.size()) {
+    scanned = parsed = 0;
+    return;
+  }
+  edit(head, source.size() - head - tail, text + head, size - head - tail);
+}
+
+void IncrementalParser::edit(size_t pos, size_t removed, const char *added,
+                             size_t addedSize) {
+  pos = std::min(pos, source.size());
+  removed = std::min(removed, source.size() - pos);
+  source.replace(pos, removed, added, addedSize);
+  if (garbage > MINGARBAGE && garbage > nodes) {
+    analyzeAll();
+    return;
+  }
+  long byteDelta = (long)addedSize - (long)removed;
+
+  /* rescan from the start of the line holding pos */
+  size_t line = firstAt(lines, 0, pos + 1);
+  if (line > 0)
+    line--;
+  LineState start = lines.size() == 0 ? LineState{0, FALSE} : lines.get(line);
+  size_t first = firstAt(tokens, 0, start.offset);
+
+  CompilerContext ctx;
+  std::vector<LineState> newLines;
+  std::vector<Token> newTokens;
+  setScanBuffer(ctx, source.data(), source.size());
+  setScanPosition(ctx, start.offset, (int)line + 1, start.inComment);
+  ctx.lineStates = &newLines;
+  size_t oldLine = lines.size(), oldToken = tokens.size();
+  size_t checked = 0;
+  {
+    PhaseTimer timer(scanNs);
+    for (;;) {
+      Token t = scanToken(ctx);
+      /* the scanner is back in step once a line after
+       * the edit starts where an old line did and in
+       * the same state: from there on it would only
+       * repeat the old tokens, moved by the edit
+       */
+      for (; checked < newLines.size(); checked++) {
+        size_t at = newLines[checked].offset;
+        if (at < pos + addedSize)
+          continue;
+        size_t was = (size_t)((long)at - byteDelta);
+        size_t l = firstAt(lines, line, was);
+        if (l < lines.size() && lines.get(l).offset == was &&
+            lines.get(l).inComment == newLines[checked].inComment) {
+          oldLine = l;
+          oldToken = firstAt(tokens, first, was);
+          break;
+        }
+      }
+      if (oldLine < lines.size()) {
+        /* t and the lines from the match on are old */
+        newLines.resize(checked);
+        break;
+      }
+      newTokens.push_back(t);
+      if (t.type == ENDFILE)
+        break;
+    }
+  }
+  scanned = (long)newTokens.size();
+  PhaseTimer timer(parseNs);
+
+  long tokenDelta = (long)newTokens.size() - (long)(oldToken - first);
+  long lineDelta = (long)newLines.size() - (long)(oldLine - line);
+  tokens.replace(first, oldToken, newTokens, Moved{byteDelta, lineDelta, 0});
+  lines.replace(line, oldLine, newLines, Moved{byteDelta, 0, 0});
+
+  /* a step depends on its tokens and the one after
+   * it; steps that end before the edit are kept, and
+   * so are those from the old token oldToken on once
+   * the parse is back in step with them
+   */
+  parsed = 0;
+  if (end >= first) {
+    size_t from = stepAt(oldToken);
+    std::vector<Step> noSteps;
+    steps.replace(from, from, noSteps, Moved{0, lineDelta, tokenDelta});
+    size_t k = stepAt(first);
+    if (k > 0)
+      k--;
+    parseSteps(k, std::max(k + 1, from), tokenDelta);
+  }
+  finish();
+}
+
+/* stepAt returns the index of the first step that
+ * begins at or after token
+ */
+size_t IncrementalParser::stepAt(size_t token) const {
+  size_t lo = 0, hi = steps.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (stepToken(mid) < token)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+unsigned IncrementalParser::stepToken(size_t i) const {
+  Moved by;
+  const Step &s = steps.at(i, &by);
+  return (unsigned)(s.token + by.tokens);
+}
+
+/* parseSteps parses the top-level sequence again
+ * from steps[first] on. It stops at the end of the
+ * sequence or at the first token of an old step
+ * from steps[next] on: parsing would go on as it
+ * did before from there, so that step and all later
+ * ones are kept, and the token that ended the
+ * sequence has moved by tokenDelta
+ */
+void IncrementalParser::parseSteps(size_t first, size_t next,
+                                   long tokenDelta) {
+  GapFeed<TokenMover> feed(tokens);
+  CompilerContext ctx;
+  ctx.text = source.data();
+  ctx.textsize = source.size();
+  ctx.arena = &storage->arena;
+  ctx.names = &storage->names;
+  ctx.tokenFeed = &feed;
+  ctx.tokenArray = tokens.data();
+  ctx.tokenCount = tokens.gap();
+  ctx.tokenNext = first < steps.size() ? stepToken(first) : 0;
+  ctx.token = getToken(ctx);
+
+  std::vector<Step> fresh;
+  int synced = FALSE;
+  for (;;) {
+    Step s;
+    s.token = (unsigned)(ctx.tokenNext - 1);
+    s.lines = 0;
+    ctx.diagnostics = &s.diagnostics;
+    long made = ctx.nodes;
+    ctx.maxDepth = 0;
+    s.tree = parseStatement(ctx, first + fresh.size() == 0);
+    s.nodes = ctx.nodes - made;
+    s.depth = ctx.maxDepth;
+    fresh.push_back(std::move(s));
+    size_t at = ctx.tokenNext - 1;
+    if (sequenceEnds(ctx.token)) {
+      end = (unsigned)at;
+      break;
+    }
+    while (next < steps.size() && stepToken(next) < at)
+      next++;
+    if (next < steps.size() && stepToken(next) == at) {
+      synced = TRUE;
+      break;
+    }
+  }
+  if (!synced)
+    next = steps.size();
+  else
+    end = (unsigned)(end + tokenDelta);
+
+  Moved by;
+  for (size_t i = first; i < next; i++) {
+    const Step &s = steps.at(i, &by);
+    nodes -= s.nodes;
+    garbage += s.nodes;
+    diagnostics -= (long)s.diagnostics.size();
+  }
+  for (const Step &s : fresh) {
+    nodes += s.nodes;
+    diagnostics += (long)s.diagnostics.size();
+  }
+  parsed = (long)fresh.size();
+  steps.replace(first, next, fresh, Moved{0, 0, 0});
+}
+
+/* finish checks the token that ended the sequence */
+void IncrementalParser::finish() {
+  diagnostics -= (long)trailing.size();
+  trailing.clear();
+  Token t = tokens.get(end);
+  CompilerContext ctx;
+  ctx.text = source.data();
+  ctx.textsize = source.size();
+  ctx.tokenArray = &t;
+  ctx.tokenCount = 1;
+  ctx.diagnostics = &trailing;
+  ctx.token = getToken(ctx);
+  parseFinish(ctx);
+  diagnostics += (long)trailing.size();
+}
+
+size_t IncrementalParser::firstToken(size_t offset) const {
+  return firstAt(tokens, 0, offset);
+}
+
+std::unique_ptr<AnalyzeResult> IncrementalParser::analysis() {
+  std::unique_ptr<AnalyzeResult> result(new AnalyzeResult);
+  tokens.copyTo(result->tokens);
+  std::vector<int> ids(storage->names.size(), -1);
+  std::vector<Diagnostic> &out = result->diagnostics;
+  TreeNode *last = NULL;
+  for (size_t i = 0; i < steps.size(); i++) {
+    Moved by;
+    const Step &s = steps.at(i, &by);
+    int moved = s.lines + (int)by.lines;
+    TreeNode *t = copyTree(*result, storage->names, s.tree, moved, ids);
+    if (t != NULL) {
+      if (last == NULL)
+        result->tree = t;
+      else
+        last->sibling = t;
+      last = t;
+    }
+    for (const Diagnostic &d : s.diagnostics) {
+      out.push_back(d);
+      out.back().line += moved;
+    }
+    result->stats.maxDepth = std::max(result->stats.maxDepth, s.depth);
+  }
+  out.insert(out.end(), trailing.begin(), trailing.end());
+  result->nodes = nodes;
+  result->stats.scanNs = scanNs;
+  result->stats.parseNs = parseNs;
+  scanNs = parseNs = 0;
+  countStats(*result);
+  return result;
+}
@@ -0,0 +1,264 @@
+/****************************************************/
+/* File: incremental.h                              */
+/* Incremental re-scanning and re-parsing of a      */
+/* program while it is being edited                 */
+/****************************************************/
+#ifndef _INCREMENTAL_H_
+#define _INCREMENTAL_H_
+
+#include "analyze.h"
+#include "context.h"
+#include "scan.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Moved says how far an edit moved what follows
+ * it: by bytes, by lines and by tokens
+ */
+struct Moved {
+  long bytes;
+  long lines;
+  long tokens;
+};
+
+/* A GapBuffer holds a sequence with a gap where it
+ * was last edited, so that an edit moves only the
+ * elements between it and the edit before, not all
+ * that follow it. The elements before the gap are
+ * up to date; those after it are stored as they
+ * were when the gap passed them, and read through
+ * Mover::move(T &, long sign, const Moved &), which
+ * moves an element by sign times the edits made
+ * since
+ */
+template <typename T, typename Mover> class GapBuffer {
+public:
+  size_t size() const { return store.size() - (gapEnd - gapStart); }
+
+  /* at returns element i as stored, with *by set to
+   * how far it has still to be moved
+   */
+  const T &at(size_t i, Moved *by) const {
+    if (i < gapStart) {
+      *by = Moved{0, 0, 0};
+      return store[i];
+    }
+    *by = pending;
+    return store[i + gapEnd - gapStart];
+  }
+
+  /* get returns a moved copy of element i */
+  T get(size_t i) const {
+    Moved by;
+    T t = at(i, &by);
+    Mover::move(t, 1, by);
+    return t;
+  }
+
+  /* the first gap() elements lie in order at data() */
+  const T *data() const { return store.data(); }
+  size_t gap() const { return gapStart; }
+
+  /* moveGap moves the gap in front of element i */
+  void moveGap(size_t i) {
+    for (; gapStart > i; gapStart--, gapEnd--) {
+      if (gapStart != gapEnd)
+        store[gapEnd - 1] = std::move(store[gapStart - 1]);
+      Mover::move(store[gapEnd - 1], -1, pending);
+    }
+    for (; gapStart < i; gapStart++, gapEnd++) {
+      if (gapStart != gapEnd)
+        store[gapStart] = std::move(store[gapEnd]);
+      Mover::move(store[gapStart], 1, pending);
+    }
+    if (gapEnd == store.size())
+      pending = Moved{0, 0, 0};
+  }
+
+  /* replace puts the elements of with in place of
+   * elements from..to-1 and moves those after them
+   * by
+   */
+  void replace(size_t from, size_t to, std::vector<T> &with,
+               const Moved &by) {
+    moveGap(to);
+    gapStart = from;
+    pending.bytes += by.bytes;
+    pending.lines += by.lines;
+    pending.tokens += by.tokens;
+    size_t n = with.size();
+    if (gapEnd - gapStart < n) {
+      /* the gap grows with the buffer, so that growing
+       * costs no more than appending would
+       */
+      size_t tail = store.size() - gapEnd;
+      size_t grown = std::max(2 * store.size(), store.size() + n);
+      std::vector<T> bigger(grown);
+      std::move(store.begin(), store.begin() + gapStart, bigger.begin());
+      std::move(store.begin() + gapEnd, store.end(), bigger.end() - tail);
+      store.swap(bigger);
+      gapEnd = grown - tail;
+    }
+    std::move(with.begin(), with.end(), store.begin() + gapStart);
+    gapStart += n;
+  }
+
+  /* assign makes the elements of v, which is left
+   * empty, the whole sequence
+   */
+  void assign(std::vector<T> &v) {
+    store.clear();
+    store.swap(v);
+    gapStart = gapEnd = store.size();
+    pending = Moved{0, 0, 0};
+  }
+
+  /* copyTo appends moved copies of all elements to
+   * v, leaving the gap where it is
+   */
+  void copyTo(std::vector<T> &v) const {
+    v.reserve(v.size() + size());
+    v.insert(v.end(), store.begin(), store.begin() + gapStart);
+    for (size_t i = gapEnd; i < store.size(); i++) {
+      v.push_back(store[i]);
+      Mover::move(v.back(), 1, pending);
+    }
+  }
+
+private:
+  std::vector<T> store;
+  size_t gapStart = 0, gapEnd = 0;
+  Moved pending{0, 0, 0}; /* edits made since the gap passed */
+};
+
+/* An IncrementalParser keeps the text, tokens and
+ * syntax trees of one program between edits. With
+ * the tokens it stores the scanner state at the
+ * start of every line, so an edit is re-scanned from
+ * the line it touches only until the scanner is back
+ * in step with the old token stream. Likewise only
+ * the top-level statements whose tokens changed are
+ * parsed again; every other subtree is kept as it
+ * is, even when the edit moved it to other lines or
+ * tokens: tokens, lines and statements live in gap
+ * buffers, and the lines of a statement are counted
+ * from where it was parsed. An edit thus costs the
+ * damage it does and the distance from the edit
+ * before, except for the text itself, which is one
+ * string. analysis() puts the pieces together into
+ * the result analyzeCode gives for the new text
+ */
+class IncrementalParser {
+public:
+  IncrementalParser();
+
+  IncrementalParser(const IncrementalParser &) = delete;
+  IncrementalParser &operator=(const IncrementalParser &) = delete;
+
+  /* reset analyzes text from scratch */
+  void reset(const char *text, size_t size);
+
+  /* edit replaces the removed bytes at pos with
+   * the addedSize bytes at added
+   */
+  void edit(size_t pos, size_t removed, const char *added, size_t addedSize);
+
+  /* update makes text the new version, treating
+   * everything between the parts it shares with the
+   * old version at either end as edited
+   */
+  void update(const char *text, size_t size);
+
+  /* analysis returns the tree, tokens, names and
+   * diagnostics of the text, copied into a result of
+   * its own, as analyzeCode would without a symbol
+   * table or type check; its parse and scan times
+   * are those of the edits since the last call. The
+   * copy takes time in proportion to the text
+   */
+  std::unique_ptr<AnalyzeResult> analysis();
+
+  const std::string &text() const { return source; }
+
+  /* the scanner state at the start of line n + 1 */
+  size_t lineCount() const { return lines.size(); }
+  LineState line(size_t n) const { return lines.get(n); }
+
+  /* token i, or the first one at or after offset */
+  size_t tokenCount() const { return tokens.size(); }
+  Token token(size_t i) const { return tokens.get(i); }
+  size_t firstToken(size_t offset) const;
+
+  /* counts of the whole text */
+  long nodeCount() const { return nodes; }
+  long diagnosticCount() const { return diagnostics; }
+
+  /* work done by the last reset, edit or update */
+  long tokensScanned() const { return scanned; }
+  long statementsParsed() const { return parsed; }
+
+private:
+  struct TokenMover {
+    static void move(Token &t, long sign, const Moved &by) {
+      t.offset = (uint32_t)(t.offset + sign * by.bytes);
+      t.line = (uint32_t)(t.line + sign * by.lines);
+    }
+  };
+  struct LineMover {
+    static void move(LineState &l, long sign, const Moved &by) {
+      l.offset = (unsigned)(l.offset + sign * by.bytes);
+    }
+  };
+
+  /* Step is one element of the top-level statement
+   * sequence: a statement and, for all but the
+   * first, the ';' in front of it. Its tree and
+   * diagnostics keep the lines it was parsed on
+   */
+  struct Step {
+    unsigned token; /* index of its first token */
+    int lines;      /* lines it moved since it was parsed */
+    TreeNode *tree; /* the statement, or NULL */
+    long nodes;     /* nodes created for it */
+    int depth;      /* deepest recursion parsing it */
+    std::vector<Diagnostic> diagnostics;
+  };
+  struct StepMover {
+    static void move(Step &s, long sign, const Moved &by) {
+      s.token = (unsigned)(s.token + sign * by.tokens);
+      s.lines = (int)(s.lines + sign * by.lines);
+    }
+  };
+
+  /* Storage holds the nodes and names of the steps */
+  struct Storage {
+    Arena arena;
+    InternTable names{arena};
+  };
+
+  void analyzeAll();
+  void parseSteps(size_t first, size_t next, long tokenDelta);
+  void finish();
+  size_t stepAt(size_t token) const;
+  unsigned stepToken(size_t i) const;
+
+  std::string source;
+  std::unique_ptr<Storage> storage;
+  GapBuffer<Token, TokenMover> tokens;
+  GapBuffer<LineState, LineMover> lines; /* line n + 1 is n */
+  GapBuffer<Step, StepMover> steps;
+  std::vector<Diagnostic> trailing; /* code after the sequence */
+  unsigned end;     /* token that ended the sequence */
+  long nodes;       /* nodes of the steps */
+  long garbage;     /* nodes of replaced steps */
+  long diagnostics; /* of the steps and trailing */
+  int64_t scanNs;   /* since the last analysis() */
+  int64_t parseNs;
+  long scanned;
+  long parsed;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: intern.cpp                                 */
+/* Identifier interning implementation              */
+/****************************************************/
+
+#include "intern.h"
+#include <string.h>
+
+/* INITSLOTS = initial size of the slot array,
+ * which is kept at most half full
+ */
+#define INITSLOTS 256
+
+uint32_t hashName(std::string_view s) {
+  uint32_t h = 2166136261u;
+  for (unsigned char c : s)
+    h = (h ^ c) * 16777619u;
+  return h;
+}
+
+NameIndex::NameIndex() : table(INITSLOTS, 0) {}
+
+int NameIndex::add(size_t slot, uint32_t h) {
+  int id = (int)hashes.size();
+  hashes.push_back(h);
+  table[slot] = id + 1;
+  if (hashes.size() * 2 > table.size())
+    grow();
+  return id;
+}
+
+/* grow doubles the slot array, re-placing every id
+ * from its stored hash without touching names
+ */
+void NameIndex::grow() {
+  std::vector<int> bigger(table.size() * 2, 0);
+  table.swap(bigger);
+  size_t mask = table.size() - 1;
+  for (size_t id = 0; id < hashes.size(); id++) {
+    size_t i = hashes[id] & mask;
+    while (table[i] != 0)
+      i = (i + 1) & mask;
+    table[i] = (int)id + 1;
+  }
+}
+
+void NameIndex::clear() {
+  table.assign(INITSLOTS, 0);
+  hashes.clear();
+}
+
+InternTable::InternTable(Arena &a) : arena(a) {}
+
+/* find returns the id of s, or -1 with *slot set
+ * to the empty slot where s belongs
+ */
+int InternTable::find(std::string_view s, uint32_t h, size_t *slot) const {
+  return index.find(
+      h,
+      [&](int id) {
+        return lengths[id] == s.size() &&
+               memcmp(names[id], s.data(), s.size()) == 0;
+      },
+      slot);
+}
+
+int InternTable::lookup(std::string_view s) const {
+  size_t slot;
+  return find(s, hashName(s), &slot);
+}
+
+int InternTable::intern(std::string_view s) {
+  uint32_t h = hashName(s);
+  size_t slot;
+  int id = find(s, h, &slot);
+  if (id >= 0)
+    return id;
+  const char *copy = arena.copyString(s.data(), s.size());
+  if (copy == NULL)
+    return -1;
+  names.push_back(copy);
+  lengths.push_back((uint32_t)s.size());
+  return index.add(slot, h);
+}
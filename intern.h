@@ -0,0 +1,89 @@
+/****************************************************/
+/* File: intern.h                                   */
+/* Identifier interning: one canonical string and   */
+/* a dense integer id per distinct name             */
+/****************************************************/
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include "arena.h"
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+/* hashName is 32-bit FNV-1a */
+uint32_t hashName(std::string_view s);
+
+/* A NameIndex is the open addressing with linear
+ * probing under the InternTable and SymbolTable: it
+ * finds ids 0, 1, 2, ... by the hash of their name,
+ * while the names stay with its owner, which gives
+ * find a test of whether id is the name probed for
+ */
+class NameIndex {
+public:
+  NameIndex();
+
+  /* find returns the id of the name with hash h for
+   * which same(id) holds, or -1 with *slot set to
+   * the empty slot where that name belongs
+   */
+  template <class Same> int find(uint32_t h, Same same, size_t *slot) const {
+    size_t mask = table.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      int id = table[i] - 1;
+      if (id < 0) {
+        *slot = i;
+        return -1;
+      }
+      if (hashes[id] == h && same(id))
+        return id;
+    }
+  }
+
+  /* add puts the next id, with hash h, in slot as
+   * returned by find, and returns it
+   */
+  int add(size_t slot, uint32_t h);
+
+  void clear();
+
+private:
+  void grow();
+
+  std::vector<int> table; /* id + 1, or 0 when empty */
+  std::vector<uint32_t> hashes;
+};
+
+/* An InternTable maps every distinct identifier to
+ * an id 0, 1, 2, ... in order of first appearance.
+ * The canonical strings live in the arena given to
+ * the constructor, so they stay valid as long as
+ * the syntax tree that points to them. Lookups go
+ * through a NameIndex
+ */
+class InternTable {
+public:
+  explicit InternTable(Arena &arena);
+
+  /* intern returns the id of s, adding it if new */
+  int intern(std::string_view s);
+
+  /* lookup returns the id of s, or -1 */
+  int lookup(std::string_view s) const;
+
+  /* name returns the canonical string of id */
+  const char *name(int id) const { return names[id]; }
+
+  int size() const { return (int)names.size(); }
+
+private:
+  int find(std::string_view s, uint32_t h, size_t *slot) const;
+
+  Arena &arena;
+  NameIndex index;
+  std::vector<const char *> names;
+  std::vector<uint32_t> lengths;
+};
+
+#endif
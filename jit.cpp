@@ -0,0 +1,795 @@
+/****************************************************/
+/* File: jit.cpp                                    */
+/* Compiling the syntax tree of a TINY program to   */
+/* x86-64 machine code                              */
+/****************************************************/
+
+#include "jit.h"
+#include "bytecode.h"
+#include "runtime.h"
+#include "util.h"
+#include "vm.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define NATIVE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* OUTBUFFER = bytes of output kept before writing */
+#define OUTBUFFER 65536
+
+/* NativeFrame is what the code of a program works
+ * on, addressed by rbx: this header, and after it
+ * one 32-bit cell per variable
+ */
+struct NativeFrame {
+  int64_t savedRsp; /* after the prologue, to leave on an error */
+  int32_t line;     /* of the error */
+  int32_t value;    /* of the last read */
+  FILE *in;
+  FILE *out;
+  char *buffer; /* of OUTBUFFER bytes */
+  size_t used;
+};
+
+/* CELLS = offset of the first cell from rbx */
+#define CELLS ((int)((sizeof(NativeFrame) + 7) & ~(size_t)7))
+
+/* the status the code of a program returns */
+#define ENDED 0
+#define DIVIDEDBYZERO 1
+#define NOINPUT 2
+
+/* the runtime the code calls for read and write */
+
+static void flushOutput(NativeFrame *f) {
+  if (f->out != NULL && f->used > 0)
+    fwrite(f->buffer, 1, f->used, f->out);
+  f->used = 0;
+}
+
+#ifdef NATIVE
+static void nativeWrite(NativeFrame *f, int value) {
+  if (f->used > OUTBUFFER - 16)
+    flushOutput(f);
+  char digits[12];
+  int n = 0;
+  unsigned u = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  char *p = f->buffer + f->used;
+  if (value < 0)
+    *p++ = '-';
+  while (n > 0)
+    *p++ = digits[--n];
+  *p++ = '\n';
+  f->used = (size_t)(p - f->buffer);
+}
+
+/* nativeRead writes what came before, so that a
+ * prompt shows before the program waits for input
+ */
+static int nativeRead(NativeFrame *f) {
+  flushOutput(f);
+  if (f->out != NULL)
+    fflush(f->out);
+  return f->in != NULL && fscanf(f->in, "%d", &f->value) == 1;
+}
+#endif
+
+NativeCode::~NativeCode() {
+#ifdef NATIVE
+  if (code != NULL)
+    munmap(code, mapped);
+#endif
+}
+
+int NativeCode::run(FILE *in, FILE *out, Diagnostic *error) const {
+  if (code == NULL)
+    return FALSE;
+  std::vector<int64_t> storage((CELLS + 4 * (size_t)cells) / 8 + 1, 0);
+  std::vector<char> buffer(OUTBUFFER);
+  NativeFrame *f = (NativeFrame *)storage.data();
+  f->in = in;
+  f->out = out;
+  f->buffer = buffer.data();
+  int status = ((int (*)(NativeFrame *))code)(f);
+  flushOutput(f);
+  if (status == ENDED)
+    return TRUE;
+  if (error != NULL) {
+    if (status == DIVIDEDBYZERO)
+      *error = {f->line, 0, DivisionByZeroD, "division by 0"};
+    else
+      *error = {f->line, 0, NoInputD, "no input for read"};
+  }
+  return FALSE;
+}
+
+#ifdef NATIVE
+
+/* registers by their number in the encoding */
+enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* condition codes of jcc and setcc */
+enum { CE = 0x4, CNE = 0x5, CL = 0xC, CGE = 0xD, CLE = 0xE, CG = 0xF };
+
+/* the operations of the 0x81 /n group, and of
+ * opcode n * 8 + 1 and n * 8 + 3; the _ keeps them
+ * apart from the tokens
+ */
+enum { ADD_ = 0, OR_ = 1, AND_ = 4, SUB_ = 5, XOR_ = 6, CMP_ = 7 };
+
+/* Operand is an immediate, a register, or the
+ * 32-bit word at disp from a base register
+ */
+struct Operand {
+  enum { Imm, Reg, Mem } kind;
+  int value; /* immediate, register or disp */
+  int base;  /* of Mem */
+};
+
+static Operand imm(int v) { return {Operand::Imm, v, 0}; }
+static Operand reg(int r) { return {Operand::Reg, r, 0}; }
+static Operand mem(int base, int disp) { return {Operand::Mem, disp, base}; }
+
+/* Assembler encodes the few instructions the
+ * compiler uses; every jump takes a 32-bit offset
+ */
+struct Assembler {
+  std::vector<uint8_t> code;
+  std::vector<int> labels;             /* bound offset, or -1 */
+  std::vector<std::pair<int, int>> fixups; /* offset of rel32, label */
+
+  void byte(int b) { code.push_back((uint8_t)b); }
+  void dword(int32_t v) {
+    for (int i = 0; i < 4; i++)
+      byte((uint32_t)v >> (8 * i));
+  }
+
+  /* rm emits an instruction on register r and the
+   * register or word rm, wide for 64 bits
+   */
+  void rm(int wide, std::initializer_list<int> opcode, int r,
+          const Operand &rm) {
+    int b = rm.kind == Operand::Reg ? rm.value : rm.base;
+    int rex = (wide ? 8 : 0) | (r & 8 ? 4 : 0) | (b & 8 ? 1 : 0);
+    if (rex != 0)
+      byte(0x40 | rex);
+    for (int op : opcode)
+      byte(op);
+    if (rm.kind == Operand::Reg)
+      byte(0xC0 | (r & 7) << 3 | (b & 7));
+    else {
+      byte(0x80 | (r & 7) << 3 | (b & 7));
+      if ((b & 7) == RSP)
+        byte(0x24);
+      dword(rm.value);
+    }
+  }
+
+  /* mov r32, src */
+  void load(int r, const Operand &src) {
+    if (src.kind == Operand::Imm) {
+      if (r & 8)
+        byte(0x41);
+      byte(0xB8 + (r & 7));
+      dword(src.value);
+    } else
+      rm(0, {0x8B}, r, src);
+  }
+  /* mov dst, r32 */
+  void store(const Operand &dst, int r) {
+    if (dst.kind == Operand::Reg)
+      rm(0, {0x8B}, dst.value, reg(r));
+    else
+      rm(0, {0x89}, r, dst);
+  }
+  /* op r32, src */
+  void alu(int op, int r, const Operand &src) {
+    if (src.kind == Operand::Imm) {
+      rm(0, {0x81}, op, reg(r));
+      dword(src.value);
+    } else
+      rm(0, {op * 8 + 3}, r, src);
+  }
+  /* op dst, src for a word dst and src no word */
+  void aluTo(int op, const Operand &dst, const Operand &src) {
+    if (src.kind == Operand::Imm) {
+      rm(0, {0x81}, op, dst);
+      dword(src.value);
+    } else
+      rm(0, {op * 8 + 1}, src.value, dst);
+  }
+  void imul(int r, const Operand &src) {
+    if (src.kind == Operand::Imm) {
+      rm(0, {0x69}, r, reg(r));
+      dword(src.value);
+    } else
+      rm(0, {0x0F, 0xAF}, r, src);
+  }
+  void unary(int n, int r) { rm(0, {0xF7}, n, reg(r)); } /* 3 neg, 7 idiv */
+  void test(int r) { rm(0, {0x85}, r, reg(r)); }
+  void shr1(int r) { rm(0, {0xD1}, 5, reg(r)); }
+  void setcc(int cc) {
+    rm(0, {0x0F, 0x90 + cc}, 0, reg(RAX));
+    rm(0, {0x0F, 0xB6}, RAX, reg(RAX)); /* movzx eax, al */
+  }
+  void push(int r) {
+    if (r & 8)
+      byte(0x41);
+    byte(0x50 + (r & 7));
+  }
+  void pop(int r) {
+    if (r & 8)
+      byte(0x41);
+    byte(0x58 + (r & 7));
+  }
+  /* call the function at address */
+  void call(const void *address) {
+    byte(0x48);
+    byte(0xB8); /* mov rax, imm64 */
+    uint64_t a = (uint64_t)(uintptr_t)address;
+    for (int i = 0; i < 8; i++)
+      byte((uint8_t)(a >> (8 * i)));
+    rm(0, {0xFF}, 2, reg(RAX));
+  }
+
+  int label() {
+    labels.push_back(-1);
+    return (int)labels.size() - 1;
+  }
+  void bind(int l) { labels[l] = (int)code.size(); }
+  void jump(int l) {
+    byte(0xE9);
+    fixups.push_back({(int)code.size(), l});
+    dword(0);
+  }
+  void jcc(int cc, int l) {
+    byte(0x0F);
+    byte(0x80 + cc);
+    fixups.push_back({(int)code.size(), l});
+    dword(0);
+  }
+  void patch(int at, int32_t v) { memcpy(&code[at], &v, 4); }
+  void finish() {
+    for (const std::pair<int, int> &f : fixups)
+      patch(f.first, labels[f.second] - (f.first + 4));
+  }
+};
+
+/* LOOPREGISTERS hold the variables of for loops;
+ * they are callee-saved, so read and write keep
+ * them. TEMPS hold the left operands of binary
+ * operators while the right ones are computed
+ */
+static const int loopRegisters[] = {RBP, R12, R13, R14, R15};
+static const int temps[] = {RSI, RDI, R8, R9, R10, R11};
+#define NLOOPREGISTERS (int)(sizeof(loopRegisters) / sizeof(loopRegisters[0]))
+#define NTEMPS (int)(sizeof(temps) / sizeof(temps[0]))
+
+/* ForPlan is where one for loop keeps its variable:
+ * a register, or -1 for its cell. A loop inside
+ * another one on the same variable shares it
+ */
+struct ForPlan {
+  int start, end; /* statements, the end one past the loop */
+  int cell;
+  int reg = -1;
+  int shared = FALSE;
+};
+
+/* NativeCompiler emits the code of one tree; like
+ * BcCompiler it recurses as deep as the parser did
+ */
+struct NativeCompiler {
+  Assembler a;
+  const SymbolTable &symbols;
+  std::vector<ForPlan> plans; /* of the for loops in preorder */
+  size_t nextPlan = 0;
+  std::vector<int> location; /* register of each cell, or -1 */
+  int ntemps = 0;            /* in use */
+  int depth = 0, maxDepth = 0; /* loop bounds on the machine stack */
+  int exit = 0;
+  std::vector<std::pair<int, int>> divideStubs, readStubs; /* line, label */
+
+  NativeCompiler(const SymbolTable &symbols)
+      : symbols(symbols), location(symbols.size(), -1) {}
+
+  int cell(const TreeNode *t) {
+    return symbols.location(symbols.lookup(t->attr.name));
+  }
+
+  Operand variable(int c) {
+    return location[c] >= 0 ? reg(location[c]) : mem(RBX, CELLS + 4 * c);
+  }
+
+  /* leaf returns the operand of a constant or a
+   * variable, or FALSE for any other node
+   */
+  int leaf(const TreeNode *t, Operand *o) {
+    if (t->kind.exp == ConstK)
+      *o = imm(t->attr.val);
+    else if (t->kind.exp == IdK)
+      *o = variable(cell(t));
+    else
+      return FALSE;
+    return TRUE;
+  }
+
+  /* stub returns the label of the code that stops
+   * the program on line with status
+   */
+  int stub(std::vector<std::pair<int, int>> &stubs, int line) {
+    for (const std::pair<int, int> &s : stubs)
+      if (s.first == line)
+        return s.second;
+    stubs.push_back({line, a.label()});
+    return stubs.back().second;
+  }
+
+  /* plan runs linear scan over the for loops of
+   * tree: each loop is the interval of statements it
+   * spans, and when all registers are taken the
+   * interval ending last goes to memory, so the
+   * innermost loops keep theirs
+   */
+  void plan(TreeNode *tree) {
+    int position = 0;
+    std::vector<int> open;
+    collect(tree, position, open);
+    std::vector<int> active, free(loopRegisters,
+                                  loopRegisters + NLOOPREGISTERS);
+    for (ForPlan &p : plans) {
+      if (p.shared)
+        continue;
+      for (size_t i = 0; i < active.size();)
+        if (plans[active[i]].end <= p.start) {
+          free.push_back(plans[active[i]].reg);
+          active.erase(active.begin() + i);
+        } else
+          i++;
+      int self = (int)(&p - plans.data());
+      if (!free.empty()) {
+        p.reg = free.back();
+        free.pop_back();
+        active.push_back(self);
+        continue;
+      }
+      size_t last = 0;
+      for (size_t i = 1; i < active.size(); i++)
+        if (plans[active[i]].end > plans[active[last]].end)
+          last = i;
+      ForPlan &spilled = plans[active[last]];
+      if (spilled.end > p.end) {
+        p.reg = spilled.reg;
+        spilled.reg = -1;
+        active[last] = self;
+      }
+    }
+  }
+
+  void collect(TreeNode *t, int &position, std::vector<int> &open) {
+    for (; t != NULL; t = t->sibling) {
+      position++;
+      if (t->nodekind != StmtK)
+        continue;
+      if (t->kind.stmt == ForK) {
+        ForPlan p;
+        p.start = position;
+        p.cell = cell(t->child[0]);
+        for (int c : open)
+          if (c == p.cell)
+            p.shared = TRUE;
+        size_t at = plans.size();
+        plans.push_back(p);
+        open.push_back(p.cell);
+        collect(t->child[2], position, open);
+        open.pop_back();
+        plans[at].end = ++position;
+      } else
+        for (int i = 0; i < MAXCHILDREN; i++)
+          if (t->child[i] != NULL && t->child[i]->nodekind == StmtK)
+            collect(t->child[i], position, open);
+    }
+  }
+
+  /* operands computes the left operand of t into
+   * eax and returns the right one, which is in ecx
+   * if it is no leaf
+   */
+  Operand operands(TreeNode *t) {
+    expression(t->child[0]);
+    Operand y;
+    if (leaf(t->child[1], &y))
+      return y;
+    if (ntemps < NTEMPS) {
+      int temp = temps[ntemps++];
+      a.store(reg(temp), RAX);
+      expression(t->child[1]);
+      a.store(reg(RCX), RAX);
+      a.load(RAX, reg(temp));
+      ntemps--;
+    } else {
+      a.push(RAX);
+      expression(t->child[1]);
+      a.store(reg(RCX), RAX);
+      a.pop(RAX);
+    }
+    return reg(RCX);
+  }
+
+  static int condition(TokenType op) {
+    switch (op) {
+    case LT:
+      return CL;
+    case LTE:
+      return CLE;
+    case GT:
+      return CG;
+    case GTE:
+      return CGE;
+    case EQ:
+      return CE;
+    case NEQ:
+      return CNE;
+    default:
+      return -1;
+    }
+  }
+
+  /* divide computes eax / y or eax % y; y = -1 is
+   * apart since idiv faults on INT_MIN / -1
+   */
+  void divide(int remainder, const Operand &y, int line) {
+    if (y.kind == Operand::Imm && y.value == 0) {
+      a.jump(stub(divideStubs, line));
+      return;
+    }
+    if (y.kind == Operand::Imm && y.value == -1) {
+      if (remainder)
+        a.alu(XOR_, RAX, reg(RAX));
+      else
+        a.unary(3, RAX);
+      return;
+    }
+    int done = a.label();
+    a.load(RCX, y);
+    if (y.kind != Operand::Imm) {
+      int general = a.label();
+      a.test(RCX);
+      a.jcc(CE, stub(divideStubs, line));
+      a.alu(CMP_, RCX, imm(-1));
+      a.jcc(CNE, general);
+      if (remainder)
+        a.alu(XOR_, RAX, reg(RAX));
+      else
+        a.unary(3, RAX);
+      a.jump(done);
+      a.bind(general);
+    }
+    a.byte(0x99); /* cdq */
+    a.unary(7, RCX);
+    if (remainder)
+      a.store(reg(RAX), RDX);
+    a.bind(done);
+  }
+
+  /* power computes eax ^ y by squaring, as tinyPow */
+  void power(const Operand &y) {
+    int negative = a.label(), loop = a.label(), even = a.label(),
+        done = a.label(), end = a.label();
+    a.load(RCX, y);
+    a.test(RCX);
+    a.jcc(CL, negative);
+    a.load(RDX, imm(1));
+    a.bind(loop);
+    a.test(RCX);
+    a.jcc(CE, done);
+    a.rm(0, {0xF6}, 0, reg(RCX)); /* test cl, 1 */
+    a.byte(1);
+    a.jcc(CE, even);
+    a.imul(RDX, reg(RAX));
+    a.bind(even);
+    a.imul(RAX, reg(RAX));
+    a.shr1(RCX);
+    a.jump(loop);
+    a.bind(done);
+    a.store(reg(RAX), RDX);
+    a.jump(end);
+    a.bind(negative);
+    a.alu(XOR_, RAX, reg(RAX));
+    a.bind(end);
+  }
+
+  /* expression computes t into eax */
+  void expression(TreeNode *t) {
+    Operand y;
+    if (leaf(t, &y)) {
+      a.load(RAX, y);
+      return;
+    }
+    if (t->attr.op == NOT) {
+      expression(t->child[0]);
+      a.alu(XOR_, RAX, imm(1));
+      return;
+    }
+    y = operands(t);
+    int cc = condition(t->attr.op);
+    if (cc >= 0) {
+      a.alu(CMP_, RAX, y);
+      a.setcc(cc);
+      return;
+    }
+    switch (t->attr.op) {
+    case PLUS:
+      a.alu(ADD_, RAX, y);
+      break;
+    case MINUS:
+      a.alu(SUB_, RAX, y);
+      break;
+    case TIMES:
+      a.imul(RAX, y);
+      break;
+    case OVER:
+    case REMAIN:
+      divide(t->attr.op == REMAIN, y, t->lineno);
+      break;
+    case POWER:
+      power(y);
+      break;
+    case AND:
+      a.alu(AND_, RAX, y);
+      break;
+    case OR:
+      a.alu(OR_, RAX, y);
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* jumpUnless goes to l unless test holds */
+  void jumpUnless(TreeNode *test, int l) {
+    int cc = test->kind.exp == OpK ? condition(test->attr.op) : -1;
+    if (cc >= 0) {
+      a.alu(CMP_, RAX, operands(test));
+      a.jcc(cc ^ 1, l);
+    } else {
+      expression(test);
+      a.test(RAX);
+      a.jcc(CE, l);
+    }
+  }
+
+  void statements(TreeNode *t) {
+    for (; t != NULL; t = t->sibling)
+      statement(t);
+  }
+
+  void statement(TreeNode *t) {
+    Operand y;
+    switch (t->kind.stmt) {
+    case IfK: {
+      int otherwise = a.label(), end = a.label();
+      jumpUnless(t->child[0], otherwise);
+      statements(t->child[1]);
+      if (t->child[2] != NULL)
+        a.jump(end);
+      a.bind(otherwise);
+      statements(t->child[2]);
+      a.bind(end);
+      break;
+    }
+    case RepeatK: {
+      int top = a.label();
+      a.bind(top);
+      statements(t->child[0]);
+      jumpUnless(t->child[1], top);
+      break;
+    }
+    case RegK:
+      /* a regular definition makes no code */
+      break;
+    case AssignK: {
+      Operand v = variable(cell(t));
+      if (t->child[0]->kind.exp == ConstK && v.kind == Operand::Mem) {
+        a.rm(0, {0xC7}, 0, v); /* mov dword [v], imm32 */
+        a.dword(t->child[0]->attr.val);
+        break;
+      }
+      expression(t->child[0]);
+      a.store(v, RAX);
+      break;
+    }
+    case PlusEqK: {
+      Operand v = variable(cell(t));
+      if (!leaf(t->child[0], &y)) {
+        expression(t->child[0]);
+        y = reg(RAX);
+      } else if (y.kind == Operand::Mem && v.kind == Operand::Mem) {
+        a.load(RAX, y);
+        y = reg(RAX);
+      }
+      if (v.kind == Operand::Reg)
+        a.alu(ADD_, v.value, y);
+      else
+        a.aluTo(ADD_, v, y);
+      break;
+    }
+    case ReadK:
+      a.rm(1, {0x8B}, RDI, reg(RBX)); /* mov rdi, rbx */
+      a.call((const void *)nativeRead);
+      a.test(RAX);
+      a.jcc(CE, stub(readStubs, t->lineno));
+      a.load(RAX, mem(RBX, (int)offsetof(NativeFrame, value)));
+      a.store(variable(cell(t)), RAX);
+      break;
+    case WriteK:
+      expression(t->child[0]);
+      a.store(reg(RSI), RAX);
+      a.rm(1, {0x8B}, RDI, reg(RBX));
+      a.call((const void *)nativeWrite);
+      break;
+    case ForK:
+      forLoop(t);
+      break;
+    default:
+      break;
+    }
+  }
+
+  /* v := start; if v > bound go to end;
+   * body: ...; v += 1; if v <= bound go to body
+   */
+  void forLoop(TreeNode *t) {
+    const ForPlan &p = plans[nextPlan++];
+    int down = strcmp(t->attr.name, "downto") == 0;
+    int saved = location[p.cell];
+    /* the start value sees the variable as it was */
+    expression(t->child[0]->child[0]);
+    if (!p.shared)
+      location[p.cell] = p.reg;
+    a.store(variable(p.cell), RAX);
+    Operand bound;
+    if (t->child[1]->kind.exp == ConstK)
+      bound = imm(t->child[1]->attr.val);
+    else {
+      expression(t->child[1]);
+      bound = mem(RSP, 8 * depth++);
+      if (depth > maxDepth)
+        maxDepth = depth;
+      a.store(bound, RAX);
+    }
+    int body = a.label(), end = a.label();
+    compare(variable(p.cell), bound);
+    a.jcc(down ? CL : CG, end);
+    a.bind(body);
+    statements(t->child[2]);
+    /* the value before the step is compared, as
+     * the step past INT_MAX or INT_MIN wraps
+     */
+    Operand v = variable(p.cell);
+    a.load(RAX, v);
+    if (v.kind == Operand::Reg)
+      a.alu(down ? SUB_ : ADD_, v.value, imm(1));
+    else
+      a.aluTo(down ? SUB_ : ADD_, v, imm(1));
+    a.alu(CMP_, RAX, bound);
+    a.jcc(down ? CG : CL, body);
+    a.bind(end);
+    if (!p.shared && p.reg >= 0)
+      a.store(mem(RBX, CELLS + 4 * p.cell), p.reg);
+    location[p.cell] = saved;
+    if (bound.kind == Operand::Mem)
+      depth--;
+  }
+
+  void compare(const Operand &v, const Operand &bound) {
+    if (v.kind == Operand::Reg)
+      a.alu(CMP_, v.value, bound);
+    else {
+      a.load(RAX, v);
+      a.alu(CMP_, RAX, bound);
+    }
+  }
+
+  /* program emits the whole function: it saves the
+   * callee-saved registers, keeps rsp 16-byte
+   * aligned for the calls and returns a status
+   */
+  void program(TreeNode *tree) {
+    static const int saved[] = {RBX, RBP, R12, R13, R14, R15};
+    for (int r : saved)
+      a.push(r);
+    a.rm(1, {0x8B}, RBX, reg(RDI)); /* mov rbx, rdi */
+    a.rm(1, {0x81}, 5, reg(RSP));  /* sub rsp, frame */
+    int frameAt = (int)a.code.size();
+    a.dword(0);
+    a.rm(1, {0x89}, RSP, mem(RBX, (int)offsetof(NativeFrame, savedRsp)));
+    exit = a.label();
+    plan(tree);
+    statements(tree);
+    a.alu(XOR_, RAX, reg(RAX));
+    a.bind(exit);
+    a.rm(1, {0x8B}, RSP, mem(RBX, (int)offsetof(NativeFrame, savedRsp)));
+    a.rm(1, {0x81}, 0, reg(RSP)); /* add rsp, frame */
+    int frameAgain = (int)a.code.size();
+    a.dword(0);
+    for (int i = (int)(sizeof(saved) / sizeof(saved[0])) - 1; i >= 0; i--)
+      a.pop(saved[i]);
+    a.byte(0xC3);
+    for (const std::pair<int, int> &s : divideStubs)
+      errorStub(s, DIVIDEDBYZERO);
+    for (const std::pair<int, int> &s : readStubs)
+      errorStub(s, NOINPUT);
+    /* six pushes leave rsp 8 off alignment */
+    int frame = 8 * maxDepth;
+    if (frame % 16 == 0)
+      frame += 8;
+    a.patch(frameAt, frame);
+    a.patch(frameAgain, frame);
+    a.finish();
+  }
+
+  void errorStub(const std::pair<int, int> &s, int status) {
+    a.bind(s.second);
+    a.rm(0, {0xC7}, 0, mem(RBX, (int)offsetof(NativeFrame, line)));
+    a.dword(s.first);
+    a.load(RAX, imm(status));
+    a.jump(exit);
+  }
+};
+
+#endif
+
+std::unique_ptr<NativeCode> compileNative(const AnalyzeResult &result) {
+#ifdef NATIVE
+  if (!result.diagnostics.empty() || !result.typeErrors.empty())
+    return NULL;
+  NativeCompiler compiler(result.symbols);
+  compiler.program(result.tree);
+  const std::vector<uint8_t> &bytes = compiler.a.code;
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t mapped = (bytes.size() + page - 1) / page * page;
+  void *code = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED)
+    return NULL;
+  memcpy(code, bytes.data(), bytes.size());
+  if (mprotect(code, mapped, PROT_READ | PROT_EXEC) != 0) {
+    munmap(code, mapped);
+    return NULL;
+  }
+  std::unique_ptr<NativeCode> native(new NativeCode);
+  native->code = code;
+  native->length = bytes.size();
+  native->mapped = mapped;
+  native->cells = result.symbols.size();
+  return native;
+#else
+  (void)result;
+  return NULL;
+#endif
+}
+
+int runProgram(const AnalyzeResult &result, FILE *in, FILE *out,
+               Diagnostic *error) {
+  std::unique_ptr<NativeCode> native = compileNative(result);
+  if (native != NULL)
+    return native->run(in, out, error);
+  Bytecode bc;
+  if (!compileBytecode(result, bc))
+    return FALSE;
+  return runBytecode(bc, in, out, error);
+}
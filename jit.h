@@ -0,0 +1,61 @@
+/****************************************************/
+/* File: jit.h                                      */
+/* Compiling the syntax tree of a TINY program to   */
+/* x86-64 machine code                              */
+/****************************************************/
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include "analyze.h"
+#include "diagnostic.h"
+#include <memory>
+#include <stdio.h>
+
+/* NativeCode is the machine code of one program in
+ * memory of its own, which is executable and no
+ * longer writable
+ */
+class NativeCode {
+public:
+  ~NativeCode();
+
+  /* run runs the program like runBytecode (vm.h),
+   * with the same input, output and errors
+   */
+  int run(FILE *in, FILE *out, Diagnostic *error = NULL) const;
+
+  size_t size() const { return length; }
+
+private:
+  friend std::unique_ptr<NativeCode> compileNative(const AnalyzeResult &);
+  NativeCode() {}
+  NativeCode(const NativeCode &) = delete;
+  NativeCode &operator=(const NativeCode &) = delete;
+
+  void *code = NULL;
+  size_t length = 0; /* of the code */
+  size_t mapped = 0; /* bytes of memory holding it */
+  int cells = 0;     /* variables */
+};
+
+/* compileNative compiles the tree of result straight
+ * to machine code. The variables of the for loops
+ * are kept in registers while their loops run, five
+ * at a time, given out by linear scan over the
+ * loops; read and write call a buffered runtime. It
+ * returns NULL where it cannot compile: on other
+ * processors and systems than x86-64 Linux, when no
+ * executable memory is to be had, and for trees that
+ * compileBytecode refuses
+ */
+std::unique_ptr<NativeCode> compileNative(const AnalyzeResult &result);
+
+/* runProgram runs the program of result as native
+ * code where compileNative compiles it, and on the
+ * bytecode machine otherwise; it returns FALSE for
+ * a tree that neither compiles, with no error set
+ */
+int runProgram(const AnalyzeResult &result, FILE *in, FILE *out,
+               Diagnostic *error = NULL);
+
+#endif
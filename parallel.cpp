@@ -0,0 +1,252 @@
+/****************************************************/
+/* File: parallel.cpp                               */
+/* Parsing the top-level statements of one large    */
+/* program on several threads                       */
+/****************************************************/
+
+#include "parallel.h"
+#include "parse.h"
+#include "scan.h"
+#include "util.h"
+#include <algorithm>
+#include <deque>
+
+/* a piece has at least MINCHUNK tokens, and a pool
+ * gets CHUNKSPERTHREAD pieces per thread so that
+ * uneven ones still keep every thread busy
+ */
+#define MINCHUNK 65536
+#define CHUNKSPERTHREAD 4
+
+/* Chunk is a piece of the top-level sequence: the
+ * statements from the one beginning at token start
+ * up to the first that begins at or after limit,
+ * parsed into an arena and InternTable of its own
+ */
+struct Chunk {
+  size_t start;
+  size_t limit;
+  std::unique_ptr<Arena> arena;
+  std::unique_ptr<InternTable> names;
+  std::vector<Diagnostic> diagnostics;
+  TreeNode *first = NULL; /* its statements, linked */
+  TreeNode *last = NULL;
+  size_t end = 0;    /* token where the next statement begins */
+  int ended = FALSE; /* TRUE if the sequence ends in it */
+  long nodes = 0;
+  int maxDepth = 0;
+};
+
+/* splitPoints returns the tokens where pieces after
+ * the first begin: the first ';' after every
+ * chunkTokens tokens that is outside of brackets,
+ * parentheses, repeat .. until and for .. enddo.
+ * Comments are gone from the token buffer already
+ */
+static std::vector<size_t> splitPoints(const std::vector<Token> &tokens,
+                                       size_t chunkTokens) {
+  std::vector<size_t> at;
+  long depth = 0;
+  size_t next = chunkTokens;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    switch (tokens[i].type) {
+    case LBACKET:
+    case LPAREN:
+    case REPEAT:
+    case FOR:
+      depth++;
+      break;
+    case RBACKET:
+    case RPAREN:
+    case UNTIL:
+    case ENDDO:
+      if (depth > 0)
+        depth--;
+      break;
+    case SEMI:
+      if (depth == 0 && i >= next) {
+        at.push_back(i);
+        next = i + chunkTokens;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return at;
+}
+
+/* parseChunk parses the statements of c from the
+ * token buffer of text, one step at a time like the
+ * incremental parser
+ */
+static void parseChunk(const char *text, size_t size,
+                       const std::vector<Token> &tokens, Chunk &c) {
+  c.arena.reset(new Arena);
+  c.names.reset(new InternTable(*c.arena));
+  CompilerContext ctx;
+  ctx.text = text;
+  ctx.textsize = size;
+  ctx.tokenArray = tokens.data();
+  ctx.tokenCount = tokens.size();
+  ctx.tokenNext = c.start;
+  ctx.arena = c.arena.get();
+  ctx.names = c.names.get();
+  ctx.diagnostics = &c.diagnostics;
+  ctx.token = getToken(ctx);
+  int first = c.start == 0;
+  for (;;) {
+    TreeNode *t = parseStatement(ctx, first);
+    first = FALSE;
+    if (t != NULL) {
+      if (c.first == NULL)
+        c.first = t;
+      else
+        c.last->sibling = t;
+      c.last = t;
+    }
+    if (sequenceEnds(ctx.token)) {
+      c.ended = TRUE;
+      break;
+    }
+    if (ctx.tokenNext - 1 >= c.limit)
+      break;
+  }
+  c.end = ctx.tokenNext - 1;
+  c.nodes = ctx.nodes;
+  c.maxDepth = ctx.maxDepth;
+}
+
+/* renumber points the named nodes of c at the names
+ * of the whole program, given the id of every name
+ * of c there
+ */
+static void renumber(Chunk &c, const std::vector<int> &ids,
+                     const InternTable &names) {
+  TreeWalk walk(c.first);
+  TreeNode *t;
+  while ((t = walk.next()) != NULL)
+    if (t->symbol >= 0) {
+      t->symbol = ids[t->symbol];
+      t->attr.name = (char *)names.name(t->symbol);
+    }
+}
+
+/* parseChunks parses the pieces of the program
+ * that begin at splits on the threads of pool and
+ * joins them into the tree of result
+ */
+static void parseChunks(CompilerContext &ctx, AnalyzeResult &result,
+                        const std::vector<size_t> &splits, WorkPool &pool) {
+  const char *text = ctx.text;
+  size_t size = ctx.textsize;
+  const std::vector<Token> &tokens = result.tokens;
+  size_t nchunks = splits.size() + 1;
+  std::deque<Chunk> chunks(nchunks);
+  for (size_t i = 0; i < nchunks; i++) {
+    chunks[i].start = i == 0 ? 0 : splits[i - 1];
+    chunks[i].limit = i < splits.size() ? splits[i] : tokens.size();
+  }
+  for (size_t i = 0; i < nchunks; i++)
+    pool.submit([&, i] { parseChunk(text, size, tokens, chunks[i]); });
+  pool.wait();
+
+  /* a chunk is right if it begins where the one
+   * before it ended; from where none does, the text
+   * is parsed again up to the next chunk that is
+   */
+  std::vector<Chunk *> used{&chunks[0]};
+  size_t next = 1;
+  while (!used.back()->ended) {
+    size_t at = used.back()->end;
+    while (next < nchunks && chunks[next].start < at)
+      next++;
+    if (next < nchunks && chunks[next].start == at)
+      used.push_back(&chunks[next++]);
+    else {
+      chunks.emplace_back();
+      Chunk &c = chunks.back();
+      c.start = at;
+      c.limit = next < nchunks ? chunks[next].start : tokens.size();
+      parseChunk(text, size, tokens, c);
+      used.push_back(&c);
+    }
+  }
+
+  /* names get their ids in order of appearance, so
+   * the names of every chunk are added in turn
+   */
+  std::vector<std::vector<int>> ids(used.size());
+  for (size_t i = 0; i < used.size(); i++) {
+    const InternTable &names = *used[i]->names;
+    ids[i].resize(names.size());
+    for (int id = 0; id < names.size(); id++)
+      ids[i][id] = result.names.intern(names.name(id));
+  }
+  for (size_t i = 0; i < used.size(); i++)
+    pool.submit([&, i] { renumber(*used[i], ids[i], result.names); });
+  pool.wait();
+
+  TreeNode *last = NULL;
+  for (Chunk *c : used) {
+    if (c->first != NULL) {
+      if (last == NULL)
+        result.tree = c->first;
+      else
+        last->sibling = c->first;
+      last = c->last;
+    }
+    result.diagnostics.insert(result.diagnostics.end(), c->diagnostics.begin(),
+                              c->diagnostics.end());
+    result.nodes += c->nodes;
+    result.stats.maxDepth = std::max(result.stats.maxDepth, c->maxDepth);
+    result.arenas.push_back(std::move(c->arena));
+  }
+  ctx.tokenNext = used.back()->end;
+  ctx.token = getToken(ctx);
+  parseFinish(ctx);
+}
+
+std::unique_ptr<AnalyzeResult> analyzeParallel(const char *text, size_t size,
+                                               WorkPool &pool,
+                                               size_t chunkTokens) {
+  std::unique_ptr<AnalyzeResult> result(new AnalyzeResult);
+  CompilerContext ctx;
+  ctx.arena = &result->arena;
+  ctx.names = &result->names;
+  ctx.diagnostics = &result->diagnostics;
+  setScanBuffer(ctx, text, size);
+  {
+    PhaseTimer timer(result->stats.scanNs);
+    tokenize(ctx, result->tokens);
+  }
+  ctx.tokenArray = result->tokens.data();
+  ctx.tokenCount = result->tokens.size();
+  const std::vector<Token> &tokens = result->tokens;
+
+  if (chunkTokens == 0)
+    chunkTokens = std::max(tokens.size() / (pool.size() * CHUNKSPERTHREAD),
+                           (size_t)MINCHUNK);
+  std::vector<size_t> splits;
+  if (pool.size() > 1)
+    splits = splitPoints(tokens, chunkTokens);
+  {
+    PhaseTimer timer(result->stats.parseNs);
+    if (splits.empty()) {
+      result->tree = parse(ctx);
+      result->nodes = ctx.nodes;
+      result->stats.maxDepth = ctx.maxDepth;
+    } else
+      parseChunks(ctx, *result, splits, pool);
+  }
+  {
+    PhaseTimer timer(result->stats.analyzeNs);
+    buildSymtab(result->symbols, result->tree);
+  }
+  {
+    PhaseTimer timer(result->stats.typeNs);
+    typeCheck(result->tree, result->typeErrors);
+  }
+  countStats(*result);
+  return result;
+}
@@ -0,0 +1,30 @@
+/****************************************************/
+/* File: parallel.h                                 */
+/* Parsing the top-level statements of one large    */
+/* program on several threads                       */
+/****************************************************/
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include "analyze.h"
+#include "workpool.h"
+
+/* analyzeParallel analyzes size bytes of TINY
+ * source like analyzeCode, but cuts its top-level
+ * statement sequence at ';' tokens outside any
+ * block and parses the pieces on the threads of
+ * pool. Every piece is checked to begin where the
+ * sequential parse has a statement boundary; where
+ * one does not, the text from there is parsed again
+ * in order. The tree, names, symbols, node count
+ * and diagnostics are those of analyzeCode. Texts of
+ * fewer than two pieces, and pools of one thread,
+ * are parsed sequentially. chunkTokens sets the
+ * size of a piece, 0 chooses one from the size of
+ * the pool. It must not be called by a task of pool
+ */
+std::unique_ptr<AnalyzeResult> analyzeParallel(const char *text, size_t size,
+                                               WorkPool &pool,
+                                               size_t chunkTokens = 0);
+
+#endif
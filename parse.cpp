@@ -1,449 +1,498 @@
-/****************************************************/
-/* File: parse.c                                    */
-/* The parser implementation for the TINY compiler  */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-
-#include "parse.h"
-#include "scan.h"
-#include "util.h"
-
-static TokenType token; /* holds current token */
-
-/* function prototypes for recursive calls */
-static TreeNode *stmt_sequence(void);
-static TreeNode *statement(void);
-static TreeNode *if_stmt(void);
-static TreeNode *repeat_stmt(void);
-static TreeNode *assign_stmt(void);
-static TreeNode *for_assign(void);
-static TreeNode *for_stmt(void);
-static TreeNode *read_stmt(void);
-static TreeNode *write_stmt(void);
-static TreeNode *reg_union(void);
-static TreeNode *reg_concat(void);
-static TreeNode *reg_closure(void);
-static TreeNode *reg_factor(void);
-static TreeNode *exp(void);
-static TreeNode *or_exp(void);
-static TreeNode *and_exp(void);
-static TreeNode *simple_exp(void);
-static TreeNode *term(void);
-static TreeNode *not_term(void);
-static TreeNode *power(void);
-static TreeNode *factor(void);
-
-static void syntaxError(char *message) {
-  fprintf(listing, "\n>>> ");
-  fprintf(listing, "Syntax error at line %d: %s", lineno, message);
-  Error = TRUE;
-}
-
-static void match(TokenType expected) {
-  if (token == expected)
-    token = getToken();
-  else {
-    syntaxError("unexpected token -> ");
-    printToken(token, tokenString);
-    fprintf(listing, "      ");
-  }
-}
-
-TreeNode *stmt_sequence(void) {
-  TreeNode *t = statement();
-  TreeNode *p = t;
-  while ((token != ENDFILE) && (token != ELSE) && (token != UNTIL) &&
-         (token != ENDDO) && (token != RBACKET) ) {
-    TreeNode *q;
-    match(SEMI);
-    q = statement();
-    if (q != NULL) {
-      if (t == NULL)
-        t = p = q;
-      else /* now p cannot be NULL either */
-      {
-        p->sibling = q;
-        p = q;
-      }
-    }
-  }
-  return t;
-}
-
-// P394
-// lineno: 961
-TreeNode *statement(void) {
-  TreeNode *t = NULL;
-  switch (token) {
-  case IF:
-    t = if_stmt();
-    break;
-  case REPEAT:
-    t = repeat_stmt();
-    break;
-  case ID:
-    t = assign_stmt();
-    break;
-  case READ:
-    t = read_stmt();
-    break;
-  case WRITE:
-    t = write_stmt();
-    break;
-  case FOR:
-    t = for_stmt();
-    break;
-  default:
-    syntaxError("unexpected token -> ");
-    printToken(token, tokenString);
-    token = getToken();
-    break;
-  } /* end case */
-  return t;
-}
-
-// P394
-// lineno: 977
-TreeNode *if_stmt(void) {
-  TreeNode *t = newStmtNode(IfK);
-  match(IF);
-  match(LPAREN);
-  if (t != NULL)
-    t->child[0] = exp();
-  match(RPAREN);
-  if (t != NULL) {
-    if (token == LBACKET) {
-      match(LBACKET);
-      t->child[1] = stmt_sequence();
-      match(RBACKET);
-    } else
-      t->child[1] = statement();
-  }
-  if (token == ELSE) {
-    match(ELSE);
-    if (t != NULL) {
-      if (token == LBACKET) {
-        match(LBACKET);
-        t->child[2] = stmt_sequence();
-        match(RBACKET);
-      } else
-        t->child[2] = statement();
-    }
-  }
-  return t;
-}
-
-// P394
-// lineno:991
-TreeNode *repeat_stmt(void) {
-  TreeNode *t = newStmtNode(RepeatK);
-  match(REPEAT);
-  if (t != NULL)
-    t->child[0] = stmt_sequence();
-  match(UNTIL);
-  if (t != NULL)
-    t->child[1] = exp();
-  return t;
-}
-
-TreeNode *assign_stmt(void) {
-  TreeNode *t = newStmtNode(AssignK);
-  if ((t != NULL) && (token == ID))
-    t->attr.name = copyString(tokenString);
-  match(ID);
-  if (t != NULL) {
-    if (token == PLUS_EQ) {
-      t->kind.stmt = PlusEqK;
-      match(token);
-      t->child[0] = exp();
-    } else if (token == REG) {
-      match(token);
-      t->child[0] = reg_union();
-    } else {
-      match(ASSIGN);
-      t->child[0] = exp();
-    }
-  }
-  return t;
-}
-
-TreeNode *read_stmt(void) {
-  TreeNode *t = newStmtNode(ReadK);
-  match(READ);
-  if ((t != NULL) && (token == ID))
-    t->attr.name = copyString(tokenString);
-  match(ID);
-  return t;
-}
-
-TreeNode *write_stmt(void) {
-  TreeNode *t = newStmtNode(WriteK);
-  match(WRITE);
-  if (t != NULL)
-    t->child[0] = exp();
-  return t;
-}
-
-TreeNode *for_stmt(void) {
-  TreeNode *t = newStmtNode(ForK);
-  match(FOR);
-  if (t != NULL)
-    t->child[0] = for_assign();
-  if (t != NULL) {
-    if (token == TO) {
-      t->attr.name = copyString(tokenString);
-      match(TO);
-    } else if (token == DOWNTO) {
-      t->attr.name = copyString(tokenString);
-      match(DOWNTO);
-    }
-  }
-  if (t != NULL)
-    t->child[1] = simple_exp();
-  match(DO);
-  if (t != NULL)
-    t->child[2] = stmt_sequence();
-  match(ENDDO);
-  return t;
-}
-
-TreeNode *for_assign(void) {
-  TreeNode *t = newStmtNode(AssignK);
-  if (t != NULL && (token == ID))
-    t->attr.name = copyString(tokenString);
-  match(ID);
-  match(ASSIGN);
-  if (t != NULL)
-    t->child[0] = simple_exp();
-  return t;
-}
-
-TreeNode *exp(void) {
-  TreeNode *t = or_exp();
-  while (token == OR) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-    }
-    match(token);
-    if (t != NULL) {
-      t->child[1] = or_exp();
-    }
-  }
-  return t;
-}
-
-TreeNode *or_exp(void) {
-  TreeNode *t = and_exp();
-  while (token == AND) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-    }
-    match(token);
-    if (t != NULL) {
-      t->child[1] = and_exp();
-    }
-  }
-  return t;
-}
-
-TreeNode *and_exp(void) {
-  TreeNode *t = simple_exp();
-  if ((token == LT) || (token == EQ) || (token == LTE) || (token == GTE) || (token == GT) || (token == NEQ)) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-    }
-    match(token);
-    if (t != NULL)
-      t->child[1] = simple_exp();
-  }
-  return t;
-}
-
-TreeNode *simple_exp(void) {
-  TreeNode *t = term();
-  while ((token == PLUS) || (token == MINUS)) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      t->child[1] = term();
-    }
-  }
-  return t;
-}
-
-TreeNode *term(void) {
-  TreeNode *t = not_term();
-  while ((token == TIMES) || (token == OVER) || (token == REMAIN)) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      p->child[1] = not_term();
-    }
-  }
-  return t;
-}
-
-TreeNode *not_term(void) {
-  TreeNode *t = NULL;
-  if (token == NOT) {
-    while (token == NOT) {
-      t = newExpNode(OpK);
-      if (t != NULL) {
-        t->attr.op = token;
-        match(token);
-        t->child[0] = not_term();
-      }
-    }
-  } else {
-    t = power();
-  }
-  return t;
-}
-
-TreeNode *power(void) {
-  TreeNode *t = factor();
-  while (token == POWER) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      p->child[1] = factor();
-    }
-  }
-  return t;
-}
-
-TreeNode *factor(void) {
-  TreeNode *t = NULL;
-  switch (token) {
-  case NUM:
-    t = newExpNode(ConstK);
-    if ((t != NULL) && (token == NUM))
-      t->attr.val = atoi(tokenString);
-    match(NUM);
-    break;
-  case ID:
-    t = newExpNode(IdK);
-    if ((t != NULL) && (token == ID))
-      t->attr.name = copyString(tokenString);
-    match(ID);
-    break;
-  case LPAREN:
-    match(LPAREN);
-    t = exp();
-    match(RPAREN);
-    break;
-  default:
-    syntaxError("unexpected token -> ");
-    printToken(token, tokenString);
-    token = getToken();
-    break;
-  }
-  return t;
-}
-
-TreeNode *reg_union(void) {
-  TreeNode *t = reg_concat();
-  while (t != NULL && token == UNION) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->attr.op = token;
-      p->child[0] = t;
-      t = p;
-      match(token);
-      t->child[1] = reg_concat();
-    }
-  }
-  return t;
-}
-
-TreeNode *reg_concat(void) {
-  TreeNode *t = reg_closure();
-  while (t != NULL && token == CONCAT) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-      t->child[1] = reg_closure();
-    }
-  }
-  return t;
-}
-
-TreeNode *reg_closure(void) {
-  TreeNode *t = reg_factor();
-  while (t != NULL && (token == CLOSURE || token == OPTION)) {
-    TreeNode *p = newExpNode(OpK);
-    if (p != NULL) {
-      p->child[0] = t;
-      p->attr.op = token;
-      t = p;
-      match(token);
-    }
-  }
-  return t;
-}
-
-TreeNode *reg_factor(void) {
-  TreeNode *t = NULL;
-  switch (token) {
-  case NUM:
-    t = newExpNode(ConstK);
-    if ((t != NULL) && (token == NUM))
-      t->attr.val = atoi(tokenString);
-    match(NUM);
-    break;
-  case ID:
-    t = newExpNode(IdK);
-    if ((t != NULL) && (token == ID))
-      t->attr.name = copyString(tokenString);
-    match(ID);
-    break;
-  case LPAREN:
-    match(LPAREN);
-    t = reg_union();
-    match(RPAREN);
-    break;
-  default:
-    syntaxError("unexpected token -> ");
-    printToken(token, tokenString);
-    token = getToken();
-    break;
-  }
-  return t;
-}
-
-/****************************************/
-/* the primary function of the parser   */
-/****************************************/
-/* Function parse returns the newly
- * constructed syntax tree
- */
-TreeNode *parse(void) {
-  TreeNode *t;
-  token = getToken();
-  t = stmt_sequence();
-  if (token != ENDFILE)
-    syntaxError("Code ends before file\n");
-  return t;
-}
+/****************************************************/
+/* File: parse.c                                    */
+/* The parser implementation for the TINY compiler  */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "parse.h"
+#include "scan.h"
+#include "util.h"
+
+/* function prototypes for recursive calls */
+static TreeNode *stmt_sequence(CompilerContext &ctx);
+static TreeNode *statement(CompilerContext &ctx);
+static TreeNode *if_stmt(CompilerContext &ctx);
+static TreeNode *repeat_stmt(CompilerContext &ctx);
+static TreeNode *assign_stmt(CompilerContext &ctx);
+static TreeNode *for_assign(CompilerContext &ctx);
+static TreeNode *for_stmt(CompilerContext &ctx);
+static TreeNode *read_stmt(CompilerContext &ctx);
+static TreeNode *write_stmt(CompilerContext &ctx);
+static TreeNode *reg_union(CompilerContext &ctx);
+static TreeNode *reg_concat(CompilerContext &ctx);
+static TreeNode *reg_closure(CompilerContext &ctx);
+static TreeNode *reg_factor(CompilerContext &ctx);
+static TreeNode *exp(CompilerContext &ctx);
+static TreeNode *simple_exp(CompilerContext &ctx);
+static TreeNode *factor(CompilerContext &ctx);
+
+/* Nesting counts the recursion of the parser into
+ * ctx.maxDepth while it lives; statement, expression
+ * and reg_union are the functions that recurse
+ */
+struct Nesting {
+#ifndef NO_STATS
+  explicit Nesting(CompilerContext &ctx) : ctx(ctx) {
+    if (++ctx.depth > ctx.maxDepth)
+      ctx.maxDepth = ctx.depth;
+  }
+  ~Nesting() { ctx.depth--; }
+  CompilerContext &ctx;
+#else
+  explicit Nesting(CompilerContext &) {}
+#endif
+};
+
+/* tokenValue converts the lexeme of a NUM token; a
+ * literal too large for an int wraps around as the
+ * arithmetic of runtime.h does
+ */
+static int tokenValue(CompilerContext &ctx) {
+  unsigned val = 0;
+  for (char c : ctx.tokenString)
+    val = val * 10 + (unsigned)(c - '0');
+  return (int)val;
+}
+
+/* setName makes the lexeme of the current token
+ * the name of t, interned when the context keeps
+ * an InternTable so that every occurrence of an
+ * identifier shares one string and id
+ */
+static void setName(CompilerContext &ctx, TreeNode *t) {
+  if (ctx.names != NULL) {
+    t->symbol = ctx.names->intern(ctx.tokenString);
+    if (t->symbol >= 0) {
+      t->attr.name = (char *)ctx.names->name(t->symbol);
+      return;
+    }
+  }
+  t->attr.name = copyString(ctx, ctx.tokenString);
+}
+
+/* syntaxError reports an error at the current token
+ * as a diagnostic and in the listing file, if any
+ */
+static void syntaxError(CompilerContext &ctx, DiagCode code,
+                        const char *message) {
+  if (ctx.listing != NULL) {
+    fprintf(ctx.listing, "\n>>> ");
+    fprintf(ctx.listing, "Syntax error at line %d: %s\n", ctx.lineno,
+            message);
+  }
+  addDiagnostic(ctx, code, ctx.lineno, tokenColumn(ctx), message);
+  ctx.Error = TRUE;
+}
+
+/* unexpectedToken reports the current token as
+ * one the parser cannot use
+ */
+static void unexpectedToken(CompilerContext &ctx) {
+  if (ctx.listing != NULL) {
+    fprintf(ctx.listing, "\n>>> ");
+    fprintf(ctx.listing, "Syntax error at line %d: unexpected token -> ",
+            ctx.lineno);
+  }
+  printToken(ctx.listing, ctx.token, ctx.tokenString);
+  std::string message("unexpected token -> ");
+  size_t at = message.size();
+  message.resize(at + tokenText(NULL, 0, ctx.token, ctx.tokenString));
+  tokenText(&message[at], message.size() - at + 1, ctx.token, ctx.tokenString);
+  addDiagnostic(ctx, UnexpectedTokenD, ctx.lineno, tokenColumn(ctx), message);
+  ctx.Error = TRUE;
+}
+
+static void match(CompilerContext &ctx, TokenType expected) {
+  if (ctx.token == expected)
+    ctx.token = getToken(ctx);
+  else {
+    unexpectedToken(ctx);
+    if (ctx.listing != NULL)
+      fprintf(ctx.listing, "      ");
+  }
+}
+
+int sequenceEnds(TokenType token) {
+  return (token == ENDFILE) || (token == ELSE) || (token == UNTIL) ||
+         (token == ENDDO) || (token == RBACKET);
+}
+
+TreeNode *stmt_sequence(CompilerContext &ctx) {
+  TreeNode *t = statement(ctx);
+  TreeNode *p = t;
+  while (!sequenceEnds(ctx.token)) {
+    TreeNode *q;
+    match(ctx, SEMI);
+    q = statement(ctx);
+    if (q != NULL) {
+      if (t == NULL)
+        t = p = q;
+      else /* now p cannot be NULL either */
+      {
+        p->sibling = q;
+        p = q;
+      }
+    }
+  }
+  return t;
+}
+
+// P394
+// lineno: 961
+TreeNode *statement(CompilerContext &ctx) {
+  Nesting nesting(ctx);
+  TreeNode *t = NULL;
+  switch (ctx.token) {
+  case IF:
+    t = if_stmt(ctx);
+    break;
+  case REPEAT:
+    t = repeat_stmt(ctx);
+    break;
+  case ID:
+    t = assign_stmt(ctx);
+    break;
+  case READ:
+    t = read_stmt(ctx);
+    break;
+  case WRITE:
+    t = write_stmt(ctx);
+    break;
+  case FOR:
+    t = for_stmt(ctx);
+    break;
+  default:
+    unexpectedToken(ctx);
+    ctx.token = getToken(ctx);
+    break;
+  } /* end case */
+  return t;
+}
+
+// P394
+// lineno: 977
+TreeNode *if_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, IfK);
+  match(ctx, IF);
+  match(ctx, LPAREN);
+  if (t != NULL)
+    t->child[0] = exp(ctx);
+  match(ctx, RPAREN);
+  if (t != NULL) {
+    if (ctx.token == LBACKET) {
+      match(ctx, LBACKET);
+      t->child[1] = stmt_sequence(ctx);
+      match(ctx, RBACKET);
+    } else
+      t->child[1] = statement(ctx);
+  }
+  if (ctx.token == ELSE) {
+    match(ctx, ELSE);
+    if (t != NULL) {
+      if (ctx.token == LBACKET) {
+        match(ctx, LBACKET);
+        t->child[2] = stmt_sequence(ctx);
+        match(ctx, RBACKET);
+      } else
+        t->child[2] = statement(ctx);
+    }
+  }
+  return t;
+}
+
+// P394
+// lineno:991
+TreeNode *repeat_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, RepeatK);
+  match(ctx, REPEAT);
+  if (t != NULL)
+    t->child[0] = stmt_sequence(ctx);
+  match(ctx, UNTIL);
+  if (t != NULL)
+    t->child[1] = exp(ctx);
+  return t;
+}
+
+TreeNode *assign_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, AssignK);
+  if ((t != NULL) && (ctx.token == ID))
+    setName(ctx, t);
+  match(ctx, ID);
+  if (t != NULL) {
+    if (ctx.token == PLUS_EQ) {
+      t->kind.stmt = PlusEqK;
+      match(ctx, ctx.token);
+      t->child[0] = exp(ctx);
+    } else if (ctx.token == REG) {
+      t->kind.stmt = RegK;
+      match(ctx, ctx.token);
+      t->child[0] = reg_union(ctx);
+    } else {
+      match(ctx, ASSIGN);
+      t->child[0] = exp(ctx);
+    }
+  }
+  return t;
+}
+
+TreeNode *read_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, ReadK);
+  match(ctx, READ);
+  if ((t != NULL) && (ctx.token == ID))
+    setName(ctx, t);
+  match(ctx, ID);
+  return t;
+}
+
+TreeNode *write_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, WriteK);
+  match(ctx, WRITE);
+  if (t != NULL)
+    t->child[0] = exp(ctx);
+  return t;
+}
+
+TreeNode *for_stmt(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, ForK);
+  match(ctx, FOR);
+  if (t != NULL)
+    t->child[0] = for_assign(ctx);
+  if (t != NULL) {
+    if (ctx.token == TO) {
+      setName(ctx, t);
+      match(ctx, TO);
+    } else if (ctx.token == DOWNTO) {
+      setName(ctx, t);
+      match(ctx, DOWNTO);
+    }
+  }
+  if (t != NULL)
+    t->child[1] = simple_exp(ctx);
+  match(ctx, DO);
+  if (t != NULL)
+    t->child[2] = stmt_sequence(ctx);
+  match(ctx, ENDDO);
+  return t;
+}
+
+TreeNode *for_assign(CompilerContext &ctx) {
+  TreeNode *t = newStmtNode(ctx, AssignK);
+  if (t != NULL && (ctx.token == ID))
+    setName(ctx, t);
+  match(ctx, ID);
+  match(ctx, ASSIGN);
+  if (t != NULL)
+    t->child[0] = simple_exp(ctx);
+  return t;
+}
+
+/* binding powers of the expression operators, from
+ * the loosest to the tightest; 0 marks tokens that
+ * are no binary operator. Every operator takes the
+ * tighter ones as its right operand and so groups
+ * to the left, and the operand of '^' is a factor
+ */
+#define ORPOWER 1
+#define ANDPOWER 2
+#define COMPAREPOWER 3 /* at most one per operand */
+#define ADDPOWER 4
+#define MULPOWER 5
+#define NOTPOWER 6 /* prefix 'not' */
+#define RAISEPOWER 7
+#define FACTORPOWER 8
+
+struct PowerTable {
+  unsigned char power[MAXTOKEN];
+};
+
+static constexpr PowerTable buildPowerTable(void) {
+  PowerTable t{};
+  t.power[OR] = ORPOWER;
+  t.power[AND] = ANDPOWER;
+  t.power[LT] = t.power[EQ] = t.power[LTE] = COMPAREPOWER;
+  t.power[GTE] = t.power[GT] = t.power[NEQ] = COMPAREPOWER;
+  t.power[PLUS] = t.power[MINUS] = ADDPOWER;
+  t.power[TIMES] = t.power[OVER] = t.power[REMAIN] = MULPOWER;
+  t.power[POWER] = RAISEPOWER;
+  return t;
+}
+
+static constexpr PowerTable bindingPowers = buildPowerTable();
+
+/* expression parses the operators that bind at
+ * least as tightly as minPower by precedence
+ * climbing, in place of one function per level
+ */
+static TreeNode *expression(CompilerContext &ctx, int minPower) {
+  Nesting nesting(ctx);
+  TreeNode *t;
+  int last = FACTORPOWER; /* power of the operator at the root of t */
+  if (ctx.token == NOT && minPower <= NOTPOWER) {
+    /* a 'not' right after the operand of another
+     * replaces it, as it did in the former not_term
+     */
+    while (ctx.token == NOT) {
+      t = newExpNode(ctx, OpK);
+      if (t != NULL) {
+        t->attr.op = ctx.token;
+        match(ctx, ctx.token);
+        t->child[0] = expression(ctx, NOTPOWER);
+      }
+    }
+    last = NOTPOWER;
+  } else
+    t = factor(ctx);
+  for (;;) {
+    int power = bindingPowers.power[ctx.token];
+    if (power == 0 || power < minPower ||
+        (power == COMPAREPOWER && last <= COMPAREPOWER))
+      break;
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+    }
+    match(ctx, ctx.token);
+    TreeNode *right = expression(ctx, power + 1);
+    if (p != NULL)
+      p->child[1] = right;
+    last = power;
+  }
+  return t;
+}
+
+TreeNode *exp(CompilerContext &ctx) { return expression(ctx, ORPOWER); }
+
+TreeNode *simple_exp(CompilerContext &ctx) {
+  return expression(ctx, ADDPOWER);
+}
+
+TreeNode *factor(CompilerContext &ctx) {
+  TreeNode *t = NULL;
+  switch (ctx.token) {
+  case NUM:
+    t = newExpNode(ctx, ConstK);
+    if ((t != NULL) && (ctx.token == NUM))
+      t->attr.val = tokenValue(ctx);
+    match(ctx, NUM);
+    break;
+  case ID:
+    t = newExpNode(ctx, IdK);
+    if ((t != NULL) && (ctx.token == ID))
+      setName(ctx, t);
+    match(ctx, ID);
+    break;
+  case LPAREN:
+    match(ctx, LPAREN);
+    t = exp(ctx);
+    match(ctx, RPAREN);
+    break;
+  default:
+    unexpectedToken(ctx);
+    ctx.token = getToken(ctx);
+    break;
+  }
+  return t;
+}
+
+TreeNode *reg_union(CompilerContext &ctx) {
+  Nesting nesting(ctx);
+  TreeNode *t = reg_concat(ctx);
+  while (t != NULL && ctx.token == UNION) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->attr.op = ctx.token;
+      p->child[0] = t;
+      t = p;
+      match(ctx, ctx.token);
+      t->child[1] = reg_concat(ctx);
+    }
+  }
+  return t;
+}
+
+TreeNode *reg_concat(CompilerContext &ctx) {
+  TreeNode *t = reg_closure(ctx);
+  while (t != NULL && ctx.token == CONCAT) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+      match(ctx, ctx.token);
+      t->child[1] = reg_closure(ctx);
+    }
+  }
+  return t;
+}
+
+TreeNode *reg_closure(CompilerContext &ctx) {
+  TreeNode *t = reg_factor(ctx);
+  while (t != NULL && (ctx.token == CLOSURE || ctx.token == OPTION)) {
+    TreeNode *p = newExpNode(ctx, OpK);
+    if (p != NULL) {
+      p->child[0] = t;
+      p->attr.op = ctx.token;
+      t = p;
+      match(ctx, ctx.token);
+    }
+  }
+  return t;
+}
+
+TreeNode *reg_factor(CompilerContext &ctx) {
+  TreeNode *t = NULL;
+  switch (ctx.token) {
+  case NUM:
+    t = newExpNode(ctx, ConstK);
+    if ((t != NULL) && (ctx.token == NUM))
+      t->attr.val = tokenValue(ctx);
+    match(ctx, NUM);
+    break;
+  case ID:
+    t = newExpNode(ctx, IdK);
+    if ((t != NULL) && (ctx.token == ID))
+      setName(ctx, t);
+    match(ctx, ID);
+    break;
+  case LPAREN:
+    match(ctx, LPAREN);
+    t = reg_union(ctx);
+    match(ctx, RPAREN);
+    break;
+  default:
+    unexpectedToken(ctx);
+    ctx.token = getToken(ctx);
+    break;
+  }
+  return t;
+}
+
+/****************************************/
+/* the primary function of the parser   */
+/****************************************/
+/* Function parse returns the newly
+ * constructed syntax tree
+ */
+TreeNode *parse(CompilerContext &ctx) {
+  TreeNode *t;
+  ctx.token = getToken(ctx);
+  t = stmt_sequence(ctx);
+  parseFinish(ctx);
+  return t;
+}
+
+TreeNode *parseStatement(CompilerContext &ctx, int first) {
+  if (!first)
+    match(ctx, SEMI);
+  return statement(ctx);
+}
+
+TreeNode *parseExpression(CompilerContext &ctx) { return exp(ctx); }
+
+void parseFinish(CompilerContext &ctx) {
+  if (ctx.token != ENDFILE)
+    syntaxError(ctx, TrailingCodeD, "Code ends before file");
+}
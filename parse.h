@@ -1,16 +1,48 @@
-/****************************************************/
-/* File: parse.h                                    */
-/* The parser interface for the TINY compiler       */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-#ifndef _PARSE_H_
-#define _PARSE_H_
-
-#include "globals.h"
-/* Function parse returns the newly 
- * constructed syntax tree
- */
-TreeNode * parse(void);
-
-#endif
+/****************************************************/
+/* File: parse.h                                    */
+/* The parser interface for the TINY compiler       */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+#ifndef _PARSE_H_
+#define _PARSE_H_
+
+#include "globals.h"
+#include "context.h"
+
+/* Function parse returns the newly 
+ * constructed syntax tree; all scanner and
+ * parser state lives in ctx
+ */
+TreeNode * parse(CompilerContext &);
+
+/* The top-level statement sequence can also be
+ * parsed one step at a time, which lets an edit be
+ * re-parsed statement by statement. With ctx.token
+ * holding the first token, repeat parseStatement
+ * until sequenceEnds(ctx.token), then call
+ * parseFinish; the trees are then those of parse
+ */
+
+/* Function parseStatement parses one statement
+ * of the sequence, together with the ';' before it
+ * unless it is the first one
+ */
+TreeNode * parseStatement(CompilerContext &, int first);
+
+/* Function sequenceEnds returns TRUE if token
+ * ends a statement sequence
+ */
+int sequenceEnds(TokenType token);
+
+/* Function parseExpression parses one expression
+ * starting at ctx.token, as on the right of ':='
+ */
+TreeNode * parseExpression(CompilerContext &);
+
+/* Procedure parseFinish reports code that
+ * follows the end of the top-level sequence
+ */
+void parseFinish(CompilerContext &);
+
+#endif
@@ -0,0 +1,185 @@
+/****************************************************/
+/* File: pipeline.cpp                               */
+/* Scanning and parsing a stream on two threads     */
+/****************************************************/
+
+#include "pipeline.h"
+#include "parse.h"
+#include "scan.h"
+#include <atomic>
+#include <thread>
+
+/* the scanner hands over BATCHTOKENS tokens at a
+ * time and may run RINGSLOTS batches ahead of the
+ * parser
+ */
+#define BATCHTOKENS 4096
+#define RINGSLOTS 8
+
+/* TokenBatch is one slot of the ring: some tokens,
+ * and the text they were scanned from as it was
+ * when the last of them was
+ */
+struct TokenBatch {
+  Token tokens[BATCHTOKENS];
+  size_t count;
+  const char *text;
+  size_t textsize;
+  size_t generation; /* of text in the source buffer */
+};
+
+/* TokenRing passes batches from one scanning thread
+ * to one parsing thread without locks. Slots are
+ * filled and read in place; head counts the batches
+ * published and tail those consumed, each written by
+ * one side only, and the release store of either
+ * makes the slot visible to the other side. A side
+ * that finds the ring full or empty yields and tries
+ * again
+ */
+class TokenRing {
+public:
+  /* the slot to fill next, once one is free */
+  TokenBatch &back() {
+    size_t h = head.load(std::memory_order_relaxed);
+    while (h - tail.load(std::memory_order_acquire) == RINGSLOTS)
+      std::this_thread::yield();
+    return slots[h % RINGSLOTS];
+  }
+  void push() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+  /* the oldest published slot, once there is one */
+  TokenBatch &front() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    while (head.load(std::memory_order_acquire) == t)
+      std::this_thread::yield();
+    return slots[t % RINGSLOTS];
+  }
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+
+private:
+  TokenBatch slots[RINGSLOTS];
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+/* scanStream scans the stream of ctx into ring, up
+ * to and including ENDFILE; scanNs receives the time
+ * it took, reading and waiting for the parser
+ * included
+ */
+static void scanStream(CompilerContext &ctx, TokenRing &ring, int64_t &scanNs) {
+  PhaseTimer timer(scanNs);
+  int ended = FALSE;
+  while (!ended) {
+    TokenBatch &b = ring.back();
+    b.count = 0;
+    while (b.count < BATCHTOKENS && !ended) {
+      Token t = scanToken(ctx);
+      b.tokens[b.count++] = t;
+      ended = t.type == ENDFILE;
+    }
+    b.text = ctx.text;
+    b.textsize = ctx.textsize;
+    b.generation = ctx.sourceBuffer.generation();
+    ring.push();
+  }
+}
+
+/* RingFeed gives the parser the batches of ring,
+ * gathered into the token buffer of the result.
+ * Later batches never come from older text, so
+ * once the parser has the text of a batch, the
+ * source buffer may free what came before it
+ */
+class RingFeed : public TokenFeed {
+public:
+  RingFeed(TokenRing &ring, std::vector<Token> &tokens, SourceBuffer &source)
+      : ring(ring), tokens(tokens), source(source) {}
+
+  void refill(CompilerContext &ctx) override {
+    if (ended)
+      return;
+    TokenBatch &b = ring.front();
+    tokens.insert(tokens.end(), b.tokens, b.tokens + b.count);
+    ctx.text = b.text;
+    ctx.textsize = b.textsize;
+    source.release(b.generation);
+    ring.pop();
+    ended = tokens.back().type == ENDFILE;
+    ctx.tokenArray = tokens.data();
+    ctx.tokenCount = tokens.size();
+  }
+
+  /* drain takes the batches left after the parser
+   * stopped, which lets the scanner finish
+   */
+  void drain(CompilerContext &ctx) {
+    while (!ended)
+      refill(ctx);
+  }
+
+private:
+  TokenRing &ring;
+  std::vector<Token> &tokens;
+  SourceBuffer &source;
+  int ended = FALSE;
+};
+
+std::unique_ptr<AnalyzeResult> analyzeStream(FILE *stream, int pipelined,
+                                             FILE *listing) {
+  if (!pipelined) {
+    SourceBuffer buffer;
+    int64_t readNs = 0;
+    {
+      PhaseTimer timer(readNs);
+      buffer.read(stream);
+    }
+    std::unique_ptr<AnalyzeResult> result =
+        analyzeCode(buffer.data(), buffer.size(), listing);
+    result->stats.readNs = readNs;
+    return result;
+  }
+  std::unique_ptr<AnalyzeResult> result(new AnalyzeResult);
+  std::unique_ptr<TokenRing> ring(new TokenRing);
+  /* the text lives in the source buffer of the
+   * scanning context until both threads are done
+   */
+  CompilerContext scanner;
+  scanner.source = stream;
+  scanner.streamed = TRUE;
+  std::thread thread(scanStream, std::ref(scanner), std::ref(*ring),
+                     std::ref(result->stats.scanNs));
+
+  CompilerContext ctx;
+  ctx.listing = listing;
+  ctx.arena = &result->arena;
+  ctx.names = &result->names;
+  ctx.diagnostics = &result->diagnostics;
+  RingFeed feed(*ring, result->tokens, scanner.sourceBuffer);
+  ctx.tokenFeed = &feed;
+  {
+    PhaseTimer timer(result->stats.parseNs);
+    result->tree = parse(ctx);
+  }
+  result->nodes = ctx.nodes;
+  result->stats.maxDepth = ctx.maxDepth;
+  feed.drain(ctx);
+  thread.join();
+  {
+    PhaseTimer timer(result->stats.analyzeNs);
+    buildSymtab(result->symbols, result->tree);
+  }
+  {
+    PhaseTimer timer(result->stats.typeNs);
+    typeCheck(result->tree, result->typeErrors, listing);
+  }
+  countStats(*result);
+  return result;
+}
@@ -0,0 +1,28 @@
+/****************************************************/
+/* File: pipeline.h                                 */
+/* Scanning and parsing a stream on two threads     */
+/****************************************************/
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include "analyze.h"
+#include <stdio.h>
+
+/* analyzeStream analyzes the TINY source left in
+ * stream, such as a pipe or stdin, like analyzeCode.
+ * With pipelined, a second thread reads the stream
+ * a block at a time and scans it while this one
+ * parses: tokens pass between them in batches
+ * through a ring of fixed size, so reading, scanning
+ * and parsing overlap and the scanner never gets
+ * more than the ring ahead. Without it the stream
+ * is read whole and then analyzed. Both give the
+ * result of analyzeCode on the same text. When
+ * pipelined, the scanning time of the stats includes
+ * reading and the parsing time waiting for tokens
+ */
+std::unique_ptr<AnalyzeResult> analyzeStream(FILE *stream,
+                                             int pipelined = TRUE,
+                                             FILE *listing = NULL);
+
+#endif
@@ -0,0 +1,50 @@
+/****************************************************/
+/* File: runtime.h                                  */
+/* Arithmetic of TINY programs, the same in every   */
+/* way of running them                              */
+/****************************************************/
+#ifndef _RUNTIME_H_
+#define _RUNTIME_H_
+
+/* TINY integers are 32 bits and wrap around on
+ * overflow, as the machine word does; the helpers
+ * compute in unsigned arithmetic, where C++ leaves
+ * nothing undefined
+ */
+static inline int tinyAdd(int x, int y) {
+  return (int)((unsigned)x + (unsigned)y);
+}
+
+static inline int tinySub(int x, int y) {
+  return (int)((unsigned)x - (unsigned)y);
+}
+
+static inline int tinyMul(int x, int y) {
+  return (int)((unsigned)x * (unsigned)y);
+}
+
+/* tinyDiv and tinyMod truncate toward zero like C;
+ * y must not be 0, which the caller reports
+ */
+static inline int tinyDiv(int x, int y) {
+  return y == -1 ? (int)(0u - (unsigned)x) : x / y;
+}
+
+static inline int tinyMod(int x, int y) { return y == -1 ? 0 : x % y; }
+
+/* tinyPow raises x to the power y by squaring; a
+ * negative power gives 0
+ */
+static inline int tinyPow(int x, int y) {
+  if (y < 0)
+    return 0;
+  unsigned result = 1, base = (unsigned)x;
+  for (; y > 0; y >>= 1) {
+    if (y & 1)
+      result *= base;
+    base *= base;
+  }
+  return (int)result;
+}
+
+#endif
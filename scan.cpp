@@ -1,293 +1,673 @@
-/****************************************************/
-/* File: scan.c                                     */
-/* The scanner implementation for the TINY compiler */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-
-#include "scan.h"
-#include "util.h"
-
-/* states in scanner DFA */
-typedef enum {
-  START,
-  INASSIGN,
-  INCOMMENT,
-  INNUM,
-  INID,
-  DONE,
-  INCOMPUTE,
-  INCOMPARE
-} StateType;
-
-/* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN + 1];
-
-/* BUFLEN = length of the input buffer for
-   source code lines */
-#define BUFLEN 256
-
-static char lineBuf[BUFLEN]; /* holds the current line */
-int linepos = 0;
-int lineno = 0;       /* current position in LineBuf */
-int bufsize = 0;      /* current size of buffer string */
-int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
-
-void reset() {
-  linepos = 0;
-  lineno = 0;
-  bufsize = 0;
-  EOF_flag = FALSE;
-}
-
-/* getNextChar fetches the next non-blank character
-   from lineBuf, reading in a new line if lineBuf is
-   exhausted */
-static int getNextChar(void) {
-  if (!(linepos < bufsize)) {
-    lineno++;
-    if (fgets(lineBuf, BUFLEN - 1, source)) {
-      if (EchoSource)
-        fprintf(listing, "%4d: %s", lineno, lineBuf);
-      bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
-    } else {
-      EOF_flag = TRUE;
-      return EOF;
-    }
-  } else
-    return lineBuf[linepos++];
-}
-
-/* ungetNextChar backtracks one character
-   in lineBuf */
-static void ungetNextChar(void) {
-  if (!EOF_flag)
-    linepos--;
-}
-
-/* lookup table of reserved words */
-static struct {
-  char *str;
-  TokenType tok;
-} reservedWords[MAXRESERVED] = {
-    {"if", IF},
-    {"else", ELSE},
-    {"repeat", REPEAT},
-    {"until", UNTIL},
-    {"read", READ},
-    {"write", WRITE},
-    {"for", FOR},
-    {"to", TO},
-    {"downto", DOWNTO},
-    {"do", DO},
-    {"enddo", ENDDO},
-    {"and", AND},
-    {"or", OR},
-    {"not", NOT},
-};
-
-/* lookup an identifier to see if it is a reserved word */
-/* uses linear search */
-static TokenType reservedLookup(char *s) {
-  int i;
-  for (i = 0; i < MAXRESERVED; i++)
-    if (!strcmp(s, reservedWords[i].str))
-      return reservedWords[i].tok;
-  return ID;
-}
-
-/****************************************/
-/* the primary function of the scanner  */
-/****************************************/
-/* function getToken returns the
- * next token in source file
- */
-TokenType getToken(void) { /* index for storing into tokenString */
-  int tokenStringIndex = 0;
-  /* holds current token to be returned */
-  TokenType currentToken;
-  /* current state - always begins at START */
-  StateType state = START;
-  /* flag to indicate save to tokenString */
-  int save;
-  while (state != DONE) {
-    int c = getNextChar();
-    save = TRUE;
-    switch (state) {
-    case START:
-      if (isdigit(c))
-        state = INNUM;
-      else if (isalpha(c))
-        state = INID;
-      else if (c == ':')
-        state = INASSIGN;
-      else if ((c == ' ') || (c == '\t') || (c == '\n'))
-        save = FALSE;
-      else if (c == '{') {
-        save = FALSE;
-        state = INCOMMENT;
-      } else if (c == '+') {
-        state = INCOMPUTE; // + / +=
-      } else if (c == '<' || c == '>') {
-        state = INCOMPARE;
-      } else {
-        state = DONE;
-        switch (c) {
-        case EOF:
-          save = FALSE;
-          currentToken = ENDFILE;
-          break;
-        case '=':
-          currentToken = EQ;
-          break;
-        case '-':
-          currentToken = MINUS;
-          break;
-        case '*':
-          currentToken = TIMES;
-          break;
-        case '/':
-          currentToken = OVER;
-          break;
-        case '%':
-          currentToken = REMAIN;
-          break;
-        case '^':
-          currentToken = POWER;
-          break;
-        case '(':
-          currentToken = LPAREN;
-          break;
-        case ')':
-          currentToken = RPAREN;
-          break;
-        case '[':
-          currentToken = LBACKET;
-          break;
-        case ']':
-          currentToken = RBACKET;
-          break;
-        case ';':
-          currentToken = SEMI;
-          break;
-        case '|':
-          currentToken = UNION;
-          break;
-        case '&':
-          currentToken = CONCAT;
-          break;
-        case '#':
-          currentToken = CLOSURE;
-          break;
-        case '?':
-          currentToken = OPTION;
-          break;
-        default:
-          currentToken = ERROR;
-          break;
-        }
-      }
-      break;
-    case INCOMMENT:
-      save = FALSE;
-      if (c == EOF) {
-        state = DONE;
-        currentToken = ENDFILE;
-      } else if (c == '}')
-        state = START;
-      break;
-    case INASSIGN:
-      state = DONE;
-      if (c == '=')
-        currentToken = ASSIGN;
-      else if (c == ':') {
-        // ::= RegExp
-        if (getNextChar() == '=')
-          currentToken = REG;
-        else {
-          ungetNextChar();
-          save = FALSE;
-          currentToken = REG;
-        }
-        break;
-      }
-      else { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        currentToken = ERROR;
-      }
-      break;
-    case INCOMPUTE:
-      state = DONE;
-      if (c == '=')
-        currentToken = PLUS_EQ;
-      else {
-        ungetNextChar();
-        currentToken = PLUS;
-      }
-      break;
-    case INCOMPARE:
-    {
-      state = DONE;
-      ungetNextChar();
-      ungetNextChar();
-      char tmp = getNextChar();
-      getNextChar();
-      if (tmp == '<') {
-        if (c == '=')
-          currentToken = LTE;
-        else if (c == '>')
-          currentToken = NEQ;
-        else {
-          ungetNextChar();
-          currentToken = LT;
-        }
-      } else if (tmp == '>') {
-        if (c == '=')
-          currentToken = GTE;
-        else {
-          ungetNextChar();
-          currentToken = GT;
-        }
-      }
-      break;
-    }
-    case INNUM:
-      if (!isdigit(c)) { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        state = DONE;
-        currentToken = NUM;
-      }
-      break;
-    case INID:
-      if (!isalpha(c)) { /* backup in the input */
-        ungetNextChar();
-        save = FALSE;
-        state = DONE;
-        currentToken = ID;
-      }
-      break;
-    case DONE:
-    default: /* should never happen */
-      fprintf(listing, "Scanner Bug: state= %d\n", state);
-      state = DONE;
-      currentToken = ERROR;
-      break;
-    }
-    if ((save) && (tokenStringIndex <= MAXTOKENLEN))
-      tokenString[tokenStringIndex++] = (char)c;
-    if (state == DONE) {
-      tokenString[tokenStringIndex] = '\0';
-      if (currentToken == ID)
-        currentToken = reservedLookup(tokenString);
-    }
-  }
-  if (TraceScan) {
-    fprintf(listing, "\t%d: ", lineno);
-    printToken(currentToken, tokenString);
-  }
-  return currentToken;
-} /* end getToken */
+/****************************************************/
+/* File: scan.c                                     */
+/* The scanner implementation for the TINY compiler */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include "scan.h"
+#include "util.h"
+#include <stdint.h>
+
+/* states in scanner DFA */
+typedef enum {
+  START,
+  INASSIGN,
+  INCOMMENT,
+  INNUM,
+  INID,
+  DONE,
+  INCOMPUTE,
+  INCOMPARE
+} StateType;
+
+void setScanBuffer(CompilerContext &ctx, const char *t, size_t size) {
+  ctx.text = t;
+  ctx.textsize = size;
+  ctx.textpos = 0;
+  ctx.lineBuf = t;
+}
+
+void setScanPosition(CompilerContext &ctx, size_t offset, int lineno,
+                     int inComment) {
+  ctx.textpos = offset;
+  ctx.lineBuf = ctx.text + offset;
+  ctx.linepos = ctx.bufsize = 0;
+  ctx.lineno = lineno - 1;
+  ctx.EOF_flag = FALSE;
+  ctx.inComment = inComment;
+}
+
+/* readLine reads blocks of the source stream until
+ * the text from textpos holds a whole line or the
+ * stream has ended, keeping lineBuf on its line as
+ * the buffer grows
+ */
+static void readLine(CompilerContext &ctx) {
+  size_t searched = ctx.textpos;
+  while (ctx.text == NULL ||
+         memchr(ctx.text + searched, '\n', ctx.textsize - searched) == NULL) {
+    size_t line = ctx.text != NULL ? (size_t)(ctx.lineBuf - ctx.text) : 0;
+    searched = ctx.textsize;
+    int more = ctx.sourceBuffer.readMore(ctx.source);
+    ctx.text = ctx.sourceBuffer.data();
+    ctx.textsize = ctx.sourceBuffer.size();
+    ctx.lineBuf = ctx.text + line;
+    if (!more)
+      return;
+  }
+}
+
+/* getNextChar fetches the next non-blank character
+   from lineBuf, advancing lineBuf to the next line
+   of the buffer if it is exhausted */
+static int getNextChar(CompilerContext &ctx) {
+  if (!(ctx.linepos < ctx.bufsize)) {
+    if (ctx.EOF_flag) /* every further token is ENDFILE on this line */
+      return EOF;
+    ctx.lineno++;
+    if (ctx.streamed)
+      readLine(ctx);
+    else if (ctx.text == NULL) {
+      ctx.sourceBuffer.read(ctx.source);
+      setScanBuffer(ctx, ctx.sourceBuffer.data(), ctx.sourceBuffer.size());
+    }
+    if (ctx.textpos < ctx.textsize) {
+      const char *line = ctx.text + ctx.textpos;
+      const char *nl =
+          (const char *)memchr(line, '\n', ctx.textsize - ctx.textpos);
+      ctx.bufsize = nl ? (int)(nl - line) + 1 : (int)(ctx.textsize - ctx.textpos);
+      if (EchoSource && ctx.listing != NULL)
+        fprintf(ctx.listing, "%4d: %.*s", ctx.lineno, ctx.bufsize, line);
+      if (ctx.lineStates != NULL)
+        ctx.lineStates->push_back({(unsigned)ctx.textpos, ctx.inComment});
+      ctx.lineBuf = line;
+      ctx.textpos += ctx.bufsize;
+      ctx.linepos = 0;
+      return (unsigned char)ctx.lineBuf[ctx.linepos++];
+    } else {
+      /* there is no line lineno: the end of the text
+       * is on the line before, if any
+       */
+      if (ctx.lineno > 1)
+        ctx.lineno--;
+      ctx.EOF_flag = TRUE;
+      return EOF;
+    }
+  } else
+    return (unsigned char)ctx.lineBuf[ctx.linepos++];
+}
+
+/* ungetNextChar backtracks one character
+   in lineBuf */
+static void ungetNextChar(CompilerContext &ctx) {
+  if (!ctx.EOF_flag)
+    ctx.linepos--;
+}
+
+/* offset of the next character in text */
+static size_t textOffset(const CompilerContext &ctx) {
+  return (size_t)(ctx.lineBuf - ctx.text) + ctx.linepos;
+}
+
+/* classes of characters in the scanner DFA */
+typedef enum {
+  CSINGLE,  /* a token by itself, or ERROR */
+  CBLANK,
+  CDIGIT,
+  CLETTER,
+  CBRACE,   /* '{' opens a comment */
+  CCOLON,   /* ':=' or '::=' */
+  CPLUS,    /* '+' or '+=' */
+  CCOMPARE, /* '<' or '>', maybe followed by '=' */
+  CEOF      /* not a character: the end of the text */
+} CharClass;
+
+/* charTable classifies every character and gives
+ * the token of each CSINGLE one
+ */
+struct CharTable {
+  unsigned char cls[256];
+  unsigned char token[256];
+};
+
+static constexpr CharTable buildCharTable(void) {
+  CharTable t = {};
+  for (int c = 0; c < 256; c++) {
+    t.cls[c] = CSINGLE;
+    t.token[c] = ERROR;
+  }
+  for (int c = '0'; c <= '9'; c++)
+    t.cls[c] = CDIGIT;
+  for (int c = 'a'; c <= 'z'; c++)
+    t.cls[c] = t.cls[c - 'a' + 'A'] = CLETTER;
+  t.cls[' '] = t.cls['\t'] = t.cls['\n'] = CBLANK;
+  t.cls['{'] = CBRACE;
+  t.cls[':'] = CCOLON;
+  t.cls['+'] = CPLUS;
+  t.cls['<'] = t.cls['>'] = CCOMPARE;
+  const struct {
+    char c;
+    TokenType tok;
+  } singles[] = {{'=', EQ},      {'-', MINUS},   {'*', TIMES},  {'/', OVER},
+                 {'%', REMAIN},  {'^', POWER},   {'(', LPAREN}, {')', RPAREN},
+                 {'[', LBACKET}, {']', RBACKET}, {';', SEMI},   {'|', UNION},
+                 {'&', CONCAT},  {'#', CLOSURE}, {'?', OPTION}};
+  for (const auto &s : singles)
+    t.token[(unsigned char)s.c] = (unsigned char)s.tok;
+  return t;
+}
+
+static constexpr CharTable charTable = buildCharTable();
+
+static inline int charClass(int c) {
+  return c == EOF ? (int)CEOF : charTable.cls[c];
+}
+
+int ScanKernels = TRUE;
+
+/* The kernels below skip a run of characters that
+ * leaves the DFA in its state, VECBYTES at a time
+ * where the compiler targets SSE2 or AVX2 and one
+ * at a time otherwise
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VECBYTES 32
+typedef __m256i Vec;
+static inline Vec vecLoad(const char *p) {
+  return _mm256_loadu_si256((const __m256i *)p);
+}
+static inline Vec vecSplat(char c) { return _mm256_set1_epi8(c); }
+static inline Vec vecEq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+static inline Vec vecGt(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+static inline Vec vecAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+static inline Vec vecOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+static inline uint32_t vecMask(Vec v) {
+  return (uint32_t)_mm256_movemask_epi8(v);
+}
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VECBYTES 16
+typedef __m128i Vec;
+static inline Vec vecLoad(const char *p) {
+  return _mm_loadu_si128((const __m128i *)p);
+}
+static inline Vec vecSplat(char c) { return _mm_set1_epi8(c); }
+static inline Vec vecEq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+static inline Vec vecGt(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+static inline Vec vecAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+static inline Vec vecOr(Vec a, Vec b) { return _mm_or_si128(a, b); }
+static inline uint32_t vecMask(Vec v) { return (uint32_t)_mm_movemask_epi8(v); }
+#endif
+
+#ifdef VECBYTES
+/* characters tried one at a time before a kernel
+ * starts loading vectors
+ */
+#define SHORTRUN 2
+#define VECALL ((uint32_t)((1ull << VECBYTES) - 1))
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline unsigned firstBit(uint32_t m) {
+  unsigned long i;
+  _BitScanForward(&i, m);
+  return (unsigned)i;
+}
+#else
+static inline unsigned firstBit(uint32_t m) { return __builtin_ctz(m); }
+#endif
+
+/* the bytes of v from lo to hi, both below 128 */
+static inline Vec vecRange(Vec v, char lo, char hi) {
+  return vecAnd(vecGt(v, vecSplat(lo - 1)), vecGt(vecSplat(hi + 1), v));
+}
+#endif
+
+/* every run says which characters end it, both
+ * one and VECBYTES at a time
+ */
+struct BlankRun {
+  static bool ends(unsigned char c) { return charTable.cls[c] != CBLANK; }
+#ifdef VECBYTES
+  static uint32_t ends(Vec v) {
+    Vec blank = vecOr(vecOr(vecEq(v, vecSplat(' ')), vecEq(v, vecSplat('\t'))),
+                      vecEq(v, vecSplat('\n')));
+    return vecMask(blank) ^ VECALL;
+  }
+#endif
+};
+
+struct DigitRun {
+  static bool ends(unsigned char c) { return charTable.cls[c] != CDIGIT; }
+#ifdef VECBYTES
+  static uint32_t ends(Vec v) {
+    return vecMask(vecRange(v, '0', '9')) ^ VECALL;
+  }
+#endif
+};
+
+struct LetterRun {
+  static bool ends(unsigned char c) { return charTable.cls[c] != CLETTER; }
+#ifdef VECBYTES
+  /* setting bit 5 maps 'A'..'Z' onto 'a'..'z' and
+   * nothing else onto them
+   */
+  static uint32_t ends(Vec v) {
+    return vecMask(vecRange(vecOr(v, vecSplat(0x20)), 'a', 'z')) ^ VECALL;
+  }
+#endif
+};
+
+struct CommentRun {
+  static bool ends(unsigned char c) { return c == '}'; }
+#ifdef VECBYTES
+  static uint32_t ends(Vec v) { return vecMask(vecEq(v, vecSplat('}'))); }
+#endif
+};
+
+/* skip returns the offset of the first character
+ * of s[pos..end-1] that ends Run, or end
+ */
+template <typename Run>
+static size_t skip(const char *s, size_t pos, size_t end) {
+#ifdef VECBYTES
+  /* most runs are short: try a few characters
+   * before loading whole vectors
+   */
+  for (size_t probe = pos + SHORTRUN; pos < end && pos < probe; pos++)
+    if (Run::ends((unsigned char)s[pos]))
+      return pos;
+  for (; pos + VECBYTES <= end; pos += VECBYTES) {
+    uint32_t m = Run::ends(vecLoad(s + pos));
+    if (m != 0)
+      return pos + firstBit(m);
+  }
+#endif
+  while (pos < end && !Run::ends((unsigned char)s[pos]))
+    pos++;
+  return pos;
+}
+
+const char *scanKernel(void) {
+#if defined(__AVX2__)
+  return "avx2";
+#elif defined(VECBYTES)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+/* skipRun moves past the characters left on the
+ * current line that would not change state; the
+ * DFA then reads the one that ends the run. Runs
+ * stop at the end of the line, so getNextChar
+ * still sees every line
+ */
+static void skipRun(CompilerContext &ctx, StateType state) {
+  const char *s = ctx.lineBuf;
+  size_t pos = (size_t)ctx.linepos, end = (size_t)ctx.bufsize;
+  if (pos >= end)
+    return;
+  switch (state) {
+  case START:
+    pos = skip<BlankRun>(s, pos, end);
+    break;
+  case INCOMMENT:
+    pos = skip<CommentRun>(s, pos, end);
+    break;
+  case INNUM:
+    pos = skip<DigitRun>(s, pos, end);
+    break;
+  case INID:
+    pos = skip<LetterRun>(s, pos, end);
+    break;
+  default:
+    return;
+  }
+  ctx.linepos = (int)pos;
+}
+
+/* lookup table of reserved words, spelled as in
+ * tokenSpellings; the hash table below is generated
+ * from it at compile time
+ */
+constexpr ReservedWord reservedWords[MAXRESERVED] = {
+    {tokenSpelling(IF), IF},
+    {tokenSpelling(ELSE), ELSE},
+    {tokenSpelling(REPEAT), REPEAT},
+    {tokenSpelling(UNTIL), UNTIL},
+    {tokenSpelling(READ), READ},
+    {tokenSpelling(WRITE), WRITE},
+    {tokenSpelling(FOR), FOR},
+    {tokenSpelling(TO), TO},
+    {tokenSpelling(DOWNTO), DOWNTO},
+    {tokenSpelling(DO), DO},
+    {tokenSpelling(ENDDO), ENDDO},
+    {tokenSpelling(AND), AND},
+    {tokenSpelling(OR), OR},
+    {tokenSpelling(NOT), NOT},
+};
+
+/* HASHBITS = log2 of the reserved word hash table size */
+#define HASHBITS 5
+#define HASHSIZE (1 << HASHBITS)
+
+/* reservedHash mixes the length, the first two and
+ * the last character of s with a multiplicative seed
+ */
+static constexpr unsigned reservedHash(std::string_view s, uint32_t seed) {
+  uint32_t key = (uint32_t)(unsigned char)s[0] |
+                 (uint32_t)(unsigned char)s[s.size() > 1 ? 1 : 0] << 8 |
+                 (uint32_t)(unsigned char)s[s.size() - 1] << 16 |
+                 (uint32_t)s.size() << 24;
+  return (uint32_t)(key * seed) >> (32 - HASHBITS);
+}
+
+/* findReservedSeed searches for the first seed that
+ * sends every reserved word to its own slot
+ */
+static constexpr uint32_t findReservedSeed(void) {
+  for (uint32_t seed = 1; seed < 0x100000; seed += 2) {
+    bool used[HASHSIZE] = {};
+    bool ok = true;
+    for (int i = 0; i < MAXRESERVED && ok; i++) {
+      unsigned h = reservedHash(reservedWords[i].str, seed);
+      ok = !used[h];
+      used[h] = true;
+    }
+    if (ok)
+      return seed;
+  }
+  return 0;
+}
+
+static constexpr uint32_t reservedSeed = findReservedSeed();
+static_assert(reservedSeed != 0, "no perfect hash for reservedWords");
+
+/* reservedTable maps each hash slot to the index
+ * of its reserved word, or -1
+ */
+struct ReservedTable {
+  signed char slot[HASHSIZE];
+  size_t maxlen;
+};
+
+static constexpr ReservedTable buildReservedTable(void) {
+  ReservedTable t = {};
+  for (int h = 0; h < HASHSIZE; h++)
+    t.slot[h] = -1;
+  for (int i = 0; i < MAXRESERVED; i++) {
+    t.slot[reservedHash(reservedWords[i].str, reservedSeed)] = (signed char)i;
+    if (reservedWords[i].str.size() > t.maxlen)
+      t.maxlen = reservedWords[i].str.size();
+  }
+  return t;
+}
+
+static constexpr ReservedTable reservedTable = buildReservedTable();
+
+/* lookup an identifier to see if it is a reserved word */
+/* uses a perfect hash: at most one comparison */
+TokenType reservedLookup(std::string_view s) {
+  if (s.empty() || s.size() > reservedTable.maxlen)
+    return ID;
+  int i = reservedTable.slot[reservedHash(s, reservedSeed)];
+  if (i >= 0 && reservedWords[i].str == s)
+    return reservedWords[i].tok;
+  return ID;
+}
+
+/* echoLines echoes the lines up to line while
+ * tokens are replayed, just as getNextChar does
+ * when it reads them
+ */
+static void echoLines(CompilerContext &ctx, unsigned line) {
+  while ((unsigned)ctx.echoLine < line && ctx.echoed < ctx.textsize) {
+    const char *s = ctx.text + ctx.echoed;
+    const char *nl = (const char *)memchr(s, '\n', ctx.textsize - ctx.echoed);
+    int n = nl ? (int)(nl - s) + 1 : (int)(ctx.textsize - ctx.echoed);
+    fprintf(ctx.listing, "%4d: %.*s", ++ctx.echoLine, n, s);
+    ctx.echoed += n;
+  }
+}
+
+/* the cancel flag is read once every CANCELCHECK
+ * tokens scanned or replayed
+ */
+#define CANCELCHECK 1024
+
+static int cancelled(const CompilerContext &ctx, size_t n) {
+  return ctx.cancel != NULL && n % CANCELCHECK == 0 &&
+         ctx.cancel->load(std::memory_order_relaxed);
+}
+
+/* replayToken returns the next token of
+ * ctx.tokenArray, refilled from ctx.tokenFeed when
+ * it runs out; the last one, ENDFILE, repeats
+ */
+static TokenType replayToken(CompilerContext &ctx) {
+  if (cancelled(ctx, ctx.tokenNext))
+    ctx.tokenNext = ctx.tokenCount;
+  if (ctx.tokenNext >= ctx.tokenCount && ctx.tokenFeed != NULL)
+    ctx.tokenFeed->refill(ctx);
+  size_t i = ctx.tokenNext < ctx.tokenCount ? ctx.tokenNext++
+                                             : ctx.tokenCount - 1;
+  const Token &t = ctx.tokenArray[i];
+  if (EchoSource && ctx.listing != NULL)
+    echoLines(ctx, t.line);
+  ctx.tokenString = std::string_view(ctx.text + t.offset, t.length);
+  ctx.lineno = (int)t.line;
+  return (TokenType)t.type;
+}
+
+/****************************************/
+/* the primary function of the scanner  */
+/****************************************/
+/* function getToken returns the
+ * next token in source file
+ */
+TokenType getToken(CompilerContext &ctx) {
+  /* holds current token to be returned */
+  TokenType currentToken;
+  /* current state - begins at START unless
+   * scanning resumes inside a comment */
+  StateType state = ctx.inComment ? INCOMMENT : START;
+  /* flag to indicate the character belongs to tokenString */
+  int save;
+  /* flag to indicate tokenStart is set */
+  int started = FALSE;
+  if (ctx.tokenArray != NULL || ctx.tokenFeed != NULL) {
+    currentToken = replayToken(ctx);
+    state = DONE;
+  }
+  while (state != DONE) {
+    if (ScanKernels)
+      skipRun(ctx, state);
+    int c = getNextChar(ctx);
+    save = TRUE;
+    switch (state) {
+    case START:
+      switch (charClass(c)) {
+      case CDIGIT:
+        state = INNUM;
+        break;
+      case CLETTER:
+        state = INID;
+        break;
+      case CCOLON:
+        state = INASSIGN;
+        break;
+      case CBLANK:
+        save = FALSE;
+        break;
+      case CBRACE:
+        save = FALSE;
+        state = INCOMMENT;
+        ctx.inComment = TRUE;
+        break;
+      case CPLUS:
+        state = INCOMPUTE; // + / +=
+        break;
+      case CCOMPARE:
+        state = INCOMPARE;
+        break;
+      case CEOF:
+        save = FALSE;
+        state = DONE;
+        currentToken = ENDFILE;
+        break;
+      default:
+        state = DONE;
+        currentToken = (TokenType)charTable.token[c];
+        break;
+      }
+      break;
+    case INCOMMENT:
+      save = FALSE;
+      if (c == EOF) {
+        state = DONE;
+        currentToken = ENDFILE;
+        ctx.inComment = FALSE;
+      } else if (c == '}') {
+        state = START;
+        ctx.inComment = FALSE;
+      }
+      break;
+    case INASSIGN:
+      state = DONE;
+      if (c == '=')
+        currentToken = ASSIGN;
+      else if (c == ':') {
+        // ::= RegExp
+        if (getNextChar(ctx) == '=')
+          currentToken = REG;
+        else {
+          ungetNextChar(ctx);
+          save = FALSE;
+          currentToken = REG;
+        }
+        break;
+      }
+      else { /* backup in the input */
+        ungetNextChar(ctx);
+        save = FALSE;
+        currentToken = ERROR;
+      }
+      break;
+    case INCOMPUTE:
+      state = DONE;
+      if (c == '=')
+        currentToken = PLUS_EQ;
+      else {
+        ungetNextChar(ctx);
+        currentToken = PLUS;
+      }
+      break;
+    case INCOMPARE:
+    { /* the lexeme began with '<' or '>' */
+      char first = ctx.text[ctx.tokenStart];
+      state = DONE;
+      if (c == '=')
+        currentToken = first == '<' ? LTE : GTE;
+      else if (first == '<' && c == '>')
+        currentToken = NEQ;
+      else {
+        ungetNextChar(ctx);
+        currentToken = first == '<' ? LT : GT;
+      }
+      break;
+    }
+    case INNUM:
+      if (charClass(c) != CDIGIT) { /* backup in the input */
+        ungetNextChar(ctx);
+        save = FALSE;
+        state = DONE;
+        currentToken = NUM;
+      }
+      break;
+    case INID:
+      if (charClass(c) != CLETTER) { /* backup in the input */
+        ungetNextChar(ctx);
+        save = FALSE;
+        state = DONE;
+        currentToken = ID;
+      }
+      break;
+    case DONE:
+    default: /* should never happen */
+      if (ctx.listing != NULL)
+        fprintf(ctx.listing, "Scanner Bug: state= %d\n", state);
+      state = DONE;
+      currentToken = ERROR;
+      break;
+    }
+    /* the lexeme begins with the first saved character */
+    if (save && !started) {
+      started = TRUE;
+      ctx.tokenStart = textOffset(ctx) - 1;
+    }
+    if (state == DONE) {
+      if (currentToken == ENDFILE)
+        ctx.tokenStart = textOffset(ctx);
+      ctx.tokenString = std::string_view(ctx.text + ctx.tokenStart,
+                                         textOffset(ctx) - ctx.tokenStart);
+      if (currentToken == ID)
+        currentToken = reservedLookup(ctx.tokenString);
+    }
+  }
+  ctx.tokens++;
+  if (TraceScan && ctx.listing != NULL) {
+    fprintf(ctx.listing, "\t%d: ", ctx.lineno);
+    printToken(ctx.listing, currentToken, ctx.tokenString);
+  }
+  return currentToken;
+} /* end getToken */
+
+int tokenColumn(const CompilerContext &ctx) {
+  /* ENDFILE after a final newline is at the end of
+   * the last line, whose number the scanner gives it
+   */
+  const char *p = ctx.tokenString.data();
+  if (p == ctx.text + ctx.textsize && p > ctx.text && p[-1] == '\n')
+    p--;
+  const char *start = ctx.lineBuf;
+  if (ctx.tokenArray != NULL) {
+    /* replayed tokens keep no line: search back for
+     * its start
+     */
+    for (start = p; start > ctx.text && start[-1] != '\n'; start--)
+      ;
+  }
+  return (int)(p - start) + 1;
+}
+
+Token scanToken(CompilerContext &ctx) {
+  Token t;
+  t.type = (uint8_t)getToken(ctx);
+  t.offset = (uint32_t)(ctx.tokenString.data() - ctx.text);
+  t.length = (uint32_t)ctx.tokenString.size();
+  t.line = (uint32_t)ctx.lineno;
+  return t;
+}
+
+static_assert(sizeof(Token) == 16, "Token should stay compact");
+
+void tokenize(CompilerContext &ctx, std::vector<Token> &tokens) {
+  FILE *listing = ctx.listing;
+  ctx.listing = NULL; /* written when replayed */
+  tokens.reserve(tokens.size() + ctx.textsize / 4 + 1);
+  do {
+    if (cancelled(ctx, tokens.size())) {
+      /* end the text here */
+      ctx.textpos = ctx.textsize;
+      ctx.linepos = ctx.bufsize;
+      ctx.inComment = FALSE;
+    }
+    tokens.push_back(scanToken(ctx));
+  } while (tokens.back().type != ENDFILE);
+  ctx.listing = listing;
+}
@@ -1,22 +1,111 @@
-/****************************************************/
-/* File: scan.h                                     */
-/* The scanner interface for the TINY compiler      */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-#ifndef _SCAN_H_
-#define _SCAN_H_
-
-#include "globals.h"
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXTOKENLEN 40
-
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN+1];
-
-/* function getToken returns the 
- * next token in source file
- */
-TokenType getToken(void);
-
-#endif
+/****************************************************/
+/* File: scan.h                                     */
+/* The scanner interface for the TINY compiler      */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include "globals.h"
+#include "context.h"
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+/* Token describes one lexeme as a view into the
+ * scanned buffer; nothing is copied while scanning.
+ * It takes 16 bytes; with a token every three
+ * bytes or so, the tokens of a program need about
+ * five times the space of its text
+ */
+struct Token {
+  uint32_t offset; /* byte offset of the lexeme */
+  uint32_t length; /* length of the lexeme */
+  uint32_t line;   /* lineno when it was scanned */
+  uint8_t type;    /* TokenType */
+};
+
+/* TokenFeed supplies the tokens of a text that is
+ * still being scanned. When getToken has replayed
+ * every token of ctx.tokenArray, it calls refill,
+ * which must point ctx.tokenArray, tokenCount,
+ * text and textsize at a longer buffer that still
+ * holds the tokens already replayed, or leave them
+ * alone once ENDFILE has been supplied
+ */
+class TokenFeed {
+public:
+  virtual ~TokenFeed() {}
+  virtual void refill(CompilerContext &ctx) = 0;
+};
+
+/* reservedWords lists every reserved word with
+ * its spelling from tokenSpelling (util.h)
+ */
+typedef struct {
+  std::string_view str;
+  TokenType tok;
+} ReservedWord;
+
+extern const ReservedWord reservedWords[MAXRESERVED];
+
+/* setScanBuffer makes the scanner read the size
+ * bytes at text, which must outlive the scan.
+ * Without a buffer the scanner reads all of the
+ * source file into memory on its first token, or
+ * with ctx.streamed a block at a time as it goes.
+ * ctx.tokenString then views the lexeme of the
+ * last token inside that buffer
+ */
+void setScanBuffer(CompilerContext &ctx, const char *text, size_t size);
+
+/* setScanPosition resumes scanning at offset,
+ * which must be the start of line lineno; the
+ * scanner begins inside a comment if inComment
+ */
+void setScanPosition(CompilerContext &ctx, size_t offset, int lineno,
+                     int inComment);
+
+/* function tokenColumn returns the 1-based
+ * column of the last token on its line
+ */
+int tokenColumn(const CompilerContext &ctx);
+
+/* function reservedLookup returns the token of
+ * the reserved word spelled s, or ID
+ */
+TokenType reservedLookup(std::string_view s);
+
+/* function getToken returns the 
+ * next token in source file, or the next one of
+ * ctx.tokenArray or ctx.tokenFeed when either is
+ * set
+ */
+TokenType getToken(CompilerContext &ctx);
+
+/* ScanKernels = FALSE makes getToken read every
+ * character through the DFA one at a time instead
+ * of skipping runs of blanks, digits, letters and
+ * comment text with the kernels named by scanKernel
+ */
+extern int ScanKernels;
+
+/* scanKernel returns "avx2", "sse2" or "scalar" */
+const char *scanKernel(void);
+
+/* function scanToken returns the next token
+ * together with the position of its lexeme
+ */
+Token scanToken(CompilerContext &ctx);
+
+/* tokenize scans the rest of the buffer once and
+ * appends every token, ENDFILE last, to tokens.
+ * Pointing ctx.tokenArray at the result lets the
+ * parser, tracing and other passes reuse it; the
+ * listing is written when the tokens are replayed.
+ * Once ctx.cancel is set it ends the tokens early
+ */
+void tokenize(CompilerContext &ctx, std::vector<Token> &tokens);
+
+#endif
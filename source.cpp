@@ -0,0 +1,108 @@
+/****************************************************/
+/* File: source.cpp                                 */
+/* Whole-file source buffer implementation          */
+/****************************************************/
+
+#include "source.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* readMore reads the stream READBLOCK bytes at a
+ * time and at least doubles the buffer when full
+ */
+#define READBLOCK (64 * 1024)
+
+SourceBuffer::SourceBuffer()
+    : text(""), length(0), mapped(NULL), capacity(0), released(0), freed(0) {}
+
+SourceBuffer::~SourceBuffer() { clear(); }
+
+void SourceBuffer::clear() {
+#ifndef _WIN32
+  if (mapped != NULL)
+    munmap(mapped, length);
+#endif
+  mapped = NULL;
+  owned.clear();
+  grown.clear();
+  capacity = 0;
+  released.store(0, std::memory_order_relaxed);
+  freed = 0;
+  text = "";
+  length = 0;
+}
+
+bool SourceBuffer::map(const char *path) {
+  clear();
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+      madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+      close(fd);
+      mapped = p;
+      text = (const char *)p;
+      length = (size_t)st.st_size;
+      return true;
+    }
+  }
+  close(fd);
+#endif
+  /* empty files, pipes and platforms without mmap */
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return false;
+  bool ok = read(f);
+  fclose(f);
+  return ok;
+}
+
+bool SourceBuffer::read(FILE *stream) {
+  clear();
+  char buf[64 * 1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), stream)) > 0)
+    owned.append(buf, n);
+  text = owned.data();
+  length = owned.size();
+  return !ferror(stream);
+}
+
+void SourceBuffer::borrow(const char *t, size_t size) {
+  clear();
+  text = t;
+  length = size;
+}
+
+bool SourceBuffer::readMore(FILE *stream) {
+  /* the text only grows, so nothing but the copy
+   * made last is needed here
+   */
+  size_t r = released.load(std::memory_order_acquire);
+  for (; freed + 1 < r; freed++)
+    grown[freed].reset();
+  if (grown.empty() || length + READBLOCK > capacity) {
+    size_t size = 2 * capacity > length + READBLOCK ? 2 * capacity
+                                                    : 4 * READBLOCK + length;
+    std::unique_ptr<char[]> p(new char[size]);
+    memcpy(p.get(), text, length);
+    grown.push_back(std::move(p));
+    capacity = size;
+    text = grown.back().get();
+  }
+  size_t n = fread(grown.back().get() + length, 1, READBLOCK, stream);
+  length += n;
+  return n > 0;
+}
@@ -0,0 +1,80 @@
+/****************************************************/
+/* File: source.h                                   */
+/* Whole-file source buffers for the scanner        */
+/****************************************************/
+#ifndef _SOURCE_H_
+#define _SOURCE_H_
+
+#include <atomic>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* A SourceBuffer holds the complete text of a
+ * program in memory so that the scanner can hand
+ * out lexemes as views instead of copies. The text
+ * is either memory-mapped from a file, read from a
+ * stream whole or a block at a time, or borrowed
+ * from the caller
+ */
+class SourceBuffer {
+public:
+  SourceBuffer();
+  ~SourceBuffer();
+
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+  /* map makes the contents of the file at path
+   * available without copying; returns false if
+   * the file cannot be opened
+   */
+  bool map(const char *path);
+
+  /* read copies everything left in the stream */
+  bool read(FILE *stream);
+
+  /* readMore appends the next block of the stream;
+   * returns false once it has ended. The text may
+   * move as it grows, but every earlier version
+   * stays valid until release() lets it go, so that
+   * another thread can go on reading what it was
+   * given
+   */
+  bool readMore(FILE *stream);
+
+  /* generation numbers the version of the text
+   * readMore made last, from 1
+   */
+  size_t generation() const { return grown.size(); }
+
+  /* release lets readMore free the versions made
+   * before generation; another thread may call it
+   */
+  void release(size_t generation) {
+    released.store(generation, std::memory_order_release);
+  }
+
+  /* borrow refers to text owned by the caller,
+   * which must outlive the scan
+   */
+  void borrow(const char *text, size_t size);
+
+  void clear();
+
+  const char *data() const { return text; }
+  size_t size() const { return length; }
+
+private:
+  const char *text;
+  size_t length;
+  void *mapped;      /* start of the mapping, if any */
+  std::string owned; /* storage when not mapped */
+  std::vector<std::unique_ptr<char[]>> grown; /* storage for readMore */
+  size_t capacity;   /* of grown.back() */
+  std::atomic<size_t> released; /* generation before which to free */
+  size_t freed;      /* generations freed */
+};
+
+#endif
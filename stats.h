@@ -0,0 +1,60 @@
+/****************************************************/
+/* File: stats.h                                    */
+/* Per-phase timers and counters of one analysis    */
+/****************************************************/
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+/* AnalyzeStats tells where the time of one analysis
+ * went and how much it built. A build with NO_STATS
+ * defined (CONFIG+=nostats) compiles the timers and
+ * the depth count away, leaving them 0; the other
+ * counters are read off the result once at the end
+ */
+struct AnalyzeStats {
+  int64_t readNs = 0;  /* reading or mapping the source */
+  int64_t scanNs = 0;  /* scanning it into tokens */
+  int64_t parseNs = 0; /* building the syntax tree */
+  int64_t analyzeNs = 0; /* building the symbol table */
+  int64_t typeNs = 0;    /* checking types */
+  long tokens = 0;     /* tokens in the token buffer */
+  long nodes = 0;      /* syntax tree nodes */
+  size_t bytes = 0;    /* bytes allocated from the arenas */
+  int maxDepth = 0;    /* deepest recursion of the parser */
+  long diagnostics = 0;
+  long typeErrors = 0; /* mismatches found by typeCheck */
+  long symbols = 0;    /* variables in the symbol table */
+};
+
+/* PhaseTimer adds the nanoseconds from its creation
+ * to its destruction to a timer
+ */
+class PhaseTimer {
+public:
+#ifndef NO_STATS
+  explicit PhaseTimer(int64_t &ns)
+      : ns(ns), start(std::chrono::steady_clock::now()) {}
+  ~PhaseTimer() {
+    ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+  }
+#else
+  explicit PhaseTimer(int64_t &) {}
+#endif
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+#ifndef NO_STATS
+private:
+  int64_t &ns;
+  std::chrono::steady_clock::time_point start;
+#endif
+};
+
+#endif
@@ -0,0 +1,82 @@
+/****************************************************/
+/* File: symtab.cpp                                 */
+/* Symbol table implementation                      */
+/****************************************************/
+
+#include "symtab.h"
+
+SymbolTable::SymbolTable() {}
+
+/* find returns the id of s, or -1 with *slot set
+ * to the empty slot where s belongs
+ */
+int SymbolTable::find(std::string_view s, uint32_t h, size_t *slot) const {
+  return index.find(h, [&](int id) { return names[id] == s; }, slot);
+}
+
+int SymbolTable::lookup(std::string_view name) const {
+  size_t slot;
+  return find(name, hashName(name), &slot);
+}
+
+int SymbolTable::insert(std::string_view name, int lineno, int loc) {
+  uint32_t h = hashName(name);
+  size_t slot;
+  int id = find(name, h, &slot);
+  if (id < 0) { /* variable not yet in table */
+    names.push_back(name);
+    lines.push_back(lineno);
+    locations.push_back(loc);
+    id = index.add(slot, h);
+  }
+  reference(id, lineno);
+  return id;
+}
+
+/* finish is a counting sort of the references by
+ * symbol, which keeps the lines of each in order
+ */
+void SymbolTable::finish() {
+  refStart.assign(names.size() + 1, 0);
+  for (int id : refSymbols)
+    refStart[id + 1]++;
+  for (size_t id = 0; id < names.size(); id++)
+    refStart[id + 1] += refStart[id];
+  refLines.resize(refSymbols.size());
+  std::vector<size_t> next(refStart.begin(), refStart.end() - 1);
+  for (size_t i = 0; i < refSymbols.size(); i++)
+    refLines[next[refSymbols[i]]++] = refInserted[i];
+}
+
+SymbolTable::LineList SymbolTable::references(int id) const {
+  return {refLines.data() + refStart[id], refStart[id + 1] - refStart[id]};
+}
+
+void SymbolTable::clear() {
+  index.clear();
+  names.clear();
+  lines.clear();
+  locations.clear();
+  refSymbols.clear();
+  refInserted.clear();
+  refStart.clear();
+  refLines.clear();
+}
+
+/* Procedure printSymTab prints a formatted
+ * listing of the symbol table contents
+ * to the listing file
+ */
+void printSymTab(FILE *listing, const SymbolTable &st) {
+  fprintf(listing, "Variable Name  Location   Line Numbers\n");
+  fprintf(listing, "-------------  --------   ------------\n");
+  for (int id = 0; id < st.size(); id++) {
+    std::string_view name = st.name(id);
+    fprintf(listing, "%-14.*s ", (int)name.size(), name.data());
+    fprintf(listing, "%-8d  ", st.location(id));
+    SymbolTable::LineList l = st.references(id);
+    for (size_t i = 0; i < l.count; i++)
+      fprintf(listing, "%4d ", l.lines[i]);
+    fprintf(listing, "\n");
+  }
+}
@@ -0,0 +1,88 @@
+/****************************************************/
+/* File: symtab.h                                   */
+/* Symbol table of the variables of one program     */
+/****************************************************/
+#ifndef _SYMTAB_H_
+#define _SYMTAB_H_
+
+#include "intern.h"
+#include <stdio.h>
+#include <string_view>
+#include <vector>
+
+/* A SymbolTable records every variable of one
+ * program: the line that first defines it, the
+ * lines of all references to it and its memory
+ * location. Names are found through a NameIndex,
+ * and each symbol is an index into flat arrays
+ * instead of a bucket list. The names
+ * are not copied: they must outlive the table, as
+ * the names of a syntax tree do
+ */
+class SymbolTable {
+public:
+  SymbolTable();
+
+  /* insert records a reference to name on lineno
+   * and returns the id of name. The first one
+   * declares it, with memory location loc; ids are
+   * 0, 1, 2, ... in order of declaration
+   */
+  int insert(std::string_view name, int lineno, int loc);
+
+  /* reference records another reference to the
+   * symbol id on lineno, without looking it up
+   */
+  void reference(int id, int lineno) {
+    refSymbols.push_back(id);
+    refInserted.push_back(lineno);
+  }
+
+  /* lookup returns the id of name, or -1 */
+  int lookup(std::string_view name) const;
+
+  int size() const { return (int)names.size(); }
+  std::string_view name(int id) const { return names[id]; }
+  int declared(int id) const { return lines[id]; }
+  int location(int id) const { return locations[id]; }
+
+  /* finish groups the references by symbol, which
+   * references needs after the last insert
+   */
+  void finish();
+
+  /* LineList is the lines of the references to one
+   * symbol, in the order they were inserted
+   */
+  struct LineList {
+    const int *lines;
+    size_t count;
+  };
+  LineList references(int id) const;
+
+  void clear();
+
+private:
+  int find(std::string_view s, uint32_t h, size_t *slot) const;
+
+  NameIndex index;
+  std::vector<std::string_view> names;
+  std::vector<int> lines;     /* of the declaration */
+  std::vector<int> locations;
+  /* every reference as inserted: symbol and line */
+  std::vector<int> refSymbols;
+  std::vector<int> refInserted;
+  /* the same grouped by finish: the lines of id are
+   * refLines[refStart[id]] up to refStart[id + 1]
+   */
+  std::vector<size_t> refStart;
+  std::vector<int> refLines;
+};
+
+/* Procedure printSymTab prints a formatted
+ * listing of the symbol table contents
+ * to the listing file
+ */
+void printSymTab(FILE *listing, const SymbolTable &st);
+
+#endif
@@ -0,0 +1,454 @@
+/****************************************************/
+/* File: tm.cpp                                     */
+/* The TM machine of Louden's book: loading its     */
+/* assembly and running it fast                     */
+/****************************************************/
+
+#include "tm.h"
+#include "globals.h"
+#include "runtime.h"
+#include <ctype.h>
+#include <string>
+
+static const char *const opCodeTab[] = {
+    "HALT", "IN",  "OUT", "ADD", "SUB", "MUL", "DIV", "????",
+    /* RR opcodes */
+    "LD",   "ST",  "????", /* RM opcodes */
+    "LDA",  "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "????"
+    /* RA opcodes */
+};
+
+/* the forms the simulator predecodes instructions
+ * into, after those of OpCode: a jump relative to
+ * the pc with its target in d, and an instruction
+ * run by step()
+ */
+enum {
+  opJUMP = opRALim + 1, /* LDA 7,d(7) */
+  opJLTA, opJLEA, opJGTA, opJGEA, opJEQA, opJNEA, /* Jcc r,d(7) */
+  opSTEP,
+  TMOPS
+};
+
+/**********************************************/
+/* loading                                    */
+/**********************************************/
+
+/* TmLine scans one line of TM assembly the way
+ * tm.c's getNum and skipCh do
+ */
+struct TmLine {
+  const char *p;
+  const char *start;
+
+  void skipBlanks() {
+    while (*p == ' ' || *p == '\t')
+      p++;
+  }
+  int number(int *n) {
+    skipBlanks();
+    char *end;
+    long v = strtol(p, &end, 10);
+    if (end == p)
+      return FALSE;
+    p = end;
+    *n = (int)v;
+    return TRUE;
+  }
+  int skip(char c) {
+    skipBlanks();
+    if (*p != c)
+      return FALSE;
+    p++;
+    return TRUE;
+  }
+  int reg(int *r) { return number(r) && *r >= 0 && *r < NO_REGS; }
+  int column() const { return (int)(p - start) + 1; }
+};
+
+/* predecode returns the form the simulator runs
+ * instruction i at loc in, for a program of size
+ * instructions
+ */
+static TmInstruction predecode(TmInstruction i, int loc, int size) {
+  int usesPc = i.r == PC_REG || i.s == PC_REG ||
+               (i.op < opRRLim && i.t == PC_REG);
+  if (i.op == opHALT || i.op == opIN || i.op == opOUT)
+    usesPc = i.r == PC_REG;
+  if (i.op == opLDC)
+    usesPc = i.r == PC_REG;
+  if (!usesPc)
+    return i;
+  long target = (long)loc + 1 + i.d;
+  if (i.s == PC_REG && i.r != PC_REG && i.op >= opJLT && i.op <= opJNE &&
+      target >= 0 && target < size) {
+    i.op = opJLTA + (i.op - opJLT);
+    i.d = (int32_t)target;
+  } else if (i.op == opLDA && i.r == PC_REG && i.s == PC_REG && target >= 0 &&
+             target < size) {
+    i.op = opJUMP;
+    i.d = (int32_t)target;
+  } else
+    i.op = opSTEP;
+  return i;
+}
+
+int loadTM(FILE *f, TmCode &tm, Diagnostic *error) {
+  tm.source.clear();
+  tm.code.clear();
+  std::string text;
+  char buf[4096];
+  int lineNo = 0;
+  while (fgets(buf, sizeof(buf), f) != NULL) {
+    text += buf;
+    if (text.back() != '\n' && !feof(f))
+      continue;
+    lineNo++;
+    TmLine line{text.c_str(), text.c_str()};
+    line.skipBlanks();
+    const char *message = NULL;
+    int loc, op, r = 0, s = 0, t = 0, d = 0;
+    if (*line.p == '*' || *line.p == '\n' || *line.p == '\r' ||
+        *line.p == '\0') {
+      text.clear();
+      continue;
+    }
+    if (!line.number(&loc) || loc < 0)
+      message = "Bad location";
+    else if (loc >= IADDR_SIZE)
+      message = "Location too large";
+    else if (!line.skip(':'))
+      message = "Missing colon";
+    else {
+      line.skipBlanks();
+      const char *word = line.p;
+      while (isalpha((unsigned char)*line.p))
+        line.p++;
+      std::string name(word, line.p - word);
+      for (op = 0; op < opRALim; op++)
+        if (name == opCodeTab[op])
+          break;
+      if (name.empty())
+        message = "Missing opcode";
+      else if (op >= opRALim)
+        message = "Illegal opcode";
+      else if (!line.reg(&r))
+        message = "Bad first register";
+      else if (!line.skip(','))
+        message = "Missing comma";
+      else if (op < opRRLim) {
+        if (!line.reg(&s))
+          message = "Bad second register";
+        else if (!line.skip(','))
+          message = "Missing comma";
+        else if (!line.reg(&t))
+          message = "Bad third register";
+      } else if (!line.number(&d))
+        message = "Bad displacement";
+      else if (!line.skip('('))
+        message = "Missing LParen";
+      else if (!line.reg(&s))
+        message = "Bad second register";
+      else if (!line.skip(')'))
+        message = "Missing RParen";
+    }
+    if (message != NULL) {
+      if (error != NULL)
+        *error = {lineNo, line.column(), UnexpectedTokenD, message};
+      tm.source.clear();
+      return FALSE;
+    }
+    if ((size_t)loc >= tm.source.size())
+      tm.source.resize(loc + 1, {opHALT, 0, 0, 0, 0});
+    tm.source[loc] = {(uint8_t)op, (uint8_t)r, (uint8_t)s, (uint8_t)t, d};
+    text.clear();
+  }
+  /* running off the end meets HALT, as in tm.c */
+  tm.source.push_back({opHALT, 0, 0, 0, 0});
+  int size = (int)tm.source.size();
+  tm.code.resize(size);
+  for (int loc = 0; loc < size; loc++)
+    tm.code[loc] = predecode(tm.source[loc], loc, size);
+  return TRUE;
+}
+
+/**********************************************/
+/* running                                    */
+/**********************************************/
+
+/* the ways a run stops, as in tm.c */
+typedef enum {
+  srOKAY,
+  srHALT,
+  srIMEM_ERR,
+  srDMEM_ERR,
+  srZERODIVIDE,
+  srNOINPUT
+} STEPRESULT;
+
+/* TmMachine is the state of one run */
+struct TmMachine {
+  int reg[NO_REGS] = {0};
+  std::vector<int> dMem;
+  FILE *in, *out;
+
+  TmMachine(FILE *in, FILE *out) : dMem(DADDR_SIZE, 0), in(in), out(out) {
+    dMem[0] = DADDR_SIZE - 1;
+  }
+
+  /* step runs instruction i at loc the way tm.c's
+   * stepTM does, with the pc in reg[PC_REG], and
+   * leaves the next location in *next
+   */
+  STEPRESULT step(const TmInstruction &i, int loc, int size, int *next) {
+    reg[PC_REG] = loc + 1;
+    int r = i.r, s = i.s, t = i.t, m = tinyAdd(i.d, reg[s]);
+    switch (i.op) {
+    case opHALT:
+      return srHALT;
+    case opIN:
+      if (in == NULL || fscanf(in, "%d", &reg[r]) != 1)
+        return srNOINPUT;
+      break;
+    case opOUT:
+      if (out != NULL)
+        fprintf(out, "%d\n", reg[r]);
+      break;
+    case opADD:
+      reg[r] = tinyAdd(reg[s], reg[t]);
+      break;
+    case opSUB:
+      reg[r] = tinySub(reg[s], reg[t]);
+      break;
+    case opMUL:
+      reg[r] = tinyMul(reg[s], reg[t]);
+      break;
+    case opDIV:
+      if (reg[t] == 0)
+        return srZERODIVIDE;
+      reg[r] = tinyDiv(reg[s], reg[t]);
+      break;
+    case opLD:
+      if (m < 0 || m >= DADDR_SIZE)
+        return srDMEM_ERR;
+      reg[r] = dMem[m];
+      break;
+    case opST:
+      if (m < 0 || m >= DADDR_SIZE)
+        return srDMEM_ERR;
+      dMem[m] = reg[r];
+      break;
+    case opLDA:
+      reg[r] = m;
+      break;
+    case opLDC:
+      reg[r] = i.d;
+      break;
+    case opJLT:
+      if (reg[r] < 0)
+        reg[PC_REG] = m;
+      break;
+    case opJLE:
+      if (reg[r] <= 0)
+        reg[PC_REG] = m;
+      break;
+    case opJGT:
+      if (reg[r] > 0)
+        reg[PC_REG] = m;
+      break;
+    case opJGE:
+      if (reg[r] >= 0)
+        reg[PC_REG] = m;
+      break;
+    case opJEQ:
+      if (reg[r] == 0)
+        reg[PC_REG] = m;
+      break;
+    case opJNE:
+      if (reg[r] != 0)
+        reg[PC_REG] = m;
+      break;
+    default:
+      break;
+    }
+    *next = reg[PC_REG];
+    if (*next < 0 || *next >= size)
+      return srIMEM_ERR;
+    return srOKAY;
+  }
+};
+
+/* GCC and Clang dispatch through a table of label
+ * addresses, others through a switch
+ */
+#if defined(__GNUC__)
+#define THREADED 1
+#endif
+
+#ifdef THREADED
+#define OP(op) L_##op:
+#define NEXT()                                                                 \
+  {                                                                            \
+    ++pc;                                                                      \
+    goto *codes[pc->op];                                                       \
+  }
+#define JUMP(target)                                                           \
+  {                                                                            \
+    pc = program + (target);                                                   \
+    goto *codes[pc->op];                                                       \
+  }
+#else
+#define OP(op) case op:
+#define NEXT()                                                                 \
+  {                                                                            \
+    ++pc;                                                                      \
+    continue;                                                                  \
+  }
+#define JUMP(target)                                                           \
+  {                                                                            \
+    pc = program + (target);                                                   \
+    continue;                                                                  \
+  }
+#endif
+
+/* m is the data address of an RM instruction */
+#define ADDRESS(m)                                                             \
+  int m = tinyAdd(pc->d, reg[pc->s]);                                          \
+  if (m < 0 || m >= DADDR_SIZE) {                                              \
+    result = srDMEM_ERR;                                                       \
+    goto stopped;                                                              \
+  }
+
+#define CONDJUMP(op, cmp)                                                      \
+  OP(op) {                                                                     \
+    if (reg[pc->r] cmp 0)                                                      \
+      JUMP(pc->d);                                                             \
+    NEXT();                                                                    \
+  }
+
+int runTM(const TmCode &tm, FILE *in, FILE *out, Diagnostic *error) {
+  if (tm.code.empty())
+    return TRUE;
+  TmMachine machine(in, out);
+  int *reg = machine.reg;
+  int *dMem = machine.dMem.data();
+  int size = (int)tm.code.size();
+  const TmInstruction *program = tm.code.data();
+  const TmInstruction *pc = program;
+  STEPRESULT result = srOKAY;
+
+#ifdef THREADED
+  /* the unused slots are the limits of OpCode */
+  static const void *const codes[] = {
+      &&L_opHALT, &&L_opIN,   &&L_opOUT,  &&L_opADD,  &&L_opSUB,  &&L_opMUL,
+      &&L_opDIV,  &&L_opHALT, &&L_opLD,   &&L_opST,   &&L_opHALT, &&L_opLDA,
+      &&L_opLDC,  &&L_opJLT,  &&L_opJLE,  &&L_opJGT,  &&L_opJGE,  &&L_opJEQ,
+      &&L_opJNE,  &&L_opHALT, &&L_opJUMP, &&L_opJLTA, &&L_opJLEA, &&L_opJGTA,
+      &&L_opJGEA, &&L_opJEQA, &&L_opJNEA, &&L_opSTEP};
+  static_assert(sizeof(codes) / sizeof(codes[0]) == TMOPS,
+                "every instruction has its code");
+  goto *codes[pc->op];
+#else
+  for (;;)
+    switch (pc->op) {
+#endif
+
+  OP(opHALT) return TRUE;
+  OP(opIN) {
+    if (in == NULL || fscanf(in, "%d", &reg[pc->r]) != 1) {
+      result = srNOINPUT;
+      goto stopped;
+    }
+    NEXT();
+  }
+  OP(opOUT) {
+    if (out != NULL)
+      fprintf(out, "%d\n", reg[pc->r]);
+    NEXT();
+  }
+  OP(opADD) {
+    reg[pc->r] = tinyAdd(reg[pc->s], reg[pc->t]);
+    NEXT();
+  }
+  OP(opSUB) {
+    reg[pc->r] = tinySub(reg[pc->s], reg[pc->t]);
+    NEXT();
+  }
+  OP(opMUL) {
+    reg[pc->r] = tinyMul(reg[pc->s], reg[pc->t]);
+    NEXT();
+  }
+  OP(opDIV) {
+    if (reg[pc->t] == 0) {
+      result = srZERODIVIDE;
+      goto stopped;
+    }
+    reg[pc->r] = tinyDiv(reg[pc->s], reg[pc->t]);
+    NEXT();
+  }
+  OP(opLD) {
+    ADDRESS(m)
+    reg[pc->r] = dMem[m];
+    NEXT();
+  }
+  OP(opST) {
+    ADDRESS(m)
+    dMem[m] = reg[pc->r];
+    NEXT();
+  }
+  OP(opLDA) {
+    reg[pc->r] = tinyAdd(pc->d, reg[pc->s]);
+    NEXT();
+  }
+  OP(opLDC) {
+    reg[pc->r] = pc->d;
+    NEXT();
+  }
+  OP(opJUMP) JUMP(pc->d);
+  CONDJUMP(opJLTA, <)
+  CONDJUMP(opJLEA, <=)
+  CONDJUMP(opJGTA, >)
+  CONDJUMP(opJGEA, >=)
+  CONDJUMP(opJEQA, ==)
+  CONDJUMP(opJNEA, !=)
+  /* the jumps whose base is no pc have none of it */
+  OP(opJLT) OP(opJLE) OP(opJGT) OP(opJGE) OP(opJEQ) OP(opJNE) OP(opSTEP) {
+    int loc = (int)(pc - program), next;
+    result = machine.step(tm.source[loc], loc, size, &next);
+    if (result == srHALT)
+      return TRUE;
+    if (result != srOKAY)
+      goto stopped;
+    JUMP(next);
+  }
+
+#ifndef THREADED
+    default:
+      return TRUE;
+    }
+#endif
+
+stopped:
+  if (error != NULL) {
+    int loc = (int)(pc - program);
+    char where[32];
+    snprintf(where, sizeof(where), " at location %d", loc);
+    switch (result) {
+    case srZERODIVIDE:
+      *error = {0, 0, DivisionByZeroD, std::string("division by 0") + where};
+      break;
+    case srNOINPUT:
+      *error = {0, 0, NoInputD, std::string("no input for read") + where};
+      break;
+    case srDMEM_ERR:
+      *error = {0, 0, MemoryFaultD,
+                std::string("data address out of range") + where};
+      break;
+    default:
+      *error = {0, 0, MemoryFaultD,
+                std::string("jump out of the program") + where};
+      break;
+    }
+  }
+  return FALSE;
+}
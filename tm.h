@@ -0,0 +1,99 @@
+/****************************************************/
+/* File: tm.h                                       */
+/* The TM machine of Louden's book: loading its     */
+/* assembly and running it fast                     */
+/****************************************************/
+#ifndef _TM_H_
+#define _TM_H_
+
+#include "diagnostic.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/* NO_REGS = the number of registers; the last one
+ * is the program counter
+ */
+#define NO_REGS 8
+#define PC_REG 7
+
+/* IADDR_SIZE = the most instructions a program has,
+ * DADDR_SIZE = the words of data memory
+ */
+#define IADDR_SIZE (1 << 20)
+#define DADDR_SIZE (1 << 16)
+
+/* the instructions of the TM, as in tm.c */
+typedef enum {
+  /* RR instructions */
+  opHALT, /* RR     halt, operands are ignored */
+  opIN,   /* RR     read into reg(r); s and t are ignored */
+  opOUT,  /* RR     write from reg(r), s and t are ignored */
+  opADD,  /* RR     reg(r) = reg(s) + reg(t) */
+  opSUB,  /* RR     reg(r) = reg(s) - reg(t) */
+  opMUL,  /* RR     reg(r) = reg(s) * reg(t) */
+  opDIV,  /* RR     reg(r) = reg(s) / reg(t) */
+  opRRLim, /* limit of RR opcodes */
+
+  /* RM instructions */
+  opLD,    /* RM     reg(r) = mem(d+reg(s)) */
+  opST,    /* RM     mem(d+reg(s)) = reg(r) */
+  opRMLim, /* Limit of RM opcodes */
+
+  /* RA instructions */
+  opLDA,  /* RA     reg(r) = d+reg(s) */
+  opLDC,  /* RA     reg(r) = d ; reg(s) is ignored */
+  opJLT,  /* RA     if reg(r)<0 then reg(7) = d+reg(s) */
+  opJLE,  /* RA     if reg(r)<=0 then reg(7) = d+reg(s) */
+  opJGT,  /* RA     if reg(r)>0 then reg(7) = d+reg(s) */
+  opJGE,  /* RA     if reg(r)>=0 then reg(7) = d+reg(s) */
+  opJEQ,  /* RA     if reg(r)==0 then reg(7) = d+reg(s) */
+  opJNE,  /* RA     if reg(r)!=0 then reg(7) = d+reg(s) */
+  opRALim /* Limit of RA opcodes */
+} OpCode;
+
+/* TmInstruction is one instruction in 8 bytes; d
+ * is the displacement of RM and RA instructions
+ */
+typedef struct {
+  uint8_t op; /* OpCode, or a form of one the simulator made */
+  uint8_t r, s, t;
+  int32_t d;
+} TmInstruction;
+
+/* TmCode is a program loaded for the simulator:
+ * the instructions as read, and the same predecoded
+ * into forms that each do one thing. A jump
+ * relative to the pc gets its target worked out,
+ * and what else uses the pc as a register is run
+ * the slow way tm.c runs everything
+ */
+struct TmCode {
+  std::vector<TmInstruction> source; /* at their locations */
+  std::vector<TmInstruction> code;   /* predecoded */
+};
+
+/* loadTM reads TM assembly from f into tm, in the
+ * format of tm.c: "loc: op r,s,t" or "loc: op
+ * r,d(s)" with anything after it a comment, and
+ * lines starting with * comments too. Locations no
+ * line gives hold HALT. It returns FALSE on the
+ * first bad line, with where and why in *error if
+ * error is not NULL
+ */
+int loadTM(FILE *f, TmCode &tm, Diagnostic *error = NULL);
+
+/* runTM runs tm from location 0 with the registers
+ * 0 and mem(0) DADDR_SIZE - 1, as tm.c starts, and
+ * stops at HALT. IN reads decimal integers from in,
+ * OUT writes them to out one per line, and the
+ * arithmetic is that of runtime.h. It returns TRUE
+ * when the program halts; a division by 0, a read
+ * with no value left or an address outside memory
+ * stops it and returns FALSE with the reason in
+ * *error, whose line is 0 and whose message gives
+ * the location
+ */
+int runTM(const TmCode &tm, FILE *in, FILE *out, Diagnostic *error = NULL);
+
+#endif
@@ -0,0 +1,114 @@
+#include "treemodel.h"
+#include "util.h"
+
+// 每次 fetchMore 取出的节点数
+#define FETCHBATCH 256
+
+// 节点标签的缓冲区大小
+#define LABELSIZE 128
+
+SyntaxTreeModel::SyntaxTreeModel(QObject *parent)
+    : QAbstractItemModel(parent), root{NULL, NULL, 0, MAXCHILDREN, NULL, {}} {}
+
+void SyntaxTreeModel::setAnalysis(std::shared_ptr<const AnalyzeResult> a) {
+  beginResetModel();
+  items.clear();
+  analysis = std::move(a);
+  root = Item{NULL, NULL, 0, MAXCHILDREN, analysis ? analysis->tree : NULL, {}};
+  endResetModel();
+}
+
+SyntaxTreeModel::Item *SyntaxTreeModel::item(const QModelIndex &index) const {
+  if (!index.isValid())
+    return const_cast<Item *>(&root);
+  return static_cast<Item *>(index.internalPointer());
+}
+
+bool SyntaxTreeModel::hasMore(const Item *it) const {
+  if (it->next != NULL)
+    return true;
+  for (int i = it->slot; it->node != NULL && i < MAXCHILDREN; i++)
+    if (it->node->child[i] != NULL)
+      return true;
+  return false;
+}
+
+// 返回 it 下一个尚未取出的子节点，没有时返回 NULL
+const TreeNode *SyntaxTreeModel::nextChild(Item *it) {
+  while (it->next == NULL && it->node != NULL && it->slot < MAXCHILDREN)
+    it->next = it->node->child[it->slot++];
+  const TreeNode *t = it->next;
+  if (t != NULL)
+    it->next = t->sibling;
+  return t;
+}
+
+QModelIndex SyntaxTreeModel::index(int row, int column,
+                                   const QModelIndex &parent) const {
+  Item *p = item(parent);
+  if (column != 0 || row < 0 || row >= (int)p->kids.size())
+    return QModelIndex();
+  return createIndex(row, column, p->kids[row]);
+}
+
+QModelIndex SyntaxTreeModel::parent(const QModelIndex &child) const {
+  if (!child.isValid())
+    return QModelIndex();
+  Item *p = item(child)->parent;
+  if (p == &root)
+    return QModelIndex();
+  return createIndex(p->row, 0, p);
+}
+
+int SyntaxTreeModel::rowCount(const QModelIndex &parent) const {
+  if (parent.column() > 0)
+    return 0;
+  return (int)item(parent)->kids.size();
+}
+
+int SyntaxTreeModel::columnCount(const QModelIndex &) const { return 1; }
+
+QVariant SyntaxTreeModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid())
+    return QVariant();
+  const TreeNode *t = item(index)->node;
+  if (role == Qt::DisplayRole) {
+    // 标签写入栈上的缓冲区，只有特别长的名字才另外分配
+    char buf[LABELSIZE];
+    size_t n = nodeLabel(buf, sizeof(buf), t);
+    if (n < sizeof(buf))
+      return QString::fromUtf8(buf, (int)n);
+    QByteArray label((int)n + 1, Qt::Uninitialized);
+    nodeLabel(label.data(), label.size(), t);
+    return QString::fromUtf8(label.constData(), (int)n);
+  }
+  if (role == Qt::ToolTipRole)
+    return QString("line %1").arg(t->lineno);
+  return QVariant();
+}
+
+bool SyntaxTreeModel::hasChildren(const QModelIndex &parent) const {
+  const Item *it = item(parent);
+  return !it->kids.empty() || hasMore(it);
+}
+
+bool SyntaxTreeModel::canFetchMore(const QModelIndex &parent) const {
+  return hasMore(item(parent));
+}
+
+void SyntaxTreeModel::fetchMore(const QModelIndex &parent) {
+  Item *p = item(parent);
+  std::vector<const TreeNode *> batch;
+  const TreeNode *t;
+  while ((int)batch.size() < FETCHBATCH && (t = nextChild(p)) != NULL)
+    batch.push_back(t);
+  if (batch.empty())
+    return;
+  int first = (int)p->kids.size();
+  beginInsertRows(parent, first, first + (int)batch.size() - 1);
+  for (const TreeNode *node : batch) {
+    items.push_back(Item{node, p, (int)p->kids.size(), 0, NULL, {}});
+    p->kids.push_back(&items.back());
+  }
+  endInsertRows();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "analyze.h"
+
+// 语法树的惰性模型：节点在展开时才取出，每批至多 FETCHBATCH 个，
+// 标签在 data() 中按需生成，打开百万节点的语法树也无需等待
+class SyntaxTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit SyntaxTreeModel(QObject *parent = nullptr);
+
+    // 显示 analysis 的语法树；持有它以保证节点在显示期间有效
+    void setAnalysis(std::shared_ptr<const AnalyzeResult> analysis);
+
+    QModelIndex index(int row, int column,
+                      const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    // 已取出的节点；子节点依次是 child[0..2] 各自的兄弟链
+    struct Item {
+        const TreeNode *node;   // 根为 NULL
+        Item *parent;
+        int row;
+        int slot;               // 下一个要读的 child 下标
+        const TreeNode *next;   // 当前兄弟链中下一个节点
+        std::vector<Item *> kids;
+    };
+
+    Item *item(const QModelIndex &index) const;
+    bool hasMore(const Item *it) const;
+    const TreeNode *nextChild(Item *it);
+
+    std::shared_ptr<const AnalyzeResult> analysis;
+    std::deque<Item> items;     // 地址不变，供 internalPointer 使用
+    Item root;
+};
@@ -1,352 +1,339 @@
-/****************************************************/
-/* File: util.c                                     */
-/* Utility function implementation                  */
-/* for the TINY compiler                            */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-
-// #include "globals.h"
-#include "util.h"
-#include "stdio.h"
-#include <sstream>
-
-/* Procedure printToken prints a token
- * and its lexeme to the listing file
- */
-char *printToken(TokenType token, const char *tokenString) {
-  std::stringstream ss;
-  switch (token) {
-  case IF:
-  case ELSE:
-  case REPEAT:
-  case UNTIL:
-  case READ:
-  case FOR:
-  case TO:
-  case DOWNTO:
-  case ENDDO:
-  case REG:
-  case DO:
-  case WRITE:
-    ss << "reserved word: " << tokenString;
-    fprintf(listing, "reserved word: %s\n", tokenString);
-    break;
-  case ASSIGN:
-    ss << ":=";
-    fprintf(listing, ":=\n");
-    break;
-  /* 比较运算符 */
-  case LT:
-    ss << "<";
-    fprintf(listing, "<\n");
-    break;
-  case LTE:
-    ss << "<=";
-    fprintf(listing, "<=\n");
-    break;
-  case GT:
-    ss << ">";
-    fprintf(listing, ">\n");
-    break;
-  case GTE:
-    ss << ">=";
-    fprintf(listing, ">=\n");
-    break;
-  case EQ:
-    ss << "=";
-    fprintf(listing, "=\n");
-    break;
-  case NEQ:
-    ss << "<>";
-    fprintf(listing, "<>\n");
-    break;
-  /* 分隔符 */
-  case LPAREN:
-    ss << "(";
-    fprintf(listing, "(\n");
-    break;
-  case RPAREN:
-    ss << ")";
-    fprintf(listing, ")\n");
-    break;
-  case LBACKET:
-    ss << "[";
-    fprintf(listing, "[\n");
-    break;
-  case RBACKET:
-    ss << "]";
-    fprintf(listing, "]\n");
-    break;
-  case SEMI:
-    ss << ";";
-    fprintf(listing, ";\n");
-    break;
-  /* 运算符 */
-  case PLUS:
-    ss << "+";
-    fprintf(listing, "+\n");
-    break;
-  case MINUS:
-    ss << "-";
-    fprintf(listing, "-\n");
-    break;
-  case TIMES:
-    ss << "*";
-    fprintf(listing, "*\n");
-    break;
-  case OVER:
-    ss << "/";
-    fprintf(listing, "/\n");
-    break;
-  case PLUS_EQ:
-    ss << "+=";
-    fprintf(listing, "+=\n");
-    break;
-  case REMAIN:
-    ss << "%";
-    fprintf(listing, "%%\n");
-    break;
-  case POWER:
-    ss << "^";
-    fprintf(listing, "^\n");
-    break;
-  /* 正则操作符 */
-  case UNION:
-    ss << "|";
-    fprintf(listing, "|\n");
-    break;
-  case CONCAT:
-    ss << "&";
-    fprintf(listing, "&\n");
-    break;
-  case CLOSURE:
-    ss << "#";
-    fprintf(listing, "#\n");
-    break;
-  case OPTION:
-    ss << "?";
-    fprintf(listing, "?\n");
-    break;
-    /* 位运算 */
-  case AND:
-    ss << "and";
-    fprintf(listing, "and\n");
-    break;
-  case OR:
-    ss << "or";
-    fprintf(listing, "or\n");
-    break;
-  case NOT:
-    ss << "not";
-    fprintf(listing, "not\n");
-    break;
-
-  case ENDFILE:
-    ss << "EOF";
-    fprintf(listing, "EOF\n");
-    break;
-  case NUM:
-    ss << "NUM, val= " << tokenString;
-    fprintf(listing, "NUM, val= %s\n", tokenString);
-    break;
-  case ID:
-    ss << "ID, name= " << tokenString;
-    fprintf(listing, "ID, name= %s\n", tokenString);
-    break;
-  case ERROR:
-    ss << "ERROR: " << tokenString;
-    fprintf(listing, "ERROR: %s\n", tokenString);
-    break;
-  default: /* should never happen */
-    ss << "Unknown token: " << token;
-    fprintf(listing, "Unknown token: %d\n", token);
-  }
-  return copyString(ss.str().data());
-}
-
-/* Function newStmtNode creates a new statement
- * node for syntax tree construction
- */
-TreeNode *newStmtNode(StmtKind kind) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
-  int i;
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else {
-    for (i = 0; i < MAXCHILDREN; i++)
-      t->child[i] = NULL;
-    t->sibling = NULL;
-    t->nodekind = StmtK;
-    t->kind.stmt = kind;
-    t->lineno = lineno;
-  }
-  return t;
-}
-
-/* Function newExpNode creates a new expression
- * node for syntax tree construction
- */
-TreeNode *newExpNode(ExpKind kind) {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
-  int i;
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else {
-    for (i = 0; i < MAXCHILDREN; i++)
-      t->child[i] = NULL;
-    t->sibling = NULL;
-    t->nodekind = ExpK;
-    t->kind.exp = kind;
-    t->lineno = lineno;
-    t->type = Void;
-  }
-  return t;
-}
-
-/* Function copyString allocates and makes a new
- * copy of an existing string
- */
-char *copyString(char *s) {
-  int n;
-  char *t;
-  if (s == NULL)
-    return NULL;
-  n = strlen(s) + 1;
-  t = (char *)malloc(n);
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else
-    strcpy(t, s);
-  return t;
-}
-
-/* Variable indentno is used by printTree to
- * store current number of spaces to indent
- */
-static int indentno = 0;
-
-/* macros to increase/decrease indentation */
-#define INDENT indentno += 2
-#define UNINDENT indentno -= 2
-
-/* printSpaces indents by printing spaces */
-static void printSpaces(void) {
-  int i;
-  for (i = 0; i < indentno; i++)
-    fprintf(listing, " ");
-}
-
-/* procedure printTree prints a syntax tree to the
- * listing file using indentation to indicate subtrees
- */
-void printTree(TreeNode *tree) {
-  int i;
-  INDENT;
-  while (tree != NULL) {
-    printSpaces();
-    if (tree->nodekind == StmtK) {
-      switch (tree->kind.stmt) {
-      case IfK:
-        fprintf(listing, "If\n");
-        break;
-      case RepeatK:
-        fprintf(listing, "Repeat\n");
-        break;
-      case AssignK:
-        fprintf(listing, "Assign to: %s\n", tree->attr.name);
-        break;
-      case ReadK:
-        fprintf(listing, "Read: %s\n", tree->attr.name);
-        break;
-      case WriteK:
-        fprintf(listing, "Write\n");
-        break;
-      case ForK:
-        fprintf(listing, "For: %s\n", tree->attr.name);
-        break;
-      case PlusEqK:
-        fprintf(listing, "PlusEqual: %s\n", tree->attr.name);
-        break;
-      case RegK:
-        fprintf(listing, "RegExp\n");
-        break;
-      default:
-        fprintf(listing, "Unknown ExpNode kind\n");
-        break;
-      }
-    } else if (tree->nodekind == ExpK) {
-      switch (tree->kind.exp) {
-      case OpK:
-        fprintf(listing, "Op: ");
-        printToken(tree->attr.op, "\0");
-        break;
-      case ConstK:
-        fprintf(listing, "Const: %d\n", tree->attr.val);
-        break;
-      case IdK:
-        fprintf(listing, "Id: %s\n", tree->attr.name);
-        break;
-      default:
-        fprintf(listing, "Unknown ExpNode kind\n");
-        break;
-      }
-    } else
-      fprintf(listing, "Unknown node kind\n");
-    for (i = 0; i < MAXCHILDREN; i++)
-      printTree(tree->child[i]);
-    tree = tree->sibling;
-  }
-  UNINDENT;
-}
-
-const char *getTreeNodeInfo(TreeNode *tree) {
-  listing = stdout;
-  std::stringstream ss;
-  if (tree->nodekind == StmtK) {
-    switch (tree->kind.stmt) {
-    case IfK:
-      ss << "If";
-      break;
-    case RepeatK:
-      ss << "Repeat";
-      break;
-    case AssignK:
-      ss << "Assign to: " << tree->attr.name;
-      break;
-    case ReadK:
-      ss << "Read: " << tree->attr.name;
-      break;
-    case WriteK:
-      ss << "Write";
-      break;
-    case ForK:
-      ss << "For: " << tree->attr.name;
-      break;
-    case PlusEqK:
-      ss << "PlusEqual: " << tree->attr.name;
-      break;
-    case RegK:
-      ss << "RegExp";
-      break;
-    default:
-      ss << "Unknown ExpNode kind";
-    }
-  } else if (tree->nodekind == ExpK) {
-    switch (tree->kind.exp) {
-    case OpK:
-      ss << "Op: " << printToken(tree->attr.op, "\0");
-      break;
-    case ConstK:
-      ss << "Const: " << tree->attr.val;
-      break;
-    case IdK:
-      ss << "Id: " << tree->attr.name;
-      break;
-    default:
-      ss << "Unknown ExpNode kind";
-    }
-  }
-  char *info = ss.str().data();
-  return copyString(info);
-}
+/****************************************************/
+/* File: util.c                                     */
+/* Utility function implementation                  */
+/* for the TINY compiler                            */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+// #include "globals.h"
+#include "util.h"
+#include "stdio.h"
+#include <algorithm>
+
+/* Label is the text of a token or node as up to
+ * three pieces that are fixed or borrowed, then a
+ * number if numeric; building one allocates nothing
+ */
+typedef struct {
+  std::string_view text[3];
+  int number;
+  int numeric;
+} Label;
+
+/* tokenLabel describes a token and its lexeme */
+static Label tokenLabel(TokenType token, std::string_view tokenString) {
+  Label l = {{}, 0, FALSE};
+  switch (token) {
+  case IF:
+  case ELSE:
+  case REPEAT:
+  case UNTIL:
+  case READ:
+  case FOR:
+  case TO:
+  case DOWNTO:
+  case ENDDO:
+  case REG:
+  case DO:
+  case WRITE:
+    l.text[0] = "reserved word: ";
+    l.text[1] = tokenString;
+    break;
+  case NUM:
+    l.text[0] = "NUM, val= ";
+    l.text[1] = tokenString;
+    break;
+  case ID:
+    l.text[0] = "ID, name= ";
+    l.text[1] = tokenString;
+    break;
+  case ERROR:
+    l.text[0] = "ERROR: ";
+    l.text[1] = tokenString;
+    break;
+  default:
+    l.text[0] = tokenSpelling(token);
+    if (l.text[0].empty()) { /* should never happen */
+      l.text[0] = "Unknown token: ";
+      l.number = token;
+      l.numeric = TRUE;
+    }
+  }
+  return l;
+}
+
+/* formatLabel writes l to buf like snprintf */
+static size_t formatLabel(char *buf, size_t size, const Label &l) {
+  char digits[16];
+  std::string_view parts[4] = {l.text[0], l.text[1], l.text[2]};
+  if (l.numeric)
+    parts[3] = std::string_view(
+        digits, (size_t)snprintf(digits, sizeof(digits), "%d", l.number));
+  size_t n = 0;
+  for (std::string_view p : parts) {
+    if (!p.empty() && n + 1 < size)
+      memcpy(buf + n, p.data(), std::min(p.size(), size - 1 - n));
+    n += p.size();
+  }
+  if (size > 0)
+    buf[std::min(n, size - 1)] = '\0';
+  return n;
+}
+
+static void printLabel(FILE *listing, const Label &l) {
+  for (std::string_view p : l.text)
+    fwrite(p.data(), 1, p.size(), listing);
+  if (l.numeric)
+    fprintf(listing, "%d", l.number);
+}
+
+void printToken(FILE *listing, TokenType token, std::string_view tokenString) {
+  if (listing == NULL)
+    return;
+  printLabel(listing, tokenLabel(token, tokenString));
+  fputc('\n', listing);
+}
+
+size_t tokenText(char *buf, size_t size, TokenType token,
+                 std::string_view tokenString) {
+  return formatLabel(buf, size, tokenLabel(token, tokenString));
+}
+
+void addDiagnostic(CompilerContext &ctx, DiagCode code, int line, int column,
+                   std::string message) {
+  if (ctx.diagnostics != NULL)
+    ctx.diagnostics->push_back({line, column, code, std::move(message)});
+}
+
+const char *diagCodeName(DiagCode code) {
+  switch (code) {
+  case UnexpectedTokenD:
+    return "unexpected-token";
+  case TrailingCodeD:
+    return "trailing-code";
+  case SourceNotFoundD:
+    return "source-not-found";
+  case OutOfMemoryD:
+    return "out-of-memory";
+  case TypeMismatchD:
+    return "type-mismatch";
+  case DivisionByZeroD:
+    return "division-by-zero";
+  case NoInputD:
+    return "no-input";
+  case MemoryFaultD:
+    return "memory-fault";
+  }
+  return "unknown";
+}
+
+/* allocate takes n bytes from the arena of the
+ * context if it has one, from the heap otherwise
+ */
+static void *allocate(CompilerContext &ctx, size_t n, size_t align) {
+  if (ctx.arena != NULL)
+    return ctx.arena->allocate(n, align);
+  return malloc(n);
+}
+
+/* Function newStmtNode creates a new statement
+ * node for syntax tree construction
+ */
+TreeNode *newStmtNode(CompilerContext &ctx, StmtKind kind) {
+  TreeNode *t =
+      (TreeNode *)allocate(ctx, sizeof(TreeNode), alignof(TreeNode));
+  int i;
+  if (t == NULL)
+    addDiagnostic(ctx, OutOfMemoryD, ctx.lineno, 0, "out of memory");
+  else {
+    for (i = 0; i < MAXCHILDREN; i++)
+      t->child[i] = NULL;
+    t->sibling = NULL;
+    t->nodekind = StmtK;
+    t->kind.stmt = kind;
+    t->attr.name = NULL;
+    t->lineno = ctx.lineno;
+    t->symbol = -1;
+    ctx.nodes++;
+    t->type = Void;
+  }
+  return t;
+}
+
+/* Function newExpNode creates a new expression
+ * node for syntax tree construction
+ */
+TreeNode *newExpNode(CompilerContext &ctx, ExpKind kind) {
+  TreeNode *t =
+      (TreeNode *)allocate(ctx, sizeof(TreeNode), alignof(TreeNode));
+  int i;
+  if (t == NULL)
+    addDiagnostic(ctx, OutOfMemoryD, ctx.lineno, 0, "out of memory");
+  else {
+    for (i = 0; i < MAXCHILDREN; i++)
+      t->child[i] = NULL;
+    t->sibling = NULL;
+    t->nodekind = ExpK;
+    t->kind.exp = kind;
+    t->lineno = ctx.lineno;
+    t->symbol = -1;
+    ctx.nodes++;
+    t->type = Void;
+  }
+  return t;
+}
+
+/* Function copyString allocates and makes a new
+ * copy of an existing string
+ */
+char *copyString(char *s) {
+  int n;
+  char *t;
+  if (s == NULL)
+    return NULL;
+  n = strlen(s) + 1;
+  t = (char *)malloc(n);
+  if (t != NULL)
+    strcpy(t, s);
+  return t;
+}
+
+char *copyString(CompilerContext &ctx, std::string_view s) {
+  char *t = (char *)allocate(ctx, s.size() + 1, 1);
+  if (t == NULL)
+    addDiagnostic(ctx, OutOfMemoryD, ctx.lineno, 0, "out of memory");
+  else {
+    memcpy(t, s.data(), s.size());
+    t[s.size()] = '\0';
+  }
+  return t;
+}
+
+TreeWalk::TreeWalk(TreeNode *tree) {
+  if (tree != NULL)
+    stack.push_back({tree, 0});
+}
+
+TreeNode *TreeWalk::next(int *depth) {
+  if (stack.empty())
+    return NULL;
+  Pending p = stack.back();
+  stack.pop_back();
+  if (p.node->sibling != NULL)
+    stack.push_back({p.node->sibling, p.depth});
+  for (int i = MAXCHILDREN - 1; i >= 0; i--)
+    if (p.node->child[i] != NULL)
+      stack.push_back({p.node->child[i], p.depth + 1});
+  if (depth != NULL)
+    *depth = p.depth;
+  return p.node;
+}
+
+/* procedure printTree prints a syntax tree to the
+ * listing file using indentation to indicate subtrees;
+ * the indentation follows the depth of each node
+ * rather than a static, so that printing is reentrant
+ */
+void printTree(FILE *listing, TreeNode *tree) {
+  TreeWalk walk(tree);
+  TreeNode *t;
+  int depth;
+  while ((t = walk.next(&depth)) != NULL) {
+    fprintf(listing, "%*s", 2 + 2 * depth, "");
+    printNodeLabel(listing, t);
+    fputc('\n', listing);
+  }
+}
+
+/* Procedure freeTree frees a syntax tree built
+ * without an arena; only statements and IdK nodes
+ * carry a name, and interned names belong to their
+ * InternTable
+ */
+void freeTree(TreeNode *tree) {
+  TreeWalk walk(tree);
+  TreeNode *t;
+  while ((t = walk.next()) != NULL) {
+    if ((t->nodekind == StmtK || t->kind.exp == IdK) && t->symbol < 0)
+      free(t->attr.name);
+    free(t);
+  }
+}
+
+/* nameOf gives a node name as printf would */
+static std::string_view nameOf(const char *name) {
+  return name != NULL ? name : "(null)";
+}
+
+/* treeLabel describes a node */
+static Label treeLabel(const TreeNode *tree) {
+  Label l = {{}, 0, FALSE};
+  if (tree->nodekind == StmtK) {
+    switch (tree->kind.stmt) {
+    case IfK:
+      l.text[0] = "If";
+      break;
+    case RepeatK:
+      l.text[0] = "Repeat";
+      break;
+    case AssignK:
+      l.text[0] = "Assign to: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    case ReadK:
+      l.text[0] = "Read: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    case WriteK:
+      l.text[0] = "Write";
+      break;
+    case ForK:
+      l.text[0] = "For: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    case PlusEqK:
+      l.text[0] = "PlusEqual: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    case RegK:
+      l.text[0] = "RegExp: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    default:
+      l.text[0] = "Unknown ExpNode kind";
+    }
+  } else if (tree->nodekind == ExpK) {
+    switch (tree->kind.exp) {
+    case OpK: {
+      Label op = tokenLabel(tree->attr.op, "");
+      l = op;
+      l.text[0] = "Op: ";
+      l.text[1] = op.text[0];
+      l.text[2] = op.text[1];
+      break;
+    }
+    case ConstK:
+      l.text[0] = "Const: ";
+      l.number = tree->attr.val;
+      l.numeric = TRUE;
+      break;
+    case IdK:
+      l.text[0] = "Id: ";
+      l.text[1] = nameOf(tree->attr.name);
+      break;
+    default:
+      l.text[0] = "Unknown ExpNode kind";
+    }
+  } else
+    l.text[0] = "Unknown node kind";
+  return l;
+}
+
+size_t nodeLabel(char *buf, size_t size, const TreeNode *tree) {
+  return formatLabel(buf, size, treeLabel(tree));
+}
+
+void printNodeLabel(FILE *listing, const TreeNode *tree) {
+  printLabel(listing, treeLabel(tree));
+}
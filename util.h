@@ -1,37 +1,155 @@
-/****************************************************/
-/* File: util.h                                     */
-/* Utility functions for the TINY compiler          */
-/* Compiler Construction: Principles and Practice   */
-/* Kenneth C. Louden                                */
-/****************************************************/
-#ifndef _UTIL_H_
-#define _UTIL_H_
-
-#include "globals.h"
-
-/* Procedure printToken prints a token 
- * and its lexeme to the listing file
- */
-char *printToken( TokenType, const char* );
-
-/* Function newStmtNode creates a new statement
- * node for syntax tree construction
- */
-TreeNode * newStmtNode(StmtKind);
-
-/* Function newExpNode creates a new expression 
- * node for syntax tree construction
- */
-TreeNode * newExpNode(ExpKind);
-
-/* Function copyString allocates and makes a new
- * copy of an existing string
- */
-char * copyString( char * );
-
-/* procedure printTree prints a syntax tree to the 
- * listing file using indentation to indicate subtrees
- */
-void printTree( TreeNode * );
-
-#endif
+/****************************************************/
+/* File: util.h                                     */
+/* Utility functions for the TINY compiler          */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+#ifndef _UTIL_H_
+#define _UTIL_H_
+
+#include "globals.h"
+#include "context.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* tokenSpellings holds the fixed text of every
+ * token: its symbol or reserved word, or for ID,
+ * NUM, ERROR and ENDFILE the name of its kind
+ */
+struct TokenSpellings {
+  std::string_view text[MAXTOKEN];
+};
+
+constexpr TokenSpellings buildTokenSpellings(void) {
+  const struct {
+    TokenType token;
+    std::string_view text;
+  } spellings[] = {
+      {ENDFILE, "EOF"},    {ERROR, "ERROR"},    {IF, "if"},
+      {ELSE, "else"},      {REPEAT, "repeat"},  {UNTIL, "until"},
+      {READ, "read"},      {WRITE, "write"},    {FOR, "for"},
+      {TO, "to"},          {DOWNTO, "downto"},  {DO, "do"},
+      {ENDDO, "enddo"},    {AND, "and"},        {OR, "or"},
+      {NOT, "not"},        {ID, "ID"},          {NUM, "NUM"},
+      {ASSIGN, ":="},      {REG, "::="},        {EQ, "="},
+      {LT, "<"},           {PLUS, "+"},         {MINUS, "-"},
+      {TIMES, "*"},        {OVER, "/"},         {LPAREN, "("},
+      {RPAREN, ")"},       {SEMI, ";"},         {LBACKET, "["},
+      {RBACKET, "]"},      {PLUS_EQ, "+="},     {REMAIN, "%"},
+      {POWER, "^"},        {CLOSURE, "#"},      {UNION, "|"},
+      {CONCAT, "&"},       {OPTION, "?"},       {GT, ">"},
+      {LTE, "<="},         {GTE, ">="},         {NEQ, "<>"}};
+  TokenSpellings s = {};
+  for (const auto &p : spellings)
+    s.text[p.token] = p.text;
+  return s;
+}
+
+inline constexpr TokenSpellings tokenSpellings = buildTokenSpellings();
+
+constexpr bool everyTokenSpelled(void) {
+  for (int i = 0; i < MAXTOKEN; i++)
+    if (tokenSpellings.text[i].empty())
+      return false;
+  return true;
+}
+
+static_assert(everyTokenSpelled(), "a token has no spelling");
+
+/* Function tokenSpelling returns the fixed
+ * text of a token, or "" if it is not one
+ */
+constexpr std::string_view tokenSpelling(TokenType token) {
+  return (unsigned)token < MAXTOKEN ? tokenSpellings.text[token]
+                                    : std::string_view();
+}
+
+/* Procedure printToken prints a token 
+ * and its lexeme to the listing file, if
+ * not NULL, followed by a newline
+ */
+void printToken( FILE *, TokenType, std::string_view );
+
+/* Function tokenText writes the text printToken
+ * prints, without the newline, to buf. Like
+ * snprintf it writes at most size bytes including
+ * the NUL and returns the length of the whole text,
+ * so nothing is allocated
+ */
+size_t tokenText( char * buf, size_t size, TokenType, std::string_view );
+
+/* Function newStmtNode creates a new statement
+ * node for syntax tree construction
+ */
+TreeNode * newStmtNode( CompilerContext &, StmtKind );
+
+/* Function newExpNode creates a new expression 
+ * node for syntax tree construction
+ */
+TreeNode * newExpNode( CompilerContext &, ExpKind );
+
+/* Function copyString allocates and makes a new
+ * copy of an existing string; the first form uses
+ * malloc, the second the arena of the context
+ */
+char * copyString( char * );
+char * copyString( CompilerContext &, std::string_view );
+
+/* Procedure addDiagnostic records an error in
+ * the diagnostics of the context
+ */
+void addDiagnostic( CompilerContext &, DiagCode, int line, int column,
+                    std::string message );
+
+/* Function nodeLabel writes the one-line
+ * description of a node shown by the Dialog to
+ * buf; it is bounded by size and returns the whole
+ * length like tokenText
+ */
+size_t nodeLabel( char * buf, size_t size, const TreeNode * );
+
+/* Procedure printNodeLabel prints the label
+ * of a node to the listing file
+ */
+void printNodeLabel( FILE *, const TreeNode * );
+
+/* procedure printTree prints a syntax tree to the 
+ * listing file using indentation to indicate subtrees
+ */
+void printTree( FILE *, TreeNode * );
+
+/* Procedure freeTree frees a syntax tree built
+ * without an arena, with the names that were not
+ * interned; trees in an arena go with the arena
+ */
+void freeTree( TreeNode * );
+
+/* A TreeWalk visits a syntax tree in the order
+ * printTree lists it: each node, then its children
+ * child[0..2], then its siblings. The subtrees yet
+ * to visit wait on a stack in the heap instead of
+ * in native frames, so the depth of the tree is
+ * limited by memory only. next() has read the links
+ * of the node it returns, which may then be changed
+ * or freed
+ */
+class TreeWalk {
+public:
+  explicit TreeWalk( TreeNode * tree );
+
+  /* next returns the next node, or NULL after the
+   * last; depth, if given, receives its nesting:
+   * 0 for the top-level sequence
+   */
+  TreeNode * next( int * depth = NULL );
+
+private:
+  struct Pending {
+    TreeNode * node;
+    int depth;
+  };
+  std::vector<Pending> stack;
+};
+
+#endif
@@ -0,0 +1,285 @@
+/****************************************************/
+/* File: vm.cpp                                     */
+/* The virtual machine that runs the bytecode of    */
+/* a TINY program (bytecode.h)                      */
+/****************************************************/
+
+#include "vm.h"
+#include "runtime.h"
+#include <vector>
+
+/* GCC and Clang take the address of a label, so the
+ * machine can jump from one instruction straight to
+ * the code of the next
+ */
+#if defined(__GNUC__)
+#define THREADED 1
+#endif
+
+#ifdef THREADED
+/* Threaded is an instruction with the address of
+ * its code in place of its number
+ */
+typedef struct {
+  const void *code;
+  int32_t a;
+  int32_t b;
+} Threaded;
+
+#define OP(op) L_##op:
+#define NEXT()                                                                 \
+  {                                                                            \
+    ++pc;                                                                      \
+    goto *pc->code;                                                            \
+  }
+#define JUMP(target)                                                           \
+  {                                                                            \
+    pc = program + (target);                                                   \
+    goto *pc->code;                                                            \
+  }
+#else
+#define OP(op) case op:
+#define NEXT()                                                                 \
+  {                                                                            \
+    ++pc;                                                                      \
+    continue;                                                                  \
+  }
+#define JUMP(target)                                                           \
+  {                                                                            \
+    pc = program + (target);                                                   \
+    continue;                                                                  \
+  }
+#endif
+
+/* the top of the operand stack is kept in tos, the
+ * values below it in stack up to sp
+ */
+#define POP() (tos = *--sp)
+#define PUSH(v) (*sp++ = tos, tos = (v))
+
+/* the three forms of a binary operator, with x and
+ * y its operands and result its value
+ */
+#define BINARY(op, result)                                                     \
+  OP(bc##op) {                                                                 \
+    int y = tos, x = *--sp;                                                    \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }                                                                            \
+  OP(bc##op##C) {                                                              \
+    int x = tos, y = pc->a;                                                    \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }                                                                            \
+  OP(bc##op##V) {                                                              \
+    int x = tos, y = memory[pc->a];                                            \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }
+
+/* the same for / and %, which stop on y = 0 */
+#define DIVIDING(op, result)                                                   \
+  OP(bc##op) {                                                                 \
+    int y = tos, x = *--sp;                                                    \
+    if (y == 0)                                                                \
+      goto divideByZero;                                                       \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }                                                                            \
+  OP(bc##op##C) {                                                              \
+    int x = tos, y = pc->a;                                                    \
+    if (y == 0)                                                                \
+      goto divideByZero;                                                       \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }                                                                            \
+  OP(bc##op##V) {                                                              \
+    int x = tos, y = memory[pc->a];                                            \
+    if (y == 0)                                                                \
+      goto divideByZero;                                                       \
+    tos = (result);                                                            \
+    NEXT();                                                                    \
+  }
+
+/* the three forms of a comparison joined with the
+ * JUMPF after it
+ */
+#define COMPAREJUMP(op, cmp)                                                   \
+  OP(bcJ##op) {                                                                \
+    int y = tos, x = *--sp;                                                    \
+    POP();                                                                     \
+    if (x cmp y)                                                               \
+      NEXT();                                                                  \
+    JUMP(pc->b);                                                               \
+  }                                                                            \
+  OP(bcJ##op##C) {                                                             \
+    int x = tos;                                                               \
+    POP();                                                                     \
+    if (x cmp pc->a)                                                           \
+      NEXT();                                                                  \
+    JUMP(pc->b);                                                               \
+  }                                                                            \
+  OP(bcJ##op##V) {                                                             \
+    int x = tos;                                                               \
+    POP();                                                                     \
+    if (x cmp memory[pc->a])                                                   \
+      NEXT();                                                                  \
+    JUMP(pc->b);                                                               \
+  }
+
+int runBytecode(const Bytecode &bc, FILE *in, FILE *out, Diagnostic *error) {
+  std::vector<int> memory(bc.cells, 0);
+  std::vector<int> stack(bc.maxStack + 1);
+  int *sp = stack.data();
+  int tos = 0;
+  if (bc.code.empty())
+    return TRUE;
+
+#ifdef THREADED
+  static const void *const codes[] = {
+      &&L_bcHALT,   &&L_bcPUSH,   &&L_bcLOAD,    &&L_bcSTORE,  &&L_bcREAD,
+      &&L_bcWRITE,  &&L_bcPOP,    &&L_bcJUMP,    &&L_bcJUMPF,  &&L_bcNOT,
+      &&L_bcAND,    &&L_bcOR,     &&L_bcADD,     &&L_bcSUB,    &&L_bcMUL,
+      &&L_bcDIV,    &&L_bcMOD,    &&L_bcPOW,     &&L_bcLT,     &&L_bcLE,
+      &&L_bcGT,     &&L_bcGE,     &&L_bcEQ,      &&L_bcNE,     &&L_bcADDC,
+      &&L_bcSUBC,   &&L_bcMULC,   &&L_bcDIVC,    &&L_bcMODC,   &&L_bcPOWC,
+      &&L_bcLTC,    &&L_bcLEC,    &&L_bcGTC,     &&L_bcGEC,    &&L_bcEQC,
+      &&L_bcNEC,    &&L_bcADDV,   &&L_bcSUBV,    &&L_bcMULV,   &&L_bcDIVV,
+      &&L_bcMODV,   &&L_bcPOWV,   &&L_bcLTV,     &&L_bcLEV,    &&L_bcGTV,
+      &&L_bcGEV,    &&L_bcEQV,    &&L_bcNEV,     &&L_bcJLT,    &&L_bcJLE,
+      &&L_bcJGT,    &&L_bcJGE,    &&L_bcJEQ,     &&L_bcJNE,    &&L_bcJLTC,
+      &&L_bcJLEC,   &&L_bcJGTC,   &&L_bcJGEC,    &&L_bcJEQC,   &&L_bcJNEC,
+      &&L_bcJLTV,   &&L_bcJLEV,   &&L_bcJGTV,    &&L_bcJGEV,   &&L_bcJEQV,
+      &&L_bcJNEV,   &&L_bcINC,    &&L_bcFORTO,   &&L_bcFORDOWN, &&L_bcNEXTTO,
+      &&L_bcNEXTDOWN};
+  static_assert(sizeof(codes) / sizeof(codes[0]) == BCOPS,
+                "every instruction has its code");
+  std::vector<Threaded> threaded(bc.code.size());
+  for (size_t i = 0; i < bc.code.size(); i++)
+    threaded[i] = {codes[bc.code[i].op], bc.code[i].a, bc.code[i].b};
+  const Threaded *program = threaded.data();
+  const Threaded *pc = program;
+  goto *pc->code;
+#else
+  const BcInstruction *program = bc.code.data();
+  const BcInstruction *pc = program;
+  for (;;)
+    switch (pc->op) {
+#endif
+
+  OP(bcHALT) return TRUE;
+  OP(bcPUSH) {
+    PUSH(pc->a);
+    NEXT();
+  }
+  OP(bcLOAD) {
+    PUSH(memory[pc->a]);
+    NEXT();
+  }
+  OP(bcSTORE) {
+    memory[pc->a] = tos;
+    POP();
+    NEXT();
+  }
+  OP(bcREAD) {
+    if (in == NULL || fscanf(in, "%d", &memory[pc->a]) != 1)
+      goto noInput;
+    NEXT();
+  }
+  OP(bcWRITE) {
+    if (out != NULL)
+      fprintf(out, "%d\n", tos);
+    POP();
+    NEXT();
+  }
+  OP(bcPOP) {
+    POP();
+    NEXT();
+  }
+  OP(bcJUMP) JUMP(pc->b);
+  OP(bcJUMPF) {
+    int test = tos;
+    POP();
+    if (test)
+      NEXT();
+    JUMP(pc->b);
+  }
+  OP(bcNOT) {
+    tos = !tos;
+    NEXT();
+  }
+  OP(bcAND) {
+    int y = tos;
+    tos = *--sp & y;
+    NEXT();
+  }
+  OP(bcOR) {
+    int y = tos;
+    tos = *--sp | y;
+    NEXT();
+  }
+  BINARY(ADD, tinyAdd(x, y))
+  BINARY(SUB, tinySub(x, y))
+  BINARY(MUL, tinyMul(x, y))
+  DIVIDING(DIV, tinyDiv(x, y))
+  DIVIDING(MOD, tinyMod(x, y))
+  BINARY(POW, tinyPow(x, y))
+  BINARY(LT, x < y)
+  BINARY(LE, x <= y)
+  BINARY(GT, x > y)
+  BINARY(GE, x >= y)
+  BINARY(EQ, x == y)
+  BINARY(NE, x != y)
+  COMPAREJUMP(LT, <)
+  COMPAREJUMP(LE, <=)
+  COMPAREJUMP(GT, >)
+  COMPAREJUMP(GE, >=)
+  COMPAREJUMP(EQ, ==)
+  COMPAREJUMP(NE, !=)
+  OP(bcINC) {
+    memory[pc->a] = tinyAdd(memory[pc->a], pc->b);
+    NEXT();
+  }
+  OP(bcFORTO) {
+    if (memory[pc->a] > tos)
+      JUMP(pc->b);
+    NEXT();
+  }
+  OP(bcFORDOWN) {
+    if (memory[pc->a] < tos)
+      JUMP(pc->b);
+    NEXT();
+  }
+  /* the variable is compared before its step,
+   * which wraps past INT_MAX or INT_MIN
+   */
+  OP(bcNEXTTO) {
+    int v = memory[pc->a];
+    memory[pc->a] = tinyAdd(v, 1);
+    if (v < tos)
+      JUMP(pc->b);
+    NEXT();
+  }
+  OP(bcNEXTDOWN) {
+    int v = memory[pc->a];
+    memory[pc->a] = tinySub(v, 1);
+    if (v > tos)
+      JUMP(pc->b);
+    NEXT();
+  }
+
+#ifndef THREADED
+    default:
+      return FALSE;
+    }
+#endif
+
+divideByZero:
+  if (error != NULL)
+    *error = {bc.lines[pc - program], 0, DivisionByZeroD, "division by 0"};
+  return FALSE;
+noInput:
+  if (error != NULL)
+    *error = {bc.lines[pc - program], 0, NoInputD, "no input for read"};
+  return FALSE;
+}
@@ -0,0 +1,27 @@
+/****************************************************/
+/* File: vm.h                                       */
+/* The virtual machine that runs the bytecode of    */
+/* a TINY program (bytecode.h)                      */
+/****************************************************/
+#ifndef _VM_H_
+#define _VM_H_
+
+#include "bytecode.h"
+#include "diagnostic.h"
+#include <stdio.h>
+
+/* runBytecode runs bc, reading the values of read
+ * statements as decimal integers from in and writing
+ * those of write statements to out, one per line;
+ * Booleans are written as 1 and 0. It returns TRUE
+ * when the program ends. A division by 0, or a read
+ * with no value left, stops it and returns FALSE,
+ * with the reason in *error if error is not NULL.
+ * GCC and Clang builds dispatch on the address of
+ * each instruction's code (direct threading), others
+ * on a switch
+ */
+int runBytecode(const Bytecode &bc, FILE *in, FILE *out,
+                Diagnostic *error = NULL);
+
+#endif
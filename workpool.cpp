@@ -0,0 +1,102 @@
+/****************************************************/
+/* File: workpool.cpp                               */
+/* Work-stealing thread pool implementation         */
+/****************************************************/
+
+#include "workpool.h"
+
+/* the pool and deque of the calling worker thread */
+static thread_local WorkPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+WorkPool::WorkPool(int threads)
+    : queued(0), pending(0), nextQueue(0), stopping(false) {
+  if (threads <= 0)
+    threads = (int)std::thread::hardware_concurrency();
+  if (threads <= 0)
+    threads = 1;
+  for (int i = 0; i < threads; i++)
+    queues.emplace_back(new Queue);
+  for (int i = 0; i < threads; i++)
+    workers.emplace_back(&WorkPool::work, this, i);
+}
+
+WorkPool::~WorkPool() {
+  {
+    std::lock_guard<std::mutex> lk(idleLock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &t : workers)
+    t.join();
+}
+
+void WorkPool::submit(std::function<void()> task) {
+  size_t q;
+  if (currentPool == this)
+    q = (size_t)currentWorker;
+  else {
+    std::lock_guard<std::mutex> lk(idleLock);
+    q = nextQueue++ % queues.size();
+  }
+  {
+    std::lock_guard<std::mutex> lk(queues[q]->lock);
+    queues[q]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lk(idleLock);
+    queued++;
+    pending++;
+  }
+  wake.notify_one();
+}
+
+void WorkPool::wait() {
+  std::unique_lock<std::mutex> lk(idleLock);
+  idle.wait(lk, [this] { return pending == 0; });
+}
+
+/* take pops the newest task of worker id, or
+ * steals the oldest task of another worker
+ */
+bool WorkPool::take(int id, std::function<void()> &task) {
+  int n = (int)queues.size();
+  for (int k = 0; k < n; k++) {
+    Queue &q = *queues[(id + k) % n];
+    std::lock_guard<std::mutex> lk(q.lock);
+    if (q.tasks.empty())
+      continue;
+    if (k == 0) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+    return true;
+  }
+  return false;
+}
+
+void WorkPool::work(int id) {
+  currentPool = this;
+  currentWorker = id;
+  for (;;) {
+    std::function<void()> task;
+    if (take(id, task)) {
+      {
+        std::lock_guard<std::mutex> lk(idleLock);
+        queued--;
+      }
+      task();
+      std::lock_guard<std::mutex> lk(idleLock);
+      if (--pending == 0)
+        idle.notify_all();
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(idleLock);
+    wake.wait(lk, [this] { return queued > 0 || stopping; });
+    if (stopping && queued == 0)
+      return;
+  }
+}
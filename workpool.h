@@ -0,0 +1,60 @@
+/****************************************************/
+/* File: workpool.h                                 */
+/* Work-stealing thread pool for batch analysis     */
+/****************************************************/
+#ifndef _WORKPOOL_H_
+#define _WORKPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A WorkPool runs tasks on a fixed set of threads.
+ * Every worker owns a deque: it pops its own tasks
+ * from the back and, when it runs dry, steals from
+ * the front of the other deques. Tasks submitted
+ * by a worker go to that worker's deque
+ */
+class WorkPool {
+public:
+  /* threads <= 0 means one per hardware thread */
+  explicit WorkPool(int threads = 0);
+  ~WorkPool();
+
+  WorkPool(const WorkPool &) = delete;
+  WorkPool &operator=(const WorkPool &) = delete;
+
+  void submit(std::function<void()> task);
+
+  /* wait blocks until every submitted task has
+   * finished; it must not be called by a task
+   */
+  void wait();
+
+  int size() const { return (int)workers.size(); }
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(int id);
+  bool take(int id, std::function<void()> &task);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex idleLock;
+  std::condition_variable wake; /* tasks queued or stopping */
+  std::condition_variable idle; /* pending dropped to zero */
+  long queued;                  /* submitted, not yet taken */
+  long pending;                 /* submitted, not yet finished */
+  size_t nextQueue;             /* round robin for outside submits */
+  bool stopping;
+};
+
+#endif